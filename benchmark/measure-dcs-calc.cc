@@ -27,6 +27,26 @@ BENCHMARK_F(DCSBenchmark, BremsstrahlungVectorisedLargeOpenMP)
     large_vectorised_openmp_calculation(state, dcs::bremsstrahlung);
 }
 
+BENCHMARK_F(DCSBenchmark, BremsstrahlungSIMD)
+(benchmark::State &state) {
+    simd_calculation(state, dcs::simd::bremsstrahlung);
+}
+
+BENCHMARK_F(DCSBenchmark, BremsstrahlungSIMDLarge)
+(benchmark::State &state) {
+    large_simd_calculation(state, dcs::simd::bremsstrahlung);
+}
+
+BENCHMARK_F(DCSBenchmark, BremsstrahlungSIMDLargeOpenMP)
+(benchmark::State &state) {
+    large_simd_openmp_calculation(state, dcs::simd::bremsstrahlung);
+}
+
+BENCHMARK_F(DCSBenchmark, BremsstrahlungSIMDLargeFloat)
+(benchmark::State &state) {
+    large_simd_float_calculation(state, dcs::simd::bremsstrahlung);
+}
+
 BENCHMARK_F(DCSBenchmark, DELBremsstrahlung)
 (benchmark::State &state) {
     single_recoil_integral_calculation(state, dcs::bremsstrahlung, dcs::del_integrand);
@@ -57,6 +77,36 @@ BENCHMARK_F(DCSBenchmark, PairProductionVectorised)
     vectorised_calculation(state, dcs::pair_production);
 }
 
+BENCHMARK_F(DCSBenchmark, PairProductionVectorisedLarge)
+(benchmark::State &state) {
+    large_vectorised_calculation(state, dcs::pair_production);
+}
+
+BENCHMARK_F(DCSBenchmark, PairProductionVectorisedLargeOpenMP)
+(benchmark::State &state) {
+    large_vectorised_openmp_calculation(state, dcs::pair_production);
+}
+
+BENCHMARK_F(DCSBenchmark, PairProductionSIMD)
+(benchmark::State &state) {
+    simd_calculation(state, dcs::simd::pair_production);
+}
+
+BENCHMARK_F(DCSBenchmark, PairProductionSIMDLarge)
+(benchmark::State &state) {
+    large_simd_calculation(state, dcs::simd::pair_production);
+}
+
+BENCHMARK_F(DCSBenchmark, PairProductionSIMDLargeOpenMP)
+(benchmark::State &state) {
+    large_simd_openmp_calculation(state, dcs::simd::pair_production);
+}
+
+BENCHMARK_F(DCSBenchmark, PairProductionSIMDLargeFloat)
+(benchmark::State &state) {
+    large_simd_float_calculation(state, dcs::simd::pair_production);
+}
+
 BENCHMARK_F(DCSBenchmark, DELPairProduction)
 (benchmark::State &state) {
     single_recoil_integral_calculation(state, dcs::pair_production, dcs::del_integrand);
@@ -77,6 +127,26 @@ BENCHMARK_F(DCSBenchmark, CELPairProductionVectorised)
     vectorised_recoil_integral_calculation(state, dcs::pair_production, dcs::cel_integrand);
 }
 
+BENCHMARK_F(DCSBenchmark, PairProductionTabulated)
+(benchmark::State &state) {
+    single_calculation(state, pair_production_table());
+}
+
+BENCHMARK_F(DCSBenchmark, PairProductionTabulatedVectorised)
+(benchmark::State &state) {
+    vectorised_calculation(state, pair_production_table());
+}
+
+BENCHMARK_F(DCSBenchmark, DELPairProductionTabulated)
+(benchmark::State &state) {
+    single_recoil_integral_calculation(state, pair_production_table(), dcs::del_integrand);
+}
+
+BENCHMARK_F(DCSBenchmark, DELPairProductionTabulatedVectorised)
+(benchmark::State &state) {
+    vectorised_recoil_integral_calculation(state, pair_production_table(), dcs::del_integrand);
+}
+
 BENCHMARK_F(DCSBenchmark, Photonuclear)
 (benchmark::State &state) {
     single_calculation(state, dcs::photonuclear);
@@ -87,6 +157,36 @@ BENCHMARK_F(DCSBenchmark, PhotonuclearVectorised)
     vectorised_calculation(state, dcs::photonuclear);
 }
 
+BENCHMARK_F(DCSBenchmark, PhotonuclearVectorisedLarge)
+(benchmark::State &state) {
+    large_vectorised_calculation(state, dcs::photonuclear);
+}
+
+BENCHMARK_F(DCSBenchmark, PhotonuclearVectorisedLargeOpenMP)
+(benchmark::State &state) {
+    large_vectorised_openmp_calculation(state, dcs::photonuclear);
+}
+
+BENCHMARK_F(DCSBenchmark, PhotonuclearSIMD)
+(benchmark::State &state) {
+    simd_calculation(state, dcs::simd::photonuclear);
+}
+
+BENCHMARK_F(DCSBenchmark, PhotonuclearSIMDLarge)
+(benchmark::State &state) {
+    large_simd_calculation(state, dcs::simd::photonuclear);
+}
+
+BENCHMARK_F(DCSBenchmark, PhotonuclearSIMDLargeOpenMP)
+(benchmark::State &state) {
+    large_simd_openmp_calculation(state, dcs::simd::photonuclear);
+}
+
+BENCHMARK_F(DCSBenchmark, PhotonuclearSIMDLargeFloat)
+(benchmark::State &state) {
+    large_simd_float_calculation(state, dcs::simd::photonuclear);
+}
+
 BENCHMARK_F(DCSBenchmark, DELPhotonuclear)
 (benchmark::State &state) {
     single_recoil_integral_calculation(state, dcs::photonuclear, dcs::del_integrand);
@@ -118,6 +218,36 @@ BENCHMARK_F(DCSBenchmark, IonisationVectorised)
     vectorised_calculation(state, dcs::ionisation);
 }
 
+BENCHMARK_F(DCSBenchmark, IonisationVectorisedLarge)
+(benchmark::State &state) {
+    large_vectorised_calculation(state, dcs::ionisation);
+}
+
+BENCHMARK_F(DCSBenchmark, IonisationVectorisedLargeOpenMP)
+(benchmark::State &state) {
+    large_vectorised_openmp_calculation(state, dcs::ionisation);
+}
+
+BENCHMARK_F(DCSBenchmark, IonisationSIMD)
+(benchmark::State &state) {
+    simd_calculation(state, dcs::simd::ionisation);
+}
+
+BENCHMARK_F(DCSBenchmark, IonisationSIMDLarge)
+(benchmark::State &state) {
+    large_simd_calculation(state, dcs::simd::ionisation);
+}
+
+BENCHMARK_F(DCSBenchmark, IonisationSIMDLargeOpenMP)
+(benchmark::State &state) {
+    large_simd_openmp_calculation(state, dcs::simd::ionisation);
+}
+
+BENCHMARK_F(DCSBenchmark, IonisationSIMDLargeFloat)
+(benchmark::State &state) {
+    large_simd_float_calculation(state, dcs::simd::ionisation);
+}
+
 BENCHMARK_F(DCSBenchmark, DELIonisation)
 (benchmark::State &state) {
     single_recoil_integral_calculation(state, dcs::ionisation, dcs::del_integrand);
@@ -137,3 +267,19 @@ BENCHMARK_F(DCSBenchmark, CELIonisationVectorised)
 (benchmark::State &state) {
     vectorised_recoil_integral_calculation(state, dcs::ionisation, dcs::cel_integrand);
 }
+
+BENCHMARK_F(DCSBenchmark, CoulombSoftScattering)
+(benchmark::State &state) {
+    const auto kinetic_energies = DCSData::get_kinetic_energies();
+    const auto result = torch::zeros_like(kinetic_energies);
+    for (auto _ : state)
+        dcs::soft_scattering(result, kinetic_energies, STANDARD_ROCK, MUON_MASS);
+}
+
+BENCHMARK_F(DCSBenchmark, CoulombSoftScatteringOpenMP)
+(benchmark::State &state) {
+    const auto kinetic_energies = DCSData::get_kinetic_energies();
+    const auto result = torch::zeros_like(kinetic_energies);
+    for (auto _ : state)
+        dcs::psoft_scattering(result, kinetic_energies, STANDARD_ROCK, MUON_MASS);
+}
@@ -9,6 +9,11 @@
 
 using namespace noa::pms;
 
+inline const dcs::PairProductionTable &pair_production_table() {
+    static const auto table = dcs::PairProductionTable{STANDARD_ROCK, MUON_MASS};
+    return table;
+}
+
 struct DCSBenchmark : benchmark::Fixture {
     DCSBenchmark() {
         DCSData::get_all();
@@ -60,6 +65,56 @@ struct DCSBenchmark : benchmark::Fixture {
                     result, kinetic_energies, recoil_energies, element, mu);
     }
 
+    template<typename DCSKernel>
+    inline void simd_calculation(benchmark::State &state, const DCSKernel &dcs_kernel) {
+        const auto kinetic_energies = DCSData::get_kinetic_energies();
+        const auto recoil_energies = DCSData::get_recoil_energies();
+        const auto result = torch::zeros_like(kinetic_energies);
+        const auto element = STANDARD_ROCK;
+        const auto mu = MUON_MASS;
+        for (auto _ : state)
+            dcs::simd::vmap(dcs_kernel)(
+                    result, kinetic_energies, recoil_energies, element, mu);
+    }
+
+    template<typename DCSKernel>
+    inline void large_simd_calculation(benchmark::State &state, const DCSKernel &dcs_kernel) {
+        const auto kinetic_energies = DCSData::get_kinetic_energies().repeat_interleave(1000);
+        const auto recoil_energies = DCSData::get_recoil_energies().repeat_interleave(1000);
+        const auto result = torch::zeros_like(kinetic_energies);
+        const auto element = STANDARD_ROCK;
+        const auto mu = MUON_MASS;
+        for (auto _ : state)
+            dcs::simd::vmap(dcs_kernel)(
+                    result, kinetic_energies, recoil_energies, element, mu);
+    }
+
+    template<typename DCSKernel>
+    inline void large_simd_openmp_calculation(benchmark::State &state, const DCSKernel &dcs_kernel) {
+        const auto kinetic_energies = DCSData::get_kinetic_energies().repeat_interleave(1000);
+        const auto recoil_energies = DCSData::get_recoil_energies().repeat_interleave(1000);
+        const auto result = torch::zeros_like(kinetic_energies);
+        const auto element = STANDARD_ROCK;
+        const auto mu = MUON_MASS;
+        for (auto _ : state)
+            dcs::simd::pvmap(dcs_kernel)(
+                    result, kinetic_energies, recoil_energies, element, mu);
+    }
+
+    template<typename DCSKernel>
+    inline void large_simd_float_calculation(benchmark::State &state, const DCSKernel &dcs_kernel) {
+        const auto kinetic_energies =
+                DCSData::get_kinetic_energies().repeat_interleave(1000).to(torch::kFloat32);
+        const auto recoil_energies =
+                DCSData::get_recoil_energies().repeat_interleave(1000).to(torch::kFloat32);
+        const auto result = torch::zeros_like(kinetic_energies);
+        const auto element = STANDARD_ROCK;
+        const auto mu = MUON_MASS;
+        for (auto _ : state)
+            dcs::simd::vmap(dcs_kernel)(
+                    result, kinetic_energies, recoil_energies, element, mu);
+    }
+
     template<typename DCSFunc, typename EnergyIntegrand>
     inline void single_recoil_integral_calculation(benchmark::State &state,
                                                    const DCSFunc &dcs_func,
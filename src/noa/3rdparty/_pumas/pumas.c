@@ -44,6 +44,20 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* OpenMP, for the tabulation of physics. */
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+/*
+ * Storage class of the scratch buffers used by the tabulation routines, which
+ * might run concurrently.
+ */
+#ifdef __cplusplus
+#define THREAD_LOCAL thread_local
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
 /*  For debugging with gdb, on linux. */
 #ifndef GDB_MODE
 #define GDB_MODE 0
@@ -102,6 +116,16 @@
  * Minimum step size.
  */
 #define STEP_MIN 1E-07
+/**
+ * Number of log-uniform bins used for locating a kinetic energy in the
+ * tabulated grid, see `table_index`.
+ */
+#define TABLE_K_LOG_BINS 1024
+/**
+ * Maximum gap, in grid rows, scanned linearly within a log bin before
+ * switching to a dichotomy.
+ */
+#define TABLE_K_LOG_SCAN 8
 /**
  * Tuning parameters for the tabulation of the DCS
  */
@@ -660,7 +684,7 @@ struct pumas_physics {
  * Version tag for the physics data format. Increment whenever the
  * structure changes.
  */
-#define PHYSICS_BINARY_DUMP_TAG 13
+#define PHYSICS_BINARY_DUMP_TAG 14
 
         /** The total byte size of the shared data. */
         int size;
@@ -695,6 +719,12 @@ struct pumas_physics {
         double cutoff;
         /** Ratio of EHS path length w.r.t. the first transport path length. */
         double elastic_ratio;
+        /** Log of the first non null tabulated kinetic energy. */
+        double table_K_log_min;
+        /** Inverse width of the log-uniform bins of kinetic energy. */
+        double table_K_log_scale;
+        /** Lowest grid row of each log-uniform kinetic energy bin. */
+        int table_K_log_bin[TABLE_K_LOG_BINS + 1];
         /** Path to the current MDF. */
         char * mdf_path;
         /** Path where the dE/dX files are stored. */
@@ -905,6 +935,12 @@ static double cel_kinetic_energy(const struct pumas_physics * physics,
 static double cel_energy_loss(const struct pumas_physics * physics,
     struct pumas_context * context, enum pumas_mode scheme, int material,
     double kinetic);
+static void cel_grammage_and_proper_time(const struct pumas_physics * physics,
+    struct pumas_context * context, enum pumas_mode scheme, int material,
+    double kinetic, double * grammage, double * time);
+static void cel_grammage_and_energy_loss(const struct pumas_physics * physics,
+    struct pumas_context * context, enum pumas_mode scheme, int material,
+    double kinetic, double * grammage, double * dedx);
 static double cel_straggling(const struct pumas_physics * physics,
     struct pumas_context * context, int material, double kinetic);
 static double cel_magnetic_rotation(const struct pumas_physics * physics,
@@ -1075,9 +1111,15 @@ static void table_bracket(
     const double * table, double value, int * p1, int * p2);
 static int table_index(const struct pumas_physics * physics,
     struct pumas_context * context, const double * table, double value);
+static int table_index_log(const struct pumas_physics * physics, double value);
+static void table_index_log_initialise(struct pumas_physics * physics);
 static double table_interpolate_pchip(const struct pumas_physics * physics,
     struct pumas_context * context, const double * table_X,
     const double * table_Y, const double * table_M, double x);
+static void table_interpolate_pchip2(const struct pumas_physics * physics,
+    struct pumas_context * context, const double * table_X,
+    const double * table_Y0, const double * table_M0, const double * table_Y1,
+    const double * table_M1, double x, double * y0, double * y1);
 static void table_get_msc(const struct pumas_physics * physics,
     struct pumas_context * context, int material, double kinetic, double * mu0,
     double * invlb1);
@@ -1233,7 +1275,7 @@ static void compute_composite_tables(
     struct pumas_physics * physics, int material);
 static void compute_cel_integrals(struct pumas_physics * physics, int imed);
 static enum pumas_return compute_scattering(struct pumas_physics * physics,
-    int imed, struct error_context * error_);
+    int imed, int n_threads, struct error_context * error_);
 static void compute_kinetic_integral(
     struct pumas_physics * physics, double * table, double * work);
 static void compute_time_integrals(
@@ -1269,6 +1311,10 @@ static void compute_ZoA(struct pumas_physics * physics, int material);
 static void compute_MEE(struct pumas_physics * physics, int material);
 static enum pumas_return compute_dcs_table(
     struct pumas_physics * physics, int element, struct error_context * error_);
+static enum pumas_return compute_dcs_tables(
+    struct pumas_physics * physics, int n_threads, struct error_context * error_);
+static enum pumas_return physics_relocate(
+    struct pumas_physics * physics, struct error_context * error_);
 static enum pumas_return physics_tabulate(struct pumas_physics * physics,
     struct physics_tabulation_data * data, struct error_context * error_);
 static void physics_tabulation_clear(const struct pumas_physics * physics,
@@ -1412,6 +1458,7 @@ static enum pumas_return _initialise(struct pumas_physics ** physics_ptr,
     int dry_mode, const struct pumas_physics_settings * settings_)
 {
         ERROR_INITIALISE(pumas_physics_create);
+        const int n_threads = (settings_ == NULL) ? 0 : settings_->n_threads;
 
         /* Check if the Physics pointer is NULL. */
         if (physics_ptr == NULL) {
@@ -1859,6 +1906,9 @@ static enum pumas_return _initialise(struct pumas_physics ** physics_ptr,
         /* All done if in dry mode. */
         if (dry_mode) goto clean_and_exit;
 
+        /* Map the kinetic energy grid for fast lookups. */
+        table_index_log_initialise(physics);
+
         /* Precompute the CEL integrals and the TT parameters. */
         for (imat = 0; imat < physics->n_materials - physics->n_composites;
              imat++) {
@@ -1873,7 +1923,7 @@ static enum pumas_return _initialise(struct pumas_physics ** physics_ptr,
 
                 compute_cel_integrals(physics, imat);
                 compute_csda_magnetic_transport(physics, imat);
-                if (compute_scattering(physics, imat, error_) !=
+                if (compute_scattering(physics, imat, n_threads, error_) !=
                     PUMAS_RETURN_SUCCESS) goto clean_and_exit;
         }
 
@@ -1887,12 +1937,9 @@ static enum pumas_return _initialise(struct pumas_physics ** physics_ptr,
                         goto clean_and_exit;
         }
 
-        /* Tabulate the DCS for atomic elements. */
-        int iel;
-        for (iel = 0; iel < physics->n_elements; iel++) {
-                if (compute_dcs_table(physics, iel, error_) !=
-                    PUMAS_RETURN_SUCCESS) goto clean_and_exit;
-        }
+        /* Tabulate the DCS for atomic elements, concurrently. */
+        if (compute_dcs_tables(physics, n_threads, error_) !=
+            PUMAS_RETURN_SUCCESS) goto clean_and_exit;
 
         /* Compute the cubic interp. coefficients for atomic elements
          * cross-sections
@@ -2105,8 +2152,28 @@ enum pumas_return pumas_physics_load(
 
         /* Load the data and remap the addresses. */
         if (fread(physics, size, 1, stream) != 1) goto error;
-{
+        if (physics_relocate(physics, error_) != PUMAS_RETURN_SUCCESS)
+                goto error;
 
+        return PUMAS_RETURN_SUCCESS;
+
+}
+}
+}
+}
+error:
+        deallocate(physics);
+        *physics_ptr = NULL;
+        return ERROR_RAISE();
+}
+
+/*
+ * Remap the internal addresses of physics data read from a binary dump, and
+ * restore the DCS models.
+ */
+static enum pumas_return physics_relocate(
+    struct pumas_physics * physics, struct error_context * error_)
+{
         void ** ptr = (void **)(&(physics->mdf_path));
         ptrdiff_t delta = (char *)(physics->data) - (char *)(*ptr);
         int i;
@@ -2142,7 +2209,7 @@ enum pumas_return pumas_physics_load(
                     physics->model_bremsstrahlung,
                     &physics->dcs_bremsstrahlung);
         } else {
-                goto error;
+                return error_->code;
         }
 
         if (dcs_check_model(PUMAS_PROCESS_PAIR_PRODUCTION,
@@ -2151,7 +2218,7 @@ enum pumas_return pumas_physics_load(
                     physics->model_pair_production,
                     &physics->dcs_pair_production);
         } else {
-                goto error;
+                return error_->code;
         }
 
         if (dcs_check_model(PUMAS_PROCESS_PHOTONUCLEAR,
@@ -2160,7 +2227,7 @@ enum pumas_return pumas_physics_load(
                     physics->model_photonuclear,
                     &physics->dcs_photonuclear);
         } else {
-                goto error;
+                return error_->code;
         }
 
         /* Erase the dE/dX filename(s) */
@@ -2170,17 +2237,59 @@ enum pumas_return pumas_physics_load(
 
         return PUMAS_RETURN_SUCCESS;
 
+#undef N_DATA_POINTERS
 }
-}
-}
-}
-}
-error:
-        deallocate(physics);
+
+enum pumas_return pumas_physics_map(
+    struct pumas_physics ** physics_ptr, void * buffer, size_t size)
+{
+        ERROR_INITIALISE(pumas_physics_map);
+
+        /* Check the physics pointer. */
+        if (physics_ptr == NULL) {
+                return ERROR_NULL_PHYSICS();
+        }
         *physics_ptr = NULL;
-        return ERROR_RAISE();
 
-#undef N_DATA_POINTERS
+        /* Check the input buffer */
+        if (buffer == NULL)
+                return ERROR_MESSAGE(
+                    PUMAS_RETURN_PATH_ERROR, "invalid input buffer (null)");
+
+        /* Check the binary dump tag and size. */
+        const int * header = buffer;
+        if ((size < 2 * sizeof(int)) ||
+            (header[0] != PHYSICS_BINARY_DUMP_TAG)) {
+                return ERROR_MESSAGE(PUMAS_RETURN_FORMAT_ERROR,
+                    "incompatible version of binary dump");
+        }
+        const int data_size = header[1];
+        if ((data_size < (int)sizeof(struct pumas_physics)) ||
+            ((size_t)data_size > size - 2 * sizeof(int))) {
+                return ERROR_MESSAGE(PUMAS_RETURN_FORMAT_ERROR,
+                    "truncated binary dump");
+        }
+
+        /* Remap the addresses in place. */
+        struct pumas_physics * physics =
+            (struct pumas_physics *)(header + 2);
+        if (physics_relocate(physics, error_) != PUMAS_RETURN_SUCCESS)
+                return ERROR_RAISE();
+
+        *physics_ptr = physics;
+        return PUMAS_RETURN_SUCCESS;
+}
+
+void pumas_physics_dump_format(int * tag, size_t layout[5])
+{
+        if (tag != NULL) *tag = PHYSICS_BINARY_DUMP_TAG;
+        if (layout != NULL) {
+                layout[0] = sizeof(struct pumas_physics);
+                layout[1] = sizeof(struct atomic_element);
+                layout[2] = sizeof(struct material_component);
+                layout[3] = sizeof(struct composite_component);
+                layout[4] = sizeof(struct composite_material);
+        }
 }
 
 enum pumas_return pumas_physics_dump(
@@ -2248,6 +2357,7 @@ const char * pumas_error_function(pumas_function_t * caller)
         TOSTRING(pumas_physics_create)
         TOSTRING(pumas_physics_dump)
         TOSTRING(pumas_physics_load)
+        TOSTRING(pumas_physics_map)
         TOSTRING(pumas_context_transport)
         TOSTRING(pumas_physics_particle)
         TOSTRING(pumas_context_create)
@@ -2510,6 +2620,13 @@ error:
 #undef RANDOM_BINARY_DUMP_TAG
 }
 
+void pumas_context_random_reset_randn(struct pumas_context * context)
+{
+        struct simulation_context * context_ = (void *)context;
+        context_->randn_done = 0;
+        context_->randn_next = 0.;
+}
+
 /* Uniform pseudo random distribution from a Mersenne Twister */
 static double random_uniform01(struct pumas_context * context)
 {
@@ -3889,6 +4006,76 @@ double cel_energy_loss(const struct pumas_physics * physics,
             table_get_dE_dK(physics, scheme, material, 0), kinetic);
 }
 
+/**
+ * Total grammage and proper time for a deterministic CEL.
+ *
+ * @param Physics  Handle for physics tables.
+ * @param context  The simulation context.
+ * @param scheme   The energy loss scheme.
+ * @param material The index of the propagation material.
+ * @param kinetic  The initial kinetic energy.
+ * @param grammage The total grammage in kg/m^2.
+ * @param time     The normalised proper time in kg/m^2.
+ *
+ * Equivalent to `cel_grammage` and `cel_proper_time`, sharing the table lookup.
+ */
+void cel_grammage_and_proper_time(const struct pumas_physics * physics,
+    struct pumas_context * context, enum pumas_mode scheme, int material,
+    double kinetic, double * grammage, double * time)
+{
+        const int imax = physics->n_energies - 1;
+        if ((kinetic < *table_get_K(physics, 0)) ||
+            (kinetic >= *table_get_K(physics, imax))) {
+                *grammage =
+                    cel_grammage(physics, context, scheme, material, kinetic);
+                *time =
+                    cel_proper_time(physics, context, scheme, material, kinetic);
+                return;
+        }
+
+        table_interpolate_pchip2(physics, context, table_get_K(physics, 0),
+            table_get_X(physics, scheme, material, 0),
+            table_get_X_dK(physics, scheme, material, 0),
+            table_get_T(physics, scheme, material, 0),
+            table_get_T_dK(physics, scheme, material, 0), kinetic, grammage,
+            time);
+}
+
+/**
+ * Total grammage and average CEL.
+ *
+ * @param Physics  Handle for physics tables.
+ * @param context  The simulation context.
+ * @param scheme   The energy loss scheme.
+ * @param material The index of the propagation material.
+ * @param kinetic  The initial kinetic energy.
+ * @param grammage The total grammage in kg/m^2.
+ * @param dedx     The CEL in GeV/(kg/m^2).
+ *
+ * Equivalent to `cel_grammage` and `cel_energy_loss`, sharing the table lookup.
+ */
+void cel_grammage_and_energy_loss(const struct pumas_physics * physics,
+    struct pumas_context * context, enum pumas_mode scheme, int material,
+    double kinetic, double * grammage, double * dedx)
+{
+        const int imax = physics->n_energies - 1;
+        if ((kinetic < *table_get_K(physics, 0)) ||
+            (kinetic >= *table_get_K(physics, imax))) {
+                *grammage =
+                    cel_grammage(physics, context, scheme, material, kinetic);
+                *dedx =
+                    cel_energy_loss(physics, context, scheme, material, kinetic);
+                return;
+        }
+
+        table_interpolate_pchip2(physics, context, table_get_K(physics, 0),
+            table_get_X(physics, scheme, material, 0),
+            table_get_X_dK(physics, scheme, material, 0),
+            table_get_dE(physics, scheme, material, 0),
+            table_get_dE_dK(physics, scheme, material, 0), kinetic, grammage,
+            dedx);
+}
+
 /**
  * The energy straggling.
  *
@@ -4231,6 +4418,40 @@ double table_interpolate_pchip(const struct pumas_physics * physics,
         return math_pchip_interpolate(t, table_Y[i1], table_Y[i2], m1, m2);
 }
 
+/**
+ * Piecewise Hermite interpolation of two properties sharing the same table_X.
+ *
+ * @param Physics  Handle for physics tables.
+ * @param context  The simulation context.
+ * @param table_X  Table of x values.
+ * @param table_Y0 Table of the first property values.
+ * @param table_M0 Table of the first property derivatives.
+ * @param table_Y1 Table of the second property values.
+ * @param table_M1 Table of the second property derivatives.
+ * @param x        Point at which the interpolants are evaluated.
+ * @param y0       The first interpolated value.
+ * @param y1       The second interpolated value.
+ *
+ * Same as `table_interpolate_pchip` but the index of x in table_X is looked up
+ * once for both properties. **Warning** : there is no bound check.
+ */
+void table_interpolate_pchip2(const struct pumas_physics * physics,
+    struct pumas_context * context, const double * table_X,
+    const double * table_Y0, const double * table_M0, const double * table_Y1,
+    const double * table_M1, double x, double * y0, double * y1)
+{
+        const int i1 = table_index(physics, context, table_X, x);
+        const int i2 = i1 + 1;
+        const double dX = table_X[i2] - table_X[i1];
+        const double t = (x - table_X[i1]) / dX;
+        const double m01 = table_M0[i1] * dX;
+        const double m02 = (i2 > 1) ? table_M0[i2] * dX : m01;
+        const double m11 = table_M1[i1] * dX;
+        const double m12 = (i2 > 1) ? table_M1[i2] * dX : m11;
+        *y0 = math_pchip_interpolate(t, table_Y0[i1], table_Y0[i2], m01, m02);
+        *y1 = math_pchip_interpolate(t, table_Y1[i1], table_Y1[i2], m11, m12);
+}
+
 /**
  * Find the index closest to `value`, from below.
  *
@@ -4271,8 +4492,14 @@ int table_index(const struct pumas_physics * physics,
         if (value >= table[imax]) return imax;
 
         /* Bracket the value. */
-        int i1 = 0, i2 = imax;
-        table_bracket(table, value, &i1, &i2);
+        int i1;
+        if (table == physics->table_K) {
+                i1 = table_index_log(physics, value);
+        } else {
+                int i2 = imax;
+                i1 = 0;
+                table_bracket(table, value, &i1, &i2);
+        }
 
         if (context != NULL) {
                 /* Update the last used indices. */
@@ -4284,6 +4511,72 @@ int table_index(const struct pumas_physics * physics,
         return i1;
 }
 
+/**
+ * Find the index closest to `value`, from below, in the kinetic energy table.
+ *
+ * @param Physics Handle for physics tables.
+ * @param value   The kinetic energy to bracket.
+ * @return The closest index from below.
+ *
+ * The kinetic energy grid is log-spaced by construction. The log-uniform bin
+ * of `value` is computed arithmetically, then the index is resolved within
+ * the rows spanned by that bin, linearly or by dichotomy for irregular
+ * segments of the grid. **Warning** : `value` must be in the range of the
+ * table.
+ */
+int table_index_log(const struct pumas_physics * physics, double value)
+{
+        const double * table = physics->table_K;
+        if (value < table[1]) return 0;
+
+        const double u =
+            (log(value) - physics->table_K_log_min) * physics->table_K_log_scale;
+        int bin = (u <= 0.) ? 0 : (int)u;
+        if (bin >= TABLE_K_LOG_BINS) bin = TABLE_K_LOG_BINS - 1;
+
+        /* Guard against rounding errors at the bin edges. */
+        int i1 = physics->table_K_log_bin[bin];
+        while (value < table[i1]) i1--;
+        int i2 = physics->table_K_log_bin[bin + 1] + 1;
+        const int imax = physics->n_energies - 1;
+        if (i2 > imax) i2 = imax;
+        while (value >= table[i2]) i2++;
+
+        if (i2 - i1 > TABLE_K_LOG_SCAN) {
+                table_bracket(table, value, &i1, &i2);
+        } else {
+                while (value >= table[i1 + 1]) i1++;
+        }
+        return i1;
+}
+
+/**
+ * Map the kinetic energy grid to log-uniform bins.
+ *
+ * @param Physics Handle for physics tables.
+ *
+ * Tabulate, for each log-uniform bin spanning the non null kinetic energies,
+ * the closest grid index from below its lower edge. See `table_index_log`.
+ */
+void table_index_log_initialise(struct pumas_physics * physics)
+{
+        const double * table = physics->table_K;
+        const int imax = physics->n_energies - 1;
+        const double log_min = log(table[1]);
+        const double log_max = log(table[imax]);
+        const double dlog = (log_max - log_min) / TABLE_K_LOG_BINS;
+        physics->table_K_log_min = log_min;
+        physics->table_K_log_scale = 1. / dlog;
+
+        int i = 1, bin;
+        for (bin = 0; bin <= TABLE_K_LOG_BINS; bin++) {
+                const double edge = (bin == TABLE_K_LOG_BINS) ?
+                    table[imax] : exp(log_min + bin * dlog);
+                while ((i < imax) && (table[i + 1] <= edge)) i++;
+                physics->table_K_log_bin[bin] = i;
+        }
+}
+
 /**
  * Recursive bracketing of a table value.
  *
@@ -4860,10 +5153,9 @@ enum pumas_event transport_with_csda(const struct pumas_physics * physics,
         const double ki = state->energy;
         const double di = state->distance;
         const double ti = state->time;
-        const double xi =
-            cel_grammage(physics, context, PUMAS_MODE_CSDA, material, ki);
-        const double Ti =
-            cel_proper_time(physics, context, PUMAS_MODE_CSDA, material, ki);
+        double xi, Ti;
+        cel_grammage_and_proper_time(
+            physics, context, PUMAS_MODE_CSDA, material, ki, &xi, &Ti);
 
         /* Register the start of the the track, if recording. */
         enum pumas_event event = PUMAS_EVENT_NONE;
@@ -5302,9 +5594,10 @@ enum pumas_event transport_with_stepping(const struct pumas_physics * physics,
         double dei, Xf;
         if (scheme > PUMAS_MODE_DISABLED) {
                 const double ki = state->energy;
-                Xf = cel_grammage(physics, context, scheme, material, ki);
-                dei = 1. /
-                    cel_energy_loss(physics, context, scheme, material, ki);
+                double dedx;
+                cel_grammage_and_energy_loss(
+                    physics, context, scheme, material, ki, &Xf, &dedx);
+                dei = 1. / dedx;
 
         } else {
                 Xf = dei = 0.;
@@ -9644,7 +9937,7 @@ enum pumas_return compute_composite(
         compute_regularise_del(physics, material);
         compute_cel_integrals(physics, material);
         compute_csda_magnetic_transport(physics, material);
-        return compute_scattering(physics, material, error_);
+        return compute_scattering(physics, material, 1, error_);
 }
 
 /**
@@ -9671,15 +9964,51 @@ void compute_cel_integrals(struct pumas_physics * physics, int material)
  * @param Physics  Handle for physics tables.
  * @param material The index of the material to tabulate.
  */
-enum pumas_return compute_scattering(
-    struct pumas_physics * physics, int material, struct error_context * error_)
+enum pumas_return compute_scattering(struct pumas_physics * physics,
+    int material, int n_threads, struct error_context * error_)
 {
-        int ikin;
-        for (ikin = 0; ikin < physics->n_energies; ikin++) {
-                const enum pumas_return rc = compute_scattering_parameters(
-                    physics, material, ikin, error_);
-                if (rc != PUMAS_RETURN_SUCCESS) return rc;
+        /* The soft scattering table of atomic elements is shared by all rows.
+         * Allocate it before spreading the rows over threads.
+         */
+        if ((material == 0) &&
+            (compute_msc_soft(physics, 0, NULL, error_) !=
+                PUMAS_RETURN_SUCCESS))
+                return error_->code;
+
+        /* Rows are independent, tabulate them concurrently. */
+        enum pumas_return rc = PUMAS_RETURN_SUCCESS;
+#ifdef _OPENMP
+        if (n_threads <= 0) n_threads = omp_get_max_threads();
+#pragma omp parallel num_threads(n_threads)
+#endif
+        {
+                struct error_context thread_error = *error_;
+                int ikin;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+                for (ikin = 0; ikin < physics->n_energies; ikin++) {
+                        if (thread_error.code != PUMAS_RETURN_SUCCESS)
+                                continue;
+                        compute_scattering_parameters(
+                            physics, material, ikin, &thread_error);
+                }
+
+                /* Free the thread workspace. */
+                compute_scattering_parameters(physics, -1, -1, &thread_error);
+                if (thread_error.code != PUMAS_RETURN_SUCCESS) {
+#ifdef _OPENMP
+#pragma omp critical(pumas_compute_scattering)
+#endif
+                        {
+                                if (rc == PUMAS_RETURN_SUCCESS) {
+                                        rc = thread_error.code;
+                                        *error_ = thread_error;
+                                }
+                        }
+                }
         }
+        if (rc != PUMAS_RETURN_SUCCESS) return rc;
         compute_pchip_scattering_coeffs(physics, material);
         compute_kinetic_integral(physics,
             table_get_NI_el(physics, PUMAS_MODE_CSDA, material, 0),
@@ -9933,7 +10262,7 @@ void compute_kinetic_integral(
  */
 void compute_time_integrals(struct pumas_physics * physics, int material)
 {
-        static double I0 = 0.;
+        static THREAD_LOCAL double I0 = 0.;
         if (I0 == 0.) {
                 /* Compute the integral of 1/momemtum for the lowest energy bin
                  * using trapezes. */
@@ -10409,7 +10738,7 @@ enum pumas_return compute_scattering_parameters(struct pumas_physics * physics,
     int material, int row, struct error_context * error_)
 {
         /* Handle the memory for the temporary workspace. */
-        static struct coulomb_workspace * workspace = NULL;
+        static THREAD_LOCAL struct coulomb_workspace * workspace = NULL;
         if (material < 0) {
                 deallocate(workspace);
                 workspace = NULL;
@@ -10530,15 +10859,14 @@ enum pumas_return compute_scattering_parameters(struct pumas_physics * physics,
         /* Compute the 1st moment of the soft scattering. */
         const int n0 = physics->n_materials - physics->n_composites;
         if (material < n0) {
-                /* We have a base material. */
-                static double * ms1_table = NULL;
-                if (material == 0) {
-                        /* Precompute the per element soft scattering terms. */
-                        enum pumas_return rc;
-                        if ((rc = compute_msc_soft(physics, row, &ms1_table,
-                                 error_)) != PUMAS_RETURN_SUCCESS)
-                                return rc;
-                }
+                /* We have a base material. The per element soft scattering
+                 * terms are precomputed along with the first material.
+                 */
+                double * ms1_table = NULL;
+                enum pumas_return rc;
+                if ((rc = compute_msc_soft(physics, (material == 0) ? row : 0,
+                         &ms1_table, error_)) != PUMAS_RETURN_SUCCESS)
+                        return rc;
 
                 double invlb1 = 0., invlb1_csda = 0., invlb1_hybrid = 0.;
                 struct material_component * component =
@@ -10643,7 +10971,10 @@ enum pumas_return compute_scattering_parameters(struct pumas_physics * physics,
  * length.
  *
  * **Note** This routine handles a static dynamically allocated table. If the
- * *row* index is negative the table is freed.
+ * *row* index is negative the table is freed. The first row, of null kinetic
+ * energy, is not tabulated. Requesting it only allocates the table, if needed,
+ * and returns it. Distinct rows can be tabulated concurrently once the table
+ * is allocated.
  */
 enum pumas_return compute_msc_soft(struct pumas_physics * physics, int row,
     double ** data, struct error_context * error_)
@@ -10663,6 +10994,8 @@ enum pumas_return compute_msc_soft(struct pumas_physics * physics, int row,
                     physics->n_energies * sizeof(double));
                 if (ms1_table == NULL) return ERROR_REGISTER_MEMORY();
         }
+        if (data != NULL) *data = ms1_table;
+        if (row == 0) return PUMAS_RETURN_SUCCESS;
 
         /* Loop over atomic elements. */
         const double kinetic = *table_get_K(physics, row);
@@ -10693,7 +11026,6 @@ enum pumas_return compute_msc_soft(struct pumas_physics * physics, int row,
                         invlb1_hybrid;
         }
 
-        *data = ms1_table;
         return PUMAS_RETURN_SUCCESS;
 }
 
@@ -10767,7 +11099,7 @@ double compute_cutoff_objective(
  */
 double * compute_cel_and_del(struct pumas_physics * physics, int row)
 {
-        static double * cel_table = NULL;
+        static THREAD_LOCAL double * cel_table = NULL;
 
         if (row < 0) {
                 deallocate(cel_table);
@@ -11693,7 +12025,7 @@ static void dcs_tabulate_envelope_row(
 enum pumas_return compute_dcs_table(
     struct pumas_physics * physics, int element, struct error_context * error_)
 {
-        static struct dcs_tabulate_work * work = NULL;
+        static THREAD_LOCAL struct dcs_tabulate_work * work = NULL;
         if (element < 0) {
                 /* Free the temporary work data */
                 deallocate(work);
@@ -11782,6 +12114,56 @@ enum pumas_return compute_dcs_table(
         return PUMAS_RETURN_SUCCESS;
 }
 
+/**
+ * Tabulate the DCSs for radiative processes, for all atomic elements.
+ *
+ * @param physcis    The physics handle.
+ * @param n_threads  The number of threads, or the OpenMP default if not
+ *                   positive.
+ * @param error_     The error stream
+ * @return On success `PUMAS_RETURN_SUCCESS` is returned otherwise a memory
+ * error.
+ *
+ * Atomic elements are tabulated concurrently, each thread using its own work
+ * data. The tables are identical to a serial tabulation.
+ */
+enum pumas_return compute_dcs_tables(
+    struct pumas_physics * physics, int n_threads, struct error_context * error_)
+{
+        enum pumas_return rc = PUMAS_RETURN_SUCCESS;
+#ifdef _OPENMP
+        if (n_threads <= 0) n_threads = omp_get_max_threads();
+#pragma omp parallel num_threads(n_threads)
+#endif
+        {
+                struct error_context thread_error = *error_;
+                int iel;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+                for (iel = 0; iel < physics->n_elements; iel++) {
+                        if (thread_error.code != PUMAS_RETURN_SUCCESS)
+                                continue;
+                        compute_dcs_table(physics, iel, &thread_error);
+                }
+
+                /* Free the thread work data. */
+                compute_dcs_table(physics, -1, &thread_error);
+                if (thread_error.code != PUMAS_RETURN_SUCCESS) {
+#ifdef _OPENMP
+#pragma omp critical(pumas_compute_dcs_tables)
+#endif
+                        {
+                                if (rc == PUMAS_RETURN_SUCCESS) {
+                                        rc = thread_error.code;
+                                        *error_ = thread_error;
+                                }
+                        }
+                }
+        }
+        return rc;
+}
+
 /*
  * Low level routines: sampling of the polar angle in a DEL.
  *
@@ -12481,13 +12863,13 @@ int math_gauss_quad(int n, double * p1, double * p2)
  * https://pomax.github.io/bezierinfo/legendre-gauss.html.
  */
 #define N_GQ 6
-        static const double * xGQ = NULL;
-        static const double * wGQ = NULL;
+        static THREAD_LOCAL const double * xGQ = NULL;
+        static THREAD_LOCAL const double * wGQ = NULL;
 
         /* Initialisation step. */
-        static int i, j, n_itv;
-        static double h;
-        static double x0;
+        static THREAD_LOCAL int i, j, n_itv;
+        static THREAD_LOCAL double h;
+        static THREAD_LOCAL double x0;
         if (n > 0) {
                 if (xGQ == NULL)
                         math_gauss_quad_coefficients(N_GQ, &xGQ, &wGQ);
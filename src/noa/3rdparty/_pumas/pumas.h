@@ -812,6 +812,15 @@ struct pumas_physics_settings {
          * pointer provided by `pumas_physics_create` points to `NULL`.
          */
         int dry;
+        /** The number of threads used for tabulating the physics.
+         *
+         * Kinetic energy rows of the scattering tables and atomic elements of
+         * the DCS tables are distributed over threads. The resulting tables
+         * are identical to a serial tabulation. Providing a value of zero or
+         * less results in the OpenMP default to be used. This setting has no
+         * effect if PUMAS is compiled without OpenMP.
+         */
+        int n_threads;
 };
 
 /**
@@ -980,6 +989,49 @@ PUMAS_API enum pumas_return pumas_physics_dump(
 PUMAS_API enum pumas_return pumas_physics_load(
     struct pumas_physics ** physics, FILE * stream);
 
+/**
+ * Map the physics tables onto a binary dump held in memory.
+ *
+ * @param physics   The physics tables.
+ * @param buffer    The binary dump, e.g. a memory mapped file.
+ * @param size      The size of the buffer, in bytes.
+ * @return On success `PUMAS_RETURN_SUCCESS` is returned otherwise an error
+ * code is returned as detailed below.
+ *
+ * Initialise the physics in place, from a binary dump previously generated
+ * with `pumas_physics_dump`, without copying the tables. Only the internal
+ * addresses are updated, i.e. the header of the physics and a few small
+ * index arrays are written to. With a private (copy on write) file mapping
+ * the bulk of the tables thus stays shared between processes.
+ *
+ * __Note__: the buffer must outlive the physics and be aligned as a `double`.
+ * The physics must not be destroyed with `pumas_physics_destroy`, release the
+ * buffer instead.
+ *
+ * __Error codes__
+ *
+ *     PUMAS_RETURN_FORMAT_ERROR            The binary dump is not compatible
+ * with the current version, or truncated.
+ *
+ *     PUMAS_RETURN_PHYSICS_ERROR           The physics is not initialised.
+ *
+ *     PUMAS_RETURN_PATH_ERROR              The buffer is invalid (null).
+ */
+PUMAS_API enum pumas_return pumas_physics_map(
+    struct pumas_physics ** physics, void * buffer, size_t size);
+
+/**
+ * Get the format of the binary dumps.
+ *
+ * @param tag       The version tag of the dumps, or `NULL`.
+ * @param layout    The byte sizes of the dumped structures, or `NULL`.
+ *
+ * The sizes are, in order, those of the physics, of an atomic element, of a
+ * material component, of a composite component and of a composite material.
+ * A dump can only be mapped by a build with the same tag and layout.
+ */
+PUMAS_API void pumas_physics_dump_format(int * tag, size_t layout[5]);
+
 /**
  * Get the cutoff value used by the physics.
  *
@@ -1313,6 +1365,20 @@ PUMAS_API enum pumas_return pumas_context_random_load(
 PUMAS_API enum pumas_return pumas_context_random_dump(
     struct pumas_context * context, FILE * stream);
 
+/**
+ * Reset the Gaussian transform of the random stream of a simulation context.
+ *
+ * @param context         The simulation context.
+ *
+ * Gaussian variates are generated in pairs from the *random* callback. This
+ * function discards any pending variate, such that the next Gaussian draw
+ * only depends on the subsequent uniform draws. It should be called whenever
+ * the *random* callback is rewound, e.g. when replaying a counter based
+ * stream for a given primary.
+ */
+PUMAS_API void pumas_context_random_reset_randn(
+    struct pumas_context * context);
+
 /**
  * Destroy a simulation context.
  *
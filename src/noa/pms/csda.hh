@@ -0,0 +1,283 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * \file csda.hh
+ * Stopping power and range tables in the Continuous Slowing Down Approximation (CSDA)
+ *
+ * Tables are built from the DCS of noa::pms::dcs, without a PUMAS physics instance.
+ * Grammages are in kg/m^2 and stopping powers in GeV m^2/kg.
+ */
+
+#pragma once
+
+#include "noa/pms/dcs.hh"
+#include "noa/pms/physics.hh"
+#include "noa/utils/common.hh"
+#include "noa/utils/numerics.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace noa::pms::csda {
+
+    using StoppingPower = Scalar;
+    using Grammage = Scalar;
+    using MassFractions = std::vector<Scalar>;
+
+    /// File layout:
+    ///   header: MAGIC (8 bytes), VERSION (uint32), n (uint32), then mass, log(K) min and step (double)
+    ///   rows of n doubles: log of the stopping power, CSDA grammage and proper time grammage
+    inline constexpr char MAGIC[8] = {'N', 'O', 'A', 'R', 'A', 'N', 'G', 'E'};
+    inline constexpr uint32_t VERSION = 1;
+
+    /// Radiative energy loss per unit grammage, from energy transfers within [xlow * K, K]
+    ///
+    /// Sums the CEL integrals of bremsstrahlung, pair production and photonuclear interactions.
+    /// The CSDA takes the whole spectrum, xlow = dcs::X_FRACTION gives the share of discrete losses.
+    inline StoppingPower radiative_loss(const Energy &kinetic_energy,
+                                        const AtomicElement &element,
+                                        const ParticleMass &mass,
+                                        const EnergyTransfer &xlow = 1E-06,
+                                        const Index min_points = 480) {
+        const Scalar cel =
+                dcs::recoil_integral(dcs::bremsstrahlung, dcs::cel_integrand)(
+                        kinetic_energy, xlow, element, mass, min_points) +
+                dcs::recoil_integral(dcs::pair_production, dcs::cel_integrand)(
+                        kinetic_energy, xlow, element, mass, min_points) +
+                dcs::recoil_integral(dcs::photonuclear, dcs::cel_integrand)(
+                        kinetic_energy, xlow, element, mass, min_points);
+        return (kinetic_energy + mass) * cel;
+    }
+
+    /// Stopping power of a material: its electronic loss, plus the radiative losses of its elements
+    ///
+    /// The electronic loss (e.g. from the dE/dX tables used by PUMAS) is a function of the kinetic energy,
+    /// copied into the returned function, so that temporaries can be passed.
+    template<typename ElectronicLoss>
+    inline auto material_stopping_power(const std::vector<AtomicElement> &elements,
+                                        const MassFractions &fractions,
+                                        const ParticleMass &mass,
+                                        const ElectronicLoss &electronic_loss,
+                                        const EnergyTransfer &xlow = 1E-06,
+                                        const Index min_points = 480) {
+        return [elements, fractions, mass, electronic_loss, xlow, min_points](const Energy &kinetic_energy) {
+            StoppingPower loss = electronic_loss(kinetic_energy);
+            for (std::size_t iel = 0; iel < elements.size(); iel++)
+                loss += fractions[iel] * radiative_loss(kinetic_energy, elements[iel], mass, xlow, min_points);
+            return loss;
+        };
+    }
+
+    class LossTable;
+
+    using LossTableOpt = std::optional<LossTable>;
+
+    /// Tabulated stopping power, CSDA grammage (range) and proper time grammage over log(K)
+    ///
+    /// Tables are cumulated with Simpson's rule over a uniform log grid, starting from the
+    /// low energy limit of a stopping power ~ 1 / K. Queries interpolate the logarithms with
+    /// monotone cubic Hermite splines (PCHIP), in constant time for the energy. The proper time
+    /// grammage integrates m / p over the grammage: divided by the density it gives c * tau.
+    class LossTable {
+        ParticleMass mass;
+
+        Scalar x_min, x_step;
+        Index n;
+
+        Tabulation table;  // [3, n] logs of the stopping power, CSDA grammage and proper time grammage
+        Tabulation slopes; // [4, n] PCHIP slopes of the rows of the table, then of log(K) over log(X)
+        const Scalar *ptab{nullptr};
+        const Scalar *pslope{nullptr};
+
+        LossTable(const ParticleMass &mass_, const Scalar &x_min_, const Scalar &x_step_,
+                  const Index n_, const Tabulation &table_)
+                : mass{mass_}, x_min{x_min_}, x_step{x_step_}, n{n_}, table{table_} {
+            const auto x = torch::arange(n, torch::dtype(torch::kDouble)) * x_step + x_min;
+            slopes = torch::empty({4, n}, torch::dtype(torch::kDouble));
+            ptab = table.data_ptr<Scalar>();
+            pslope = slopes.data_ptr<Scalar>();
+
+            const Scalar *px = x.data_ptr<Scalar>();
+            Scalar *ps = slopes.data_ptr<Scalar>();
+            for (Index row = 0; row < 3; row++)
+                utils::numerics::pchip_slopes(px, ptab + row * n, n, ps + row * n);
+            utils::numerics::pchip_slopes(ptab + n, px, n, ps + 3 * n);
+        }
+
+        inline Scalar interpolate(const Index row, const Scalar &x) const {
+            const Scalar *y = ptab + row * n;
+            const Scalar *d = pslope + row * n;
+            const Scalar fx = (x - x_min) / x_step;
+            if (fx <= 0.)
+                return y[0] + d[0] * (x - x_min);
+            if (fx >= n - 1)
+                return y[n - 1] + d[n - 1] * (x - x_min - (n - 1) * x_step);
+            const auto i = static_cast<Index>(fx);
+            return utils::numerics::hermite(fx - i, y[i], y[i + 1], d[i] * x_step, d[i + 1] * x_step);
+        }
+
+    public:
+        /// Tabulates the stopping power function over n kinetic energies, log spaced
+        ///
+        /// The stopping power is evaluated at the nodes and at the middle of the cells, in parallel.
+        template<typename StoppingPowerFunc>
+        LossTable(const ParticleMass &mass_,
+                  const StoppingPowerFunc &stopping_power,
+                  const Energy &kinetic_min = 1E-03,
+                  const Energy &kinetic_max = 1E+06,
+                  const Index n_ = 241)
+                : LossTable(mass_, log(kinetic_min), (log(kinetic_max) - log(kinetic_min)) / (n_ - 1), n_,
+                            tabulate(mass_, stopping_power, log(kinetic_min),
+                                     (log(kinetic_max) - log(kinetic_min)) / (n_ - 1), n_)) {}
+
+        template<typename StoppingPowerFunc>
+        inline static Tabulation tabulate(const ParticleMass &mass,
+                                          const StoppingPowerFunc &stopping_power,
+                                          const Scalar &x_min,
+                                          const Scalar &x_step,
+                                          const Index n) {
+            if (n < 3)
+                throw std::runtime_error("LossTable: at least 3 kinetic energies are required");
+
+            // Integrands over x = log(K) at the nodes (even) and middles (odd)
+            const Index m = 2 * n - 1;
+            auto loss = std::vector<Scalar>(m);
+            auto grammage = std::vector<Scalar>(m);
+            auto time = std::vector<Scalar>(m);
+            utils::pfor(m, [&](const int64_t k) {
+                const Energy K = exp(x_min + 0.5 * k * x_step);
+                loss[k] = stopping_power(K);
+                grammage[k] = K / loss[k];
+                time[k] = mass * grammage[k] / sqrt(K * (K + 2. * mass));
+            });
+            for (const auto &s: loss)
+                if (!(s > 0.) || !std::isfinite(s))
+                    throw std::runtime_error("LossTable: the stopping power must be positive");
+
+            auto result = torch::empty({3, n}, torch::dtype(torch::kDouble));
+            Scalar *pS = result.data_ptr<Scalar>();
+            Scalar *pX = pS + n;
+            Scalar *pT = pX + n;
+
+            // Below the grid, S ~ 1 / K and p ~ sqrt(2 m K)
+            Grammage X = 0.5 * grammage[0];
+            Grammage T = 2. / 3. * time[0];
+            for (Index i = 0; i < n; i++) {
+                if (i > 0) {
+                    X += x_step / 6. * (grammage[2 * i - 2] + 4. * grammage[2 * i - 1] + grammage[2 * i]);
+                    T += x_step / 6. * (time[2 * i - 2] + 4. * time[2 * i - 1] + time[2 * i]);
+                }
+                pS[i] = log(loss[2 * i]);
+                pX[i] = log(X);
+                pT[i] = log(T);
+            }
+            return result;
+        }
+
+        inline StoppingPower stopping_power(const Energy &kinetic_energy) const {
+            return exp(interpolate(0, log(kinetic_energy)));
+        }
+
+        /// CSDA range, the grammage needed to stop
+        inline Grammage range(const Energy &kinetic_energy) const {
+            return exp(interpolate(1, log(kinetic_energy)));
+        }
+
+        inline Grammage proper_time(const Energy &kinetic_energy) const {
+            return exp(interpolate(2, log(kinetic_energy)));
+        }
+
+        /// Kinetic energy with a CSDA range of the given grammage, inverse of range
+        inline Energy kinetic_energy(const Grammage &grammage) const {
+            const Scalar *lX = ptab + n;
+            const Scalar *d = pslope + 3 * n;
+            const Scalar lx = log(grammage);
+            if (lx <= lX[0])
+                return exp(x_min + d[0] * (lx - lX[0]));
+            if (lx >= lX[n - 1])
+                return exp(x_min + (n - 1) * x_step + d[n - 1] * (lx - lX[n - 1]));
+            const auto i = static_cast<Index>(std::upper_bound(lX, lX + n, lx) - lX - 1);
+            const Scalar h = lX[i + 1] - lX[i];
+            return exp(utils::numerics::hermite((lx - lX[i]) / h,
+                                                x_min + i * x_step, x_min + (i + 1) * x_step,
+                                                d[i] * h, d[i + 1] * h));
+        }
+
+        /// Energy left after crossing a grammage, zero if the particle stops
+        inline Energy energy_after(const Energy &kinetic_energy, const Grammage &grammage) const {
+            const Grammage X = range(kinetic_energy) - grammage;
+            return (X > 0.) ? this->kinetic_energy(X) : 0.;
+        }
+
+        inline Energies kinetic_energies() const {
+            return torch::exp(torch::arange(n, torch::dtype(torch::kDouble)) * x_step + x_min);
+        }
+
+        inline const Tabulation &log_table() const { return table; }
+
+        inline ParticleMass get_mass() const { return mass; }
+
+        inline utils::Status save(const utils::Path &path) const {
+            auto stream = std::ofstream{path, std::ios::binary | std::ios::trunc};
+            if (!stream.is_open()) {
+                std::cerr << "Failed to open " << path << "\n";
+                return false;
+            }
+            const auto size = static_cast<uint32_t>(n);
+            const Scalar header[3] = {mass, x_min, x_step};
+            stream.write(MAGIC, sizeof(MAGIC));
+            stream.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+            stream.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+            stream.write(reinterpret_cast<const char *>(ptab), 3 * n * sizeof(Scalar));
+            return static_cast<bool>(stream);
+        }
+
+        inline static LossTableOpt load(const utils::Path &path) {
+            if (!utils::check_path_exists(path)) return std::nullopt;
+
+            auto stream = std::ifstream{path, std::ios::binary};
+            char magic[sizeof(MAGIC)];
+            uint32_t version = 0, size = 0;
+            Scalar header[3];
+            stream.read(magic, sizeof(magic));
+            stream.read(reinterpret_cast<char *>(&version), sizeof(version));
+            stream.read(reinterpret_cast<char *>(&size), sizeof(size));
+            stream.read(reinterpret_cast<char *>(header), sizeof(header));
+            if (!stream || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION || size < 3) {
+                std::cerr << "Invalid loss table " << path << "\n";
+                return std::nullopt;
+            }
+
+            const auto n = static_cast<Index>(size);
+            auto table = torch::empty({3, n}, torch::dtype(torch::kDouble));
+            stream.read(reinterpret_cast<char *>(table.data_ptr<Scalar>()), 3 * n * sizeof(Scalar));
+            if (!stream) {
+                std::cerr << "Truncated loss table " << path << "\n";
+                return std::nullopt;
+            }
+            return LossTable{header[0], header[1], header[2], n, table};
+        }
+    };
+
+} // namespace noa::pms::csda
@@ -26,11 +26,18 @@
 #include "noa/pms/physics.hh"
 #include "noa/utils/common.hh"
 #include "noa/utils/numerics.hh"
+#include "noa/utils/simd.hh"
 
 #include <torch/types.h>
 
+#include <vector>
+
 namespace noa::pms::dcs {
 
+    // Batch kernels evaluate the DCS over several energies at once, see noa::pms::dcs::simd
+    using Lanes = utils::simd::Pack<Scalar>;
+    using LanesMask = Lanes::mask_type;
+
 
     template<typename DCSFunc>
     inline auto vmap(const DCSFunc &dcs_func) {
@@ -141,12 +148,13 @@ namespace noa::pms::dcs {
 
 #endif
 
-    inline const auto pair_production = [](const Energy &kinetic_energy,
+    // Inner integral of the pair production DCS, over the asymmetry of the pair.
+    // Nested quadrature, the reference for PairProductionTable
+    inline Scalar pair_production_integral(const Energy &kinetic_energy,
                                            const Energy &recoil_energy,
                                            const AtomicElement &element,
                                            const ParticleMass &mass) {
         const Index Z = element.Z;
-        const Scalar A = element.A;
         // Check the bounds of the energy transfer
         if (recoil_energy <= 4. * ELECTRON_MASS)
             return 0.;
@@ -226,6 +234,20 @@ namespace noa::pms::dcs {
             return -(Phi_e + Phi_mu / (r * r)) * (1. - rho) * tmin;
         });
 
+        return I;
+    }
+
+    // Pair production DCS given its inner integral
+    inline Scalar pair_production_dcs(const Energy &kinetic_energy,
+                                      const Energy &recoil_energy,
+                                      const Scalar &I,
+                                      const AtomicElement &element,
+                                      const ParticleMass &mass) {
+        const Index Z = element.Z;
+        const Scalar A = element.A;
+        const Scalar Z13 = pow(Z, 1. / 3.);
+        const Scalar gamma = 1. + kinetic_energy / mass;
+
         // Atomic electrons form factor
         Scalar zeta;
         if (gamma <= 35.)
@@ -255,10 +277,146 @@ namespace noa::pms::dcs {
         const Scalar dcs = 1.794664E-34 * Z * (Z + zeta) * (E - recoil_energy) * I /
                            (recoil_energy * E);
         return (dcs < 0.) ? 0. : dcs * 1E+03 * AVOGADRO_NUMBER * (mass + kinetic_energy) / A;
+    }
+
+    inline const auto pair_production = [](const Energy &kinetic_energy,
+                                           const Energy &recoil_energy,
+                                           const AtomicElement &element,
+                                           const ParticleMass &mass) {
+        const Scalar I = pair_production_integral(kinetic_energy, recoil_energy, element, mass);
+        return (I == 0.) ? 0. : pair_production_dcs(kinetic_energy, recoil_energy, I, element, mass);
     };
 
+    /// Tabulated pair production DCS, for a given element and projectile mass
+    ///
+    /// The inner integral is tabulated over the reduced variables x = log(K) and
+    /// u = log(q / q_min) / log(q_max / q_min), with [q_min, q_max] the kinematic range of
+    /// the energy transfer, and interpolated with bicubic (Catmull-Rom) splines in log scale.
+    /// When the table is built, every cell is checked against pair_production_integral at
+    /// 3x3 interior sample points only, with half the relative tolerance as a margin: this is
+    /// a spot check, not an error bound over the cell. Cells failing it, mostly along the
+    /// kinematic bounds, fall back on the nested quadrature, as do energies out of the table.
+    class PairProductionTable {
+        AtomicElement element;
+        ParticleMass mass;
+
+        Scalar x_min, x_step;
+        Index nx;
+        Scalar u_step;
+        Index nu;
+        Energy q_min;   // Lower bound of the energy transfer
+        Energy q_shift; // Upper bound of the energy transfer, less the kinetic energy
+
+        Tabulation log_integral; // [nx, nu] nodes, NaN where the integral vanishes
+        Tabulation tabulated;    // [nx - 1, nu - 1] cells passing the check at sample points
+        const Scalar *plog{nullptr};
+        const bool *ptab{nullptr};
+
+        // Cubic Lagrange interpolation over nodes -1, 0, 1, 2
+        inline static Scalar cubic(const Scalar *p, const Scalar t) {
+            const Scalar tm = t - 1., tp = t + 1., tmm = t - 2.;
+            return (-t * tm * tmm * p[0] + t * tp * tm * p[3]) / 6. +
+                   (tp * tm * tmm * p[1] - tp * t * tmm * p[2]) / 2.;
+        }
+
+        inline Scalar energy_transfer(const Energy &kinetic_energy, const Scalar &u) const {
+            return q_min * exp(u * log((kinetic_energy + q_shift) / q_min));
+        }
+
+        // Interpolation in cell (i, j) at fractional position (tx, tu)
+        inline Scalar interpolate(const Index i, const Index j, const Scalar tx, const Scalar tu) const {
+            Scalar rows[4];
+            for (Index a = 0; a < 4; a++)
+                rows[a] = cubic(plog + (i - 1 + a) * nu + j - 1, tu);
+            return exp(cubic(rows, tx));
+        }
+
+    public:
+        /// \param kinetic_min, kinetic_max Range of the kinetic energies tabulated
+        /// \param nx_, nu_ Number of nodes over log(K) and u
+        /// \param tolerance Sampled target on the relative error of the interpolation, not a bound:
+        ///        a cell is interpolated if it is within half of it at its 3x3 sample points, and the
+        ///        error may exceed it between them
+        PairProductionTable(const AtomicElement &element_,
+                            const ParticleMass &mass_,
+                            const Energy &kinetic_min = 1E-01,
+                            const Energy &kinetic_max = 1E+07,
+                            const Index nx_ = 192,
+                            const Index nu_ = 192,
+                            const Scalar &tolerance = 1E-06)
+                : element{element_}, mass{mass_},
+                  x_min{log(kinetic_min)}, x_step{(log(kinetic_max) - log(kinetic_min)) / (nx_ - 1)}, nx{nx_},
+                  u_step{1. / (nu_ - 1)}, nu{nu_},
+                  q_min{4. * ELECTRON_MASS},
+                  q_shift{mass_ * (1. - 0.75 * 1.6487212707 * pow(element_.Z, 1. / 3.))} {
+            const auto options = torch::dtype(torch::kDouble);
+            log_integral = torch::empty({nx, nu}, options);
+            tabulated = torch::zeros({nx - 1, nu - 1}, torch::dtype(torch::kBool));
+            plog = log_integral.data_ptr<Scalar>();
+            ptab = tabulated.data_ptr<bool>();
+
+            Scalar *pnodes = log_integral.data_ptr<Scalar>();
+#pragma omp parallel for
+            for (Index i = 0; i < nx; i++) {
+                const Energy K = exp(x_min + i * x_step);
+                for (Index j = 0; j < nu; j++) {
+                    const Scalar I = pair_production_integral(K, energy_transfer(K, j * u_step), element, mass);
+                    pnodes[i * nu + j] = (I > 0. && std::isfinite(I)) ? log(I) : NAN;
+                }
+            }
+
+            bool *pcells = tabulated.data_ptr<bool>();
+#pragma omp parallel for
+            for (Index i = 1; i < nx - 2; i++) {
+                for (Index j = 1; j < nu - 2; j++) {
+                    bool valid = true;
+                    for (Index a = i - 1; a <= i + 2; a++)
+                        for (Index b = j - 1; b <= j + 2; b++)
+                            valid &= std::isfinite(plog[a * nu + b]);
+                    for (Index a = 1; valid && a <= 3; a++) {
+                        const Energy K = exp(x_min + (i + 0.25 * a) * x_step);
+                        for (Index b = 1; valid && b <= 3; b++) {
+                            const Scalar I = pair_production_integral(
+                                    K, energy_transfer(K, (j + 0.25 * b) * u_step), element, mass);
+                            valid = (I > 0.) && (std::abs(interpolate(i, j, 0.25 * a, 0.25 * b) - I) <= 0.5 * tolerance * I);
+                        }
+                    }
+                    pcells[i * (nu - 1) + j] = valid;
+                }
+            }
+        }
+
+        /// Same as pair_production_integral, interpolated in the cells checked at sample points
+        inline Scalar integral(const Energy &kinetic_energy, const Energy &recoil_energy) const {
+            const Scalar fx = (log(kinetic_energy) - x_min) / x_step;
+            const Energy q_max = kinetic_energy + q_shift;
+            if (fx >= 1. && fx < nx - 2 && recoil_energy > q_min && recoil_energy < q_max) {
+                const Scalar fu = log(recoil_energy / q_min) / (log(q_max / q_min) * u_step);
+                const auto i = static_cast<Index>(fx);
+                const auto j = static_cast<Index>(fu);
+                if (j >= 1 && j < nu - 2 && ptab[i * (nu - 1) + j])
+                    return interpolate(i, j, fx - i, fu - j);
+            }
+            return pair_production_integral(kinetic_energy, recoil_energy, element, mass);
+        }
+
+        /// DCS function, for the element and mass of the table
+        inline Scalar operator()(const Energy &kinetic_energy,
+                                 const Energy &recoil_energy,
+                                 const AtomicElement &,
+                                 const ParticleMass &) const {
+            const Scalar I = integral(kinetic_energy, recoil_energy);
+            return (I == 0.) ? 0. : pair_production_dcs(kinetic_energy, recoil_energy, I, element, mass);
+        }
 
-    inline Scalar dcs_photonuclear_f2_allm(const Scalar x, const Scalar Q2) {
+        /// Fraction of the grid cells that are interpolated
+        inline Scalar coverage() const {
+            return tabulated.sum().item<Scalar>() / ((nx - 3) * (nu - 3));
+        }
+    };
+
+    template<typename Value>
+    inline Value dcs_photonuclear_f2_allm(const Value &x, const Value &Q2) {
         const Scalar m02 = 0.31985;
         const Scalar mP2 = 49.457;
         const Scalar mR2 = 0.15052;
@@ -286,22 +444,22 @@ namespace noa::pms::dcs {
         const Scalar bR3 = 0.49338;
 
         const Scalar M2 = 0.8803505929;
-        const Scalar W2 = M2 + Q2 * (1.0 / x - 1.0);
-        const Scalar t = log(log((Q2 + Q02) / Lambda2) / log(Q02 / Lambda2));
-        const Scalar xP = (Q2 + mP2) / (Q2 + mP2 + W2 - M2);
-        const Scalar xR = (Q2 + mR2) / (Q2 + mR2 + W2 - M2);
-        const Scalar lnt = log(t);
-        const Scalar cP =
+        const Value W2 = M2 + Q2 * (1.0 / x - 1.0);
+        const Value t = log(log((Q2 + Q02) / Lambda2) / log(Q02 / Lambda2));
+        const Value xP = (Q2 + mP2) / (Q2 + mP2 + W2 - M2);
+        const Value xR = (Q2 + mR2) / (Q2 + mR2 + W2 - M2);
+        const Value lnt = log(t);
+        const Value cP =
                 cP1 + (cP1 - cP2) * (1.0 / (1.0 + exp(cP3 * lnt)) - 1.0);
-        const Scalar aP =
+        const Value aP =
                 aP1 + (aP1 - aP2) * (1.0 / (1.0 + exp(aP3 * lnt)) - 1.0);
-        const Scalar bP = bP1 + bP2 * exp(bP3 * lnt);
-        const Scalar cR = cR1 + cR2 * exp(cR3 * lnt);
-        const Scalar aR = aR1 + aR2 * exp(aR3 * lnt);
-        const Scalar bR = bR1 + bR2 * exp(bR3 * lnt);
+        const Value bP = bP1 + bP2 * exp(bP3 * lnt);
+        const Value cR = cR1 + cR2 * exp(cR3 * lnt);
+        const Value aR = aR1 + aR2 * exp(aR3 * lnt);
+        const Value bR = bR1 + bR2 * exp(bR3 * lnt);
 
-        const Scalar F2P = cP * exp(aP * log(xP) + bP * log(1 - x));
-        const Scalar F2R = cR * exp(aR * log(xR) + bR * log(1 - x));
+        const Value F2P = cP * exp(aP * log(xP) + bP * log(1 - x));
+        const Value F2R = cR * exp(aR * log(xR) + bR * log(1 - x));
 
         return Q2 / (Q2 + m02) * (F2P + F2R);
     }
@@ -331,21 +489,49 @@ namespace noa::pms::dcs {
                 0.3534 / (0.09 + q2 * q2));
     }
 
+    template<typename Real, int W>
+    inline utils::simd::Pack<Real, W> dcs_photonuclear_f2a_drss(const utils::simd::Pack<Real, W> &x,
+                                                                const utils::simd::Pack<Real, W> &F2p,
+                                                                const Scalar A) {
+        using Lanes = utils::simd::Pack<Real, W>;
+        const Scalar lnA = log(A);
+        const Lanes a = select(x < 0.0014,
+                               Lanes{exp(-0.1 * lnA)},
+                               select(x < 0.04, exp((0.069 * log10(x) + 0.097) * lnA), Lanes{1.0}));
 
-    inline Scalar
-    dcs_photonuclear_d2(const Scalar A, const Scalar mass, const Scalar kinetic_energy, const Scalar recoil_energy,
-                        const Scalar Q2) {
-        const Scalar cf = 2.603096E-35;
+        return (0.5 * A * a *
+                (2.0 + x * (-1.85 + x * (2.45 + x * (-2.35 + x)))) * F2p);
+    }
+
+    template<typename Real, int W>
+    inline utils::simd::Pack<Real, W> dcs_photonuclear_r_whitlow(const utils::simd::Pack<Real, W> &x,
+                                                                 const utils::simd::Pack<Real, W> &Q2) {
+        using Lanes = utils::simd::Pack<Real, W>;
+        const Lanes q2 = max(Q2, Lanes{0.3});
+
+        const Lanes theta =
+                1 + 12.0 * q2 / (1.0 + q2) * 0.015625 / (0.015625 + x * x);
+
+        return (0.635 / log(q2 / 0.04) * theta + 0.5747 / q2 -
+                0.3534 / (0.09 + q2 * q2));
+    }
+
+
+    // The normalisation cf can absorb the macroscopic factors, keeping single precision away from underflow
+    template<typename Value>
+    inline Value
+    dcs_photonuclear_d2(const Scalar A, const Scalar mass, const Value &kinetic_energy, const Value &recoil_energy,
+                        const Value &Q2, const Scalar cf = 2.603096E-35) {
         const Scalar M = 0.931494;
-        const Scalar E = kinetic_energy + mass;
+        const Value E = kinetic_energy + mass;
 
-        const Scalar y = recoil_energy / E;
-        const Scalar x = 0.5 * Q2 / (M * recoil_energy);
-        const Scalar F2p = dcs_photonuclear_f2_allm(x, Q2);
-        const Scalar F2A = dcs_photonuclear_f2a_drss(x, F2p, A);
-        const Scalar R = dcs_photonuclear_r_whitlow(x, Q2);
+        const Value y = recoil_energy / E;
+        const Value x = 0.5 * Q2 / (M * recoil_energy);
+        const Value F2p = dcs_photonuclear_f2_allm(x, Q2);
+        const Value F2A = dcs_photonuclear_f2a_drss(x, F2p, A);
+        const Value R = dcs_photonuclear_r_whitlow(x, Q2);
 
-        const Scalar dds = (1 - y +
+        const Value dds = (1 - y +
                             0.5 * (1 - 2 * mass * mass / Q2) *
                             (y * y + Q2 / (E * E)) / (1 + R)) /
                            (Q2 * Q2) -
@@ -621,6 +807,31 @@ namespace noa::pms::dcs {
                 }
             };
 
+    inline const auto pcoulomb_data =
+            [](
+                    const CMLorentz &fCM,
+                    const ScreeningFactors &screening,
+                    const FSpins &fspin,
+                    const InvLambdas &invlambda,
+                    const Energies &kinetic_energies,
+                    const AtomicElement &element,
+                    const ParticleMass &mass,
+                    const Index grain = COULOMB_GRAIN) {
+                const Index nkin = kinetic_energies.numel();
+                auto *pK = kinetic_energies.data_ptr<Scalar>();
+
+                auto *pfCM = fCM.data_ptr<Scalar>();
+                auto *pscreen = screening.data_ptr<Scalar>();
+                auto *pfspin = fspin.data_ptr<Scalar>();
+                auto *pinvlbd = invlambda.data_ptr<Scalar>();
+
+                utils::pfor(nkin, [&](const int64_t i) {
+                    const Scalar kinetic0 = coulomb_frame_parameters(pfCM + 2 * i, pK[i], element, mass);
+                    pfspin[i] = coulomb_spin_factor(kinetic0, mass);
+                    pinvlbd[i] = coulomb_screening_parameters(pscreen + NSF * i, kinetic0, element, mass);
+                }, grain);
+            };
+
     inline void coulomb_transport_coefficients(
             Scalar *pcoefs,
             const Scalar *pscreen,
@@ -692,6 +903,28 @@ namespace noa::pms::dcs {
                             pmu[(nmu) ? 0 : i]);
             };
 
+    inline const auto pcoulomb_transport =
+            [](const TransportCoefs &coefficients,
+               const ScreeningFactors &screening,
+               const FSpins &fspin,
+               const AngularCutoff &mu,
+               const Index grain = COULOMB_GRAIN) {
+                auto *pcoefs = coefficients.data_ptr<Scalar>();
+                auto *pscreen = screening.data_ptr<Scalar>();
+                auto *pfspin = fspin.data_ptr<Scalar>();
+
+                const bool nmu = (mu.numel() == 1);
+                auto *pmu = mu.data_ptr<Scalar>();
+
+                utils::pfor(fspin.numel(), [&](const int64_t i) {
+                    coulomb_transport_coefficients(
+                            pcoefs + 2 * i,
+                            pscreen + NSF * i,
+                            pfspin[i],
+                            pmu[(nmu) ? 0 : i]);
+                }, grain);
+            };
+
 
     inline Scalar coulomb_restricted_cs(
             const Scalar &mu,
@@ -735,6 +968,39 @@ namespace noa::pms::dcs {
         }
     }
 
+    // Coulomb data of the elements of a material at a given kinetic energy, strided
+    // by the number of kinetic energies as laid out by coulomb_data & co
+    struct CoulombStrided {
+        const Scalar *G;
+        const Scalar *fCM;
+        const Scalar *screening;
+        const Scalar *invlambdas;
+        const Scalar *fspins;
+        Index nkin;
+
+        inline Scalar invlambda(const Index iel) const { return invlambdas[iel * nkin]; }
+
+        inline Scalar fspin(const Index iel) const { return fspins[iel * nkin]; }
+
+        inline const Scalar *screen(const Index iel) const { return screening + NSF * iel * nkin; }
+
+        inline const Scalar *transport(const Index iel) const { return G + 2 * iel * nkin; }
+
+        inline const Scalar *frame(const Index iel) const { return fCM + 2 * iel * nkin; }
+    };
+
+    template<typename Elements>
+    inline Scalar mixture_cutoff_objective(
+            const Scalar &cs_h,
+            const Scalar &mu,
+            const Elements &elements,
+            const Index nel) {
+        Scalar cs_tot = 0.;
+        for (Index iel = 0; iel < nel; iel++)
+            cs_tot += elements.invlambda(iel) * coulomb_restricted_cs(mu, elements.fspin(iel), elements.screen(iel));
+        return cs_tot - cs_h;
+    }
+
     inline Scalar cutoff_objective(
             const Scalar &cs_h,
             const Scalar &mu,
@@ -743,36 +1009,30 @@ namespace noa::pms::dcs {
             Scalar *screen,
             const Index nel = 1,
             const Index nkin = 1) {
-        Scalar cs_tot = 0.;
-        for (Index iel = 0; iel < nel; iel++) {
-            const Index off = iel * nkin;
-            cs_tot += invlambda[off] * coulomb_restricted_cs(mu, fspin[off], screen + NSF * off);
-        }
-        return cs_tot - cs_h;
+        return mixture_cutoff_objective(
+                cs_h, mu, CoulombStrided{nullptr, nullptr, screen, invlambda, fspin, nkin}, nel);
     }
 
-    inline void coulomb_hard_scattering(Scalar &mu0, Scalar &lb_h,
-                                        const Scalar *G, const Scalar *fCM,
-                                        Scalar *screen,
-                                        Scalar *invlambda,
-                                        Scalar *fspin,
-                                        const Index nel = 1,
-                                        const Index nkin = 1) {
+    template<typename Elements>
+    inline void mixture_hard_scattering(Scalar &mu0, Scalar &lb_h,
+                                        const Elements &elements,
+                                        const Index nel) {
 
         Scalar invlb_m = 0., invlb1_m = 0.;
         Scalar s_m_l = 0., s_m_h = 0.;
 
         for (Index iel = 0; iel < nel; iel++) {
-            const Index off = iel * nkin;
+            const Scalar invlb = elements.invlambda(iel);
+            const Scalar *screen = elements.screen(iel);
+            const Scalar *G = elements.transport(iel);
+            const Scalar *fCM = elements.frame(iel);
+            const Scalar scr = screen[0];
 
-            const Scalar invlb = invlambda[off];
-            const Scalar scr = screen[NSF * off];
-
-            invlb_m += invlb * G[2 * off];
+            invlb_m += invlb * G[0];
             s_m_h += scr * invlb;
             s_m_l += invlb / scr;
-            const Scalar d = 1. / (fCM[2 * off] * (1. + fCM[1 + 2 * off]));
-            invlb1_m += invlb * G[1 + 2 * off] * d * d;
+            const Scalar d = 1. / (fCM[0] * (1. + fCM[1]));
+            invlb1_m += invlb * G[1] * d * d;
         }
 
         // Set the hard scattering mean free path.
@@ -798,7 +1058,7 @@ namespace noa::pms::dcs {
 
             Scalar fmax = 0, fmin = 0;
 
-            fmax = cutoff_objective(cs_h, mu_max, invlambda, fspin, screen, nel, nkin);
+            fmax = mixture_cutoff_objective(cs_h, mu_max, elements, nel);
             if (fmax > 0.) {
                 // This shouldn't occur, but let's be safe and handle this case.
                 mu_min = mu_max;
@@ -806,13 +1066,13 @@ namespace noa::pms::dcs {
                 mu_max = 1.;
                 fmax = -cs_h;
             } else {
-                fmin = cutoff_objective(cs_h, mu_min, invlambda, fspin, screen, nel, nkin);
+                fmin = mixture_cutoff_objective(cs_h, mu_min, elements, nel);
                 if (fmin < 0.) {
                     // This might occur at high energies when the nuclear screening becomes significant.
                     mu_max = mu_min;
                     fmax = fmin;
                     mu_min = 0.;
-                    fmin = cutoff_objective(cs_h, mu_min, invlambda, fspin, screen, nel, nkin);
+                    fmin = mixture_cutoff_objective(cs_h, mu_min, elements, nel);
                 }
                 if (mu_min < MAX_MU0) {
                     mu_max = std::min(mu_max, MAX_MU0);
@@ -820,7 +1080,7 @@ namespace noa::pms::dcs {
                             utils::numerics::ridders_root<Scalar>(
                                     mu_min, mu_max,
                                     [&](const Scalar &mu_x) {
-                                        return cutoff_objective(cs_h, mu_x, invlambda, fspin, screen, nel, nkin);
+                                        return mixture_cutoff_objective(cs_h, mu_x, elements, nel);
                                     },
                                     fmin, fmax,
                                     1E-6 * mu0, 1E-6, 100);
@@ -829,7 +1089,7 @@ namespace noa::pms::dcs {
                         mu0 = mubest.value();
                 }
                 mu0 = std::min(mu0, MAX_MU0);
-                lb_h = cutoff_objective(cs_h, mu0, invlambda, fspin, screen, nel, nkin) + cs_h;
+                lb_h = mixture_cutoff_objective(cs_h, mu0, elements, nel) + cs_h;
                 lb_h = (lb_h <= 1. / EHS_PATH_MAX) ? EHS_PATH_MAX : 1. / lb_h;
             }
         } else {
@@ -838,6 +1098,16 @@ namespace noa::pms::dcs {
         }
     }
 
+    inline void coulomb_hard_scattering(Scalar &mu0, Scalar &lb_h,
+                                        const Scalar *G, const Scalar *fCM,
+                                        Scalar *screen,
+                                        Scalar *invlambda,
+                                        Scalar *fspin,
+                                        const Index nel = 1,
+                                        const Index nkin = 1) {
+        mixture_hard_scattering(mu0, lb_h, CoulombStrided{G, fCM, screen, invlambda, fspin, nkin}, nel);
+    }
+
 
     inline const auto hard_scattering =
             [](const AngularCutoff &mu0,
@@ -871,6 +1141,98 @@ namespace noa::pms::dcs {
                             nel, nkin);
             };
 
+    inline const auto phard_scattering =
+            [](const AngularCutoff &mu0,
+               const HSMeanFreePath &lb_h,
+               const TransportCoefs &coefficients,
+               const CMLorentz &transform,
+               const ScreeningFactors &screening,
+               const InvLambdas &invlambdas,
+               const FSpins &fspins,
+               const Index grain = COULOMB_GRAIN) {
+                const Index nel = invlambdas.size(0);
+                const Index nkin = invlambdas.size(1);
+
+                auto *pmu0 = mu0.data_ptr<Scalar>();
+                auto *plb_h = lb_h.data_ptr<Scalar>();
+
+                auto *invlambda = invlambdas.data_ptr<Scalar>();
+                auto *fspin = fspins.data_ptr<Scalar>();
+                auto *G = coefficients.data_ptr<Scalar>();
+                auto *fCM = transform.data_ptr<Scalar>();
+                auto *screen = screening.data_ptr<Scalar>();
+
+                utils::pfor(nkin, [&](const int64_t i) {
+                    coulomb_hard_scattering(
+                            pmu0[i],
+                            plb_h[i],
+                            G + 2 * i,
+                            fCM + 2 * i,
+                            screen + NSF * i,
+                            invlambda + i,
+                            fspin + i,
+                            nel, nkin);
+                }, grain);
+            };
+
+    // Record of an element in the Coulomb table of a composite material: invlambda, weighted
+    // by the mass fraction of the element, fspin, fCM[2], G[2] and the screening factors
+    constexpr Index COULOMB_RECORD = 6 + NSF;
+
+    // Coulomb data of the elements of a composite material at a given kinetic energy,
+    // with the records of all the elements contiguous
+    struct CoulombPacked {
+        const Scalar *records;
+
+        inline Scalar invlambda(const Index iel) const { return records[COULOMB_RECORD * iel]; }
+
+        inline Scalar fspin(const Index iel) const { return records[COULOMB_RECORD * iel + 1]; }
+
+        inline const Scalar *frame(const Index iel) const { return records + COULOMB_RECORD * iel + 2; }
+
+        inline const Scalar *transport(const Index iel) const { return records + COULOMB_RECORD * iel + 4; }
+
+        inline const Scalar *screen(const Index iel) const { return records + COULOMB_RECORD * iel + 6; }
+    };
+
+    using CompositeCoulomb = torch::Tensor; // [nkin, nel, COULOMB_RECORD] element records
+    using MassFractions = torch::Tensor;    // [nel] mass fractions of the elements in a material
+
+    // Coulomb tabulation of a composite material, in a single pass per kinetic energy:
+    // the element records are computed into a packed table and mixed right away into
+    // the hard scattering cutoff and mean free path. Matches coulomb_data, coulomb_transport
+    // and hard_scattering over elements with invlambda weighted by the mass fractions.
+    inline const auto composite_hard_scattering =
+            [](const AngularCutoff &mu0,
+               const HSMeanFreePath &lb_h,
+               const CompositeCoulomb &records,
+               const Energies &kinetic_energies,
+               const std::vector<AtomicElement> &elements,
+               const MassFractions &fractions,
+               const ParticleMass &mass,
+               const Index grain = COULOMB_GRAIN) {
+                const Index nkin = kinetic_energies.numel();
+                const auto nel = static_cast<Index>(elements.size());
+
+                auto *pK = kinetic_energies.data_ptr<Scalar>();
+                auto *pw = fractions.data_ptr<Scalar>();
+                auto *precords = records.data_ptr<Scalar>();
+                auto *pmu0 = mu0.data_ptr<Scalar>();
+                auto *plb_h = lb_h.data_ptr<Scalar>();
+
+                utils::pfor(nkin, [&](const int64_t i) {
+                    Scalar *block = precords + i * nel * COULOMB_RECORD;
+                    for (Index iel = 0; iel < nel; iel++) {
+                        Scalar *record = block + iel * COULOMB_RECORD;
+                        const Scalar kinetic0 = coulomb_frame_parameters(record + 2, pK[i], elements[iel], mass);
+                        record[1] = coulomb_spin_factor(kinetic0, mass);
+                        record[0] = coulomb_screening_parameters(record + 6, kinetic0, elements[iel], mass) * pw[iel];
+                        coulomb_transport_coefficients(record + 4, record + 6, record[1], 1.);
+                    }
+                    mixture_hard_scattering(pmu0[i], plb_h[i], CoulombPacked{block}, nel);
+                }, grain);
+            };
+
     inline Scalar transverse_transport_ionisation(
             const Energy &kinetic_energy,
             const AtomicElement &element,
@@ -951,6 +1313,20 @@ namespace noa::pms::dcs {
                         ms1);
             };
 
+    inline const auto psoft_scattering =
+            [](const Calculation &ms1,
+               const Energies &kinetic_energies,
+               const AtomicElement &element,
+               const ParticleMass &mass,
+               const Index grain = COULOMB_GRAIN) {
+                const Scalar *pK = kinetic_energies.data_ptr<Scalar>();
+                Scalar *pms1 = ms1.data_ptr<Scalar>();
+                utils::pfor(kinetic_energies.numel(), [&](const int64_t i) {
+                    pms1[i] = transverse_transport_ionisation(pK[i], element, mass) +
+                              transverse_transport_photonuclear(pK[i], element, mass);
+                }, grain);
+            };
+
 
     template<>
     inline auto recoil_integral(
@@ -1001,6 +1377,343 @@ namespace noa::pms::dcs {
     }
 
 
+    /// Batch kernels, evaluating Lanes::width energies at once
+    ///
+    /// Counterparts of the scalar DCS above: branches are replaced by masks, so that all
+    /// the lanes follow the same path and vector math is used for pow, log and exp.
+    ///
+    /// Kernels are generic in the precision of the lanes. Single precision packs twice as many
+    /// energies per register: macroscopic factors are then folded into double precision
+    /// constants, since intermediate cross-sections would underflow in single precision.
+    namespace simd {
+
+        inline const auto bremsstrahlung = [](
+                const auto &kinetic_energy,
+                const auto &recoil_energy,
+                const AtomicElement &element,
+                const ParticleMass &mass) {
+            using Lanes = std::decay_t<decltype(kinetic_energy)>;
+            const Index Z = element.Z;
+            const Scalar A = element.A;
+            const Scalar me = ELECTRON_MASS;
+            const Scalar sqrte = 1.648721271;
+            const Scalar phie_factor = mass / (me * me * sqrte);
+            const Scalar rem = 5.63588E-13 * me / mass;
+
+            const Scalar BZ_n = (Z == 1) ? 202.4 : 182.7 * pow(Z, -1. / 3.);
+            const Scalar BZ_e = (Z == 1) ? 446. : 1429. * pow(Z, -2. / 3.);
+            const Scalar D_n = 1.54 * pow(A, 0.27);
+            const Lanes E = kinetic_energy + mass;
+            const Scalar dcs_factor = 7.297182E-07 * rem * rem * Z * 1E+03 * AVOGADRO_NUMBER / A;
+
+            const Lanes delta_factor = 0.5 * mass * mass / E;
+            const Lanes qe_max = E / (1. + 0.5 * mass * mass / (me * E));
+
+            const Lanes nu = recoil_energy / E;
+            const Lanes delta = delta_factor * nu / (1. - nu);
+            const Lanes Phi_n = max(log(BZ_n * (mass + delta * (D_n * sqrte - 2.)) /
+                                        (D_n * (me + delta * sqrte * BZ_n))),
+                                    Lanes{0.});
+            const Lanes Phi_e = select(recoil_energy < qe_max,
+                                       max(log(BZ_e * mass /
+                                               ((1. + delta * phie_factor) * (me + delta * sqrte * BZ_e))),
+                                           Lanes{0.}),
+                                       Lanes{0.});
+
+            const Lanes dcs =
+                    dcs_factor * (Z * Phi_n + Phi_e) * (4. / 3. * (1. / nu - 1.) + nu);
+            return select(dcs < 0., Lanes{0.}, dcs);
+        };
+
+        template<int W>
+        inline utils::simd::Pack<Scalar, W> pair_production_lanes(
+                const utils::simd::Pack<Scalar, W> &kinetic_energy,
+                const utils::simd::Pack<Scalar, W> &recoil_energy,
+                const AtomicElement &element,
+                const ParticleMass &mass) {
+            using Lanes = utils::simd::Pack<Scalar, W>;
+            using LanesMask = typename Lanes::mask_type;
+            const Index Z = element.Z;
+            const Scalar A = element.A;
+            const Scalar sqrte = 1.6487212707;
+            const Scalar Z13 = pow(Z, 1. / 3.);
+
+            // Bounds of the energy transfer
+            LanesMask valid = (recoil_energy > 4. * ELECTRON_MASS) &
+                              (recoil_energy < kinetic_energy + mass * (1. - 0.75 * sqrte * Z13));
+
+            const Lanes nu = recoil_energy / (kinetic_energy + mass);
+            const Scalar r = mass / ELECTRON_MASS;
+            const Lanes beta = 0.5 * nu * nu / (1. - nu);
+            const Lanes xi_factor = 0.5 * r * r * beta;
+            const Scalar A_ = (Z == 1) ? 202.4 : 183.;
+            const Scalar AZ13 = A_ / Z13;
+            const Scalar cL = 2. * sqrte * ELECTRON_MASS * AZ13;
+            const Scalar cLe = 2.25 * Z13 * Z13 / (r * r);
+
+            // Bound for the integral
+            const Lanes gamma = 1. + kinetic_energy / mass;
+            const Lanes x0 = 4. * ELECTRON_MASS / recoil_energy;
+            const Lanes x1 = 6. / (gamma * (gamma - recoil_energy / mass));
+            const Lanes argmin =
+                    (x0 + 2. * (1. - x0) * x1) / (1. + (1. - x1) * sqrt(1. - x0));
+            valid = valid & (argmin < 1.) & (argmin > 0.);
+            if (!valid.any())
+                return Lanes{0.};
+            const Lanes tmin = log(select(valid, argmin, Lanes{0.5}));
+
+            // Integral over t = ln(1-rho)
+            const auto I = utils::numerics::quadrature8<Lanes>(0., 1., [&](const Lanes &t) {
+                const Lanes eps = exp(t * tmin);
+                const Lanes rho = 1. - eps;
+                const Lanes rho2 = rho * rho;
+                const Lanes rho21 = eps * (2. - eps);
+                const Lanes xi = xi_factor * rho21;
+                const Lanes xi_i = 1. / xi;
+
+                // e-term
+                const Lanes Be = select(
+                        xi >= 1E+03,
+                        0.5 * xi_i * ((3 - rho2) + 2. * beta * (1. + rho2)),
+                        ((2. + rho2) * (1. + beta) + xi * (3. + rho2)) * log(1. + xi_i) +
+                        (rho21 - beta) / (1. + xi) - 3. - rho2);
+                const Lanes Ye = (5. - rho2 + 4. * beta * (1. + rho2)) /
+                                 (2. * (1. + 3. * beta) * log(3. + xi_i) - rho2 -
+                                  2. * beta * (2. - rho2));
+                const Lanes xe = (1. + xi) * (1. + Ye);
+                const Lanes cLi = cL / rho21;
+                const Lanes Le = log(AZ13 * sqrt(xe) * recoil_energy / (recoil_energy + cLi * xe)) -
+                                 0.5 * log(1. + cLe * xe);
+                const Lanes Phi_e = max(Be * Le, Lanes{0.});
+
+                // mass-term
+                const Lanes Bmu = select(
+                        xi <= 1E-03,
+                        0.5 * xi * (5. - rho2 + beta * (3. + rho2)),
+                        ((1. + rho2) * (1. + 1.5 * beta) - xi_i * (1. + 2. * beta) * rho21) *
+                        log(1. + xi) +
+                        xi * (rho21 - beta) / (1. + xi) +
+                        (1. + 2. * beta) * rho21);
+                const Lanes Ymu = (4. + rho2 + 3. * beta * (1. + rho2)) /
+                                  ((1. + rho2) * (1.5 + 2. * beta) * log(3. + xi) + 1. -
+                                   1.5 * rho2);
+                const Lanes xmu = (1. + xi) * (1. + Ymu);
+                const Lanes Lmu =
+                        log(r * AZ13 * recoil_energy / (1.5 * Z13 * (recoil_energy + cLi * xmu)));
+                const Lanes Phi_mu = max(Bmu * Lmu, Lanes{0.});
+                return -(Phi_e + Phi_mu / (r * r)) * (1. - rho) * tmin;
+            });
+
+            // Atomic electrons form factor
+            const Scalar gamma1 = (Z == 1) ? 4.4E-05 : 1.95E-05;
+            const Scalar gamma2 = (Z == 1) ? 4.8E-05 : 5.30E-05;
+            const Lanes zeta0 = 0.073 * log(gamma / (1. + gamma1 * gamma * Z13 * Z13)) - 0.26;
+            const Lanes zeta = select(
+                    (gamma > 35.) & (zeta0 > 0.),
+                    zeta0 / (0.058 * log(gamma / (1. + gamma2 * gamma * Z13)) - 0.14),
+                    Lanes{0.});
+
+            // Gather the results into the macroscopic DCS
+            const Lanes E = kinetic_energy + mass;
+            const Lanes dcs = 1.794664E-34 * Z * (Z + zeta) * (E - recoil_energy) * I /
+                              (recoil_energy * E);
+            return select(valid & !(dcs < 0.),
+                          dcs * 1E+03 * AVOGADRO_NUMBER * (mass + kinetic_energy) / A,
+                          Lanes{0.});
+        }
+
+        inline const auto pair_production = [](
+                const auto &kinetic_energy,
+                const auto &recoil_energy,
+                const AtomicElement &element,
+                const ParticleMass &mass) {
+            // The screening functions cancel at the 1E-03 level in single precision,
+            // hence the integral is always evaluated in double precision
+            using Real = typename std::decay_t<decltype(kinetic_energy)>::value_type;
+            return utils::simd::convert<Real>(pair_production_lanes(utils::simd::convert<Scalar>(kinetic_energy),
+                                                                    utils::simd::convert<Scalar>(recoil_energy),
+                                                                    element, mass));
+        };
+
+        inline const auto photonuclear = [](
+                const auto &kinetic_energy,
+                const auto &recoil_energy,
+                const AtomicElement &element,
+                const ParticleMass &mass) {
+            using Lanes = std::decay_t<decltype(kinetic_energy)>;
+            using LanesMask = typename Lanes::mask_type;
+            const Scalar A = element.A;
+            const Scalar M = 0.931494;
+            const Scalar mpi = 0.134977;
+            const Lanes E = kinetic_energy + mass;
+
+            const Lanes y = recoil_energy / E;
+            const Lanes Q2min = mass * mass * y * y / (1 - y);
+            const Lanes Q2max = 2.0 * M * (recoil_energy - mpi) - mpi * mpi;
+            const LanesMask valid = !((recoil_energy < 1.) | (recoil_energy < 2E-03 * kinetic_energy)) &
+                                    (recoil_energy < (E - mass)) &
+                                    (recoil_energy > (mpi * (1.0 + 0.5 * mpi / M))) &
+                                    (Q2max >= Q2min) & (Q2min >= 0.);
+            if (!valid.any())
+                return Lanes{0.};
+
+            // Binning, on dummy bounds for the masked lanes
+            const Lanes pQ2min = log(select(valid, Q2min, Lanes{1.}));
+            const Lanes pQ2max = log(select(valid, Q2max, Lanes{2.}));
+            const Lanes dpQ2 = pQ2max - pQ2min;
+            const Lanes pQ2c = 0.5 * (pQ2max + pQ2min);
+
+            const Scalar cf = 2.603096E-35 * 1E+03 * AVOGADRO_NUMBER / A;
+            const Lanes ds = utils::numerics::quadrature9<Lanes>(
+                    0., 1.,
+                    [&](const Lanes &t) {
+                        const Lanes Q2 = exp(pQ2c + 0.5 * dpQ2 * t);
+                        return dcs_photonuclear_d2(A, mass, kinetic_energy, recoil_energy, Q2, cf) * Q2;
+                    });
+
+            return select(valid & !(ds < 0.), 0.5 * ds * dpQ2 * (mass + kinetic_energy), Lanes{0.});
+        };
+
+        inline const auto ionisation = [](
+                const auto &kinetic_energy,
+                const auto &recoil_energy,
+                const AtomicElement &element,
+                const ParticleMass &mass) {
+            using Lanes = std::decay_t<decltype(kinetic_energy)>;
+            using LanesMask = typename Lanes::mask_type;
+            const Scalar A = element.A;
+            const Index Z = element.Z;
+
+            const Lanes P2 = kinetic_energy * (kinetic_energy + 2. * mass);
+            const Lanes E = kinetic_energy + mass;
+            const Lanes Wmax = 2. * ELECTRON_MASS * P2 /
+                               (mass * mass +
+                                ELECTRON_MASS * (ELECTRON_MASS + 2. * E));
+            const Scalar Wmin = 0.62 * element.I;
+            const LanesMask valid = !((Wmax < X_FRACTION * kinetic_energy) | (recoil_energy > Wmax)) &
+                                    (recoil_energy > Wmin);
+
+            // Close interactions for Q >> atomic binding energies
+            const Lanes a0 = 0.5 / P2;
+            const Lanes a1 = -1. / Wmax;
+            const Lanes a2 = E * E / P2;
+            const Lanes cs =
+                    1.535336E-05 * E * Z / A * (a0 + 1. / recoil_energy * (a1 + a2 / recoil_energy));
+
+            // Radiative correction
+            const Scalar m1 = mass - ELECTRON_MASS;
+            const Lanes L1 = log(1. + 2. * recoil_energy / ELECTRON_MASS);
+            const Lanes Delta = select(
+                    kinetic_energy >= 0.5 * m1 * m1 / ELECTRON_MASS,
+                    1.16141E-03 * L1 * (log(4. * E * (E - recoil_energy) / (mass * mass)) - L1),
+                    Lanes{0.});
+            return select(valid, cs * (1. + Delta), Lanes{0.});
+        };
+
+        /// Evaluates a batch kernel over contiguous arrays of n energies, in the precision of Real
+        template<typename DCSKernel, typename Real>
+        inline void eval(const DCSKernel &dcs_kernel,
+                         Real *result,
+                         const Real *kinetic_energy,
+                         const Real *recoil_energy,
+                         const int64_t n,
+                         const AtomicElement &element,
+                         const ParticleMass &mass) {
+            using Lanes = utils::simd::Pack<Real>;
+            constexpr int W = Lanes::width;
+            const int64_t nb = n / W;
+            for (int64_t b = 0; b < nb; b++)
+                dcs_kernel(Lanes::load(kinetic_energy + b * W),
+                           Lanes::load(recoil_energy + b * W),
+                           element, mass).store(result + b * W);
+            const int tail = static_cast<int>(n - nb * W);
+            if (tail > 0)
+                dcs_kernel(Lanes::load(kinetic_energy + nb * W, tail),
+                           Lanes::load(recoil_energy + nb * W, tail),
+                           element, mass).store(result + nb * W, tail);
+        }
+
+        /// Same as eval with blocks of lanes spread over OpenMP threads
+        template<typename DCSKernel, typename Real>
+        inline void peval(const DCSKernel &dcs_kernel,
+                          Real *result,
+                          const Real *kinetic_energy,
+                          const Real *recoil_energy,
+                          const int64_t n,
+                          const AtomicElement &element,
+                          const ParticleMass &mass) {
+            constexpr int64_t B = 64 * utils::simd::Pack<Real>::width; // Energies per task
+            const int64_t nt = (n + B - 1) / B;
+#pragma omp parallel for
+            for (int64_t t = 0; t < nt; t++) {
+                const int64_t off = t * B;
+                eval(dcs_kernel, result + off, kinetic_energy + off, recoil_energy + off,
+                     std::min(B, n - off), element, mass);
+            }
+        }
+
+        /// Energies are either kFloat64, or kFloat32 for the single precision fast path
+        template<typename DCSKernel>
+        inline auto vmap(const DCSKernel &dcs_kernel) {
+            return [&dcs_kernel](const Calculation &result,
+                                 const Energies &kinetic_energies,
+                                 const Energies &recoil_energies,
+                                 const AtomicElement &element,
+                                 const AtomicMass &mass) {
+                AT_DISPATCH_FLOATING_TYPES(kinetic_energies.scalar_type(), "dcs::simd::vmap", [&] {
+                    eval(dcs_kernel,
+                         result.data_ptr<scalar_t>(),
+                         kinetic_energies.data_ptr<scalar_t>(),
+                         recoil_energies.data_ptr<scalar_t>(),
+                         kinetic_energies.numel(), element, mass);
+                });
+            };
+        }
+
+        template<typename DCSKernel>
+        inline auto map(const DCSKernel &dcs_kernel) {
+            return [&dcs_kernel](const Energies &kinetic_energies,
+                                 const Energies &recoil_energies,
+                                 const AtomicElement &element,
+                                 const AtomicMass &mass) {
+                const auto result = torch::zeros_like(kinetic_energies);
+                vmap(dcs_kernel)(result, kinetic_energies, recoil_energies, element, mass);
+                return result;
+            };
+        }
+
+        template<typename DCSKernel>
+        inline auto pvmap(const DCSKernel &dcs_kernel) {
+            return [&dcs_kernel](const Calculation &result,
+                                 const Energies &kinetic_energies,
+                                 const Energies &recoil_energies,
+                                 const AtomicElement &element,
+                                 const AtomicMass &mass) {
+                AT_DISPATCH_FLOATING_TYPES(kinetic_energies.scalar_type(), "dcs::simd::pvmap", [&] {
+                    peval(dcs_kernel,
+                          result.data_ptr<scalar_t>(),
+                          kinetic_energies.data_ptr<scalar_t>(),
+                          recoil_energies.data_ptr<scalar_t>(),
+                          kinetic_energies.numel(), element, mass);
+                });
+            };
+        }
+
+        template<typename DCSKernel>
+        inline auto pmap(const DCSKernel &dcs_kernel) {
+            return [&dcs_kernel](const Energies &kinetic_energies,
+                                 const Energies &recoil_energies,
+                                 const AtomicElement &element,
+                                 const AtomicMass &mass) {
+                const auto result = torch::zeros_like(kinetic_energies);
+                pvmap(dcs_kernel)(result, kinetic_energies, recoil_energies, element, mass);
+                return result;
+            };
+        }
+
+    } // namespace noa::pms::dcs::simd
+
+
     namespace cuda {
 
         void vmap_bremsstrahlung(
@@ -0,0 +1,273 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * \file grammage.hh
+ * Column density (grammage) maps along straight lines through a tetrahedral mesh
+ *
+ * Rays from a detector point are marched with noa::pms::trace::Tracer, without any transport.
+ * Mesh coordinates are in m and densities in kg/m^3, giving grammages in kg/m^2 as noa::pms::csda.
+ */
+
+#pragma once
+
+#include "noa/pms/csda.hh"
+#include "noa/pms/physics.hh"
+#include "noa/pms/trace.hh"
+#include "noa/utils/common.hh"
+#include "noa/utils/mmap.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+
+namespace noa::pms::grammage {
+
+    /// File layout:
+    ///   header: MAGIC (8 bytes), VERSION (uint32), number of azimuths and elevations (uint32),
+    ///           hash of the geometry (uint64), then the detector coordinates and the elevation range (double)
+    ///   rows of grammages (double), one per azimuth
+    inline constexpr char MAGIC[8] = {'N', 'O', 'A', 'G', 'R', 'M', 'A', 'P'};
+    inline constexpr uint32_t VERSION = 2;
+
+    class GrammageMap;
+
+    using GrammageMapOpt = std::optional<GrammageMap>;
+
+    /// Grammage seen from a detector over an (azimuth, elevation) grid of directions
+    ///
+    /// Azimuths split [0, 2 pi) uniformly, elevations span [elevation_min, elevation_max] included.
+    /// The direction is (cos(el) cos(az), cos(el) sin(az), sin(el)).
+    class GrammageMap {
+        Scalar detector[3];
+        Scalar elevation_min, elevation_max;
+        Index n_azimuth, n_elevation;
+        uint64_t geometry; // see geometry_hash
+
+        Tabulation table; // [n_azimuth, n_elevation]
+
+        GrammageMap(const Scalar *detector_, const Scalar &elevation_min_, const Scalar &elevation_max_,
+                    const uint64_t geometry_, const Tabulation &table_)
+                : detector{detector_[0], detector_[1], detector_[2]},
+                  elevation_min{elevation_min_}, elevation_max{elevation_max_},
+                  n_azimuth{static_cast<Index>(table_.size(0))}, n_elevation{static_cast<Index>(table_.size(1))},
+                  geometry{geometry_}, table{table_} {}
+
+    public:
+        /// FNV-1a hash of the mesh points, the cells and their densities, identifying the geometry of a map
+        template<typename Tracer, typename Density>
+        inline static uint64_t geometry_hash(const typename Tracer::MeshType &mesh, const Density &density) {
+            constexpr int dimension = Tracer::MeshType::getMeshDimension();
+            const auto bytes = [](const auto &value) {
+                return std::string_view{reinterpret_cast<const char *>(&value), sizeof(value)};
+            };
+
+            uint64_t hash = utils::fnv1a({});
+            const auto n_vertices = mesh.template getEntitiesCount<0>();
+            for (std::decay_t<decltype(n_vertices)> vertex = 0; vertex < n_vertices; vertex++) {
+                const auto &point = mesh.template getEntity<0>(vertex).getPoint();
+                for (int i = 0; i < 3; i++) hash = utils::fnv1a(bytes(point[i]), hash);
+            }
+            const auto n_cells = mesh.template getEntitiesCount<dimension>();
+            for (std::decay_t<decltype(n_cells)> cell = 0; cell < n_cells; cell++) {
+                const auto &entity = mesh.template getEntity<dimension>(cell);
+                for (int k = 0; k < entity.template getSubentitiesCount<0>(); k++) {
+                    const auto vertex = entity.template getSubentityIndex<0>(k);
+                    hash = utils::fnv1a(bytes(vertex), hash);
+                }
+                const Scalar rho = density(cell);
+                hash = utils::fnv1a(bytes(rho), hash);
+            }
+            return hash;
+        }
+
+        /// Marches the rays of the grid through the mesh, in parallel
+        ///
+        /// The detector may be inside or outside of the mesh, and the mesh needs not be convex: a ray
+        /// starts at its first entry into the mesh, and after each exit it is marched again from its next
+        /// entry (see Tracer::get_mesh_entry), until it leaves the mesh for good. Rays missing the mesh
+        /// see no grammage. Density is a function of the tetrahedron global index.
+        /// \return The map -- if the mesh has cells, {} -- if otherwise
+        template<typename Tracer, typename Density>
+        inline static GrammageMapOpt compute(const typename Tracer::MeshType &mesh,
+                                             const typename Tracer::PointType &detector,
+                                             const Density &density,
+                                             const Index n_azimuth = 360,
+                                             const Index n_elevation = 91,
+                                             const Scalar &elevation_min = 0.,
+                                             const Scalar &elevation_max = 0.5 * M_PI) {
+            using Point = typename Tracer::PointType;
+            using Real = typename Point::RealType;
+
+            if (n_azimuth < 1 || n_elevation < 2)
+                throw std::runtime_error("GrammageMap: at least 1 azimuth and 2 elevations are required");
+
+            const auto n_cells = mesh.template getEntitiesCount<Tracer::MeshType::getMeshDimension()>();
+            if (n_cells == 0) {
+                std::cerr << "GrammageMap: the mesh is empty\n";
+                return std::nullopt;
+            }
+            // Shared by all the rays starting inside of the mesh
+            const auto start = Tracer::get_current_tetrahedron(&mesh, n_cells, detector);
+
+            const auto adjacency = Tracer::build_adjacency(mesh);
+            const auto adjacency_view = adjacency.get_view();
+
+            auto table = torch::empty({n_azimuth, n_elevation}, torch::dtype(torch::kDouble));
+            Scalar *ptab = table.data_ptr<Scalar>();
+            const Scalar azimuth_step = 2. * M_PI / n_azimuth;
+            const Scalar elevation_step = (elevation_max - elevation_min) / (n_elevation - 1);
+
+            // Rays are of very different lengths, hence the dynamic schedule
+            utils::pfor(n_azimuth * n_elevation, [&](const int64_t k) {
+                const Scalar azimuth = (k / n_elevation) * azimuth_step;
+                const Scalar elevation = elevation_min + (k % n_elevation) * elevation_step;
+                const Point direction = Point(cos(elevation) * cos(azimuth),
+                                              cos(elevation) * sin(azimuth),
+                                              sin(elevation));
+
+                csda::Grammage grammage = 0.;
+                Real travelled = 0; // along the ray, from the detector
+                auto current = start;
+                while (true) {
+                    if (!current.has_value()) {
+                        const auto entry = Tracer::get_mesh_entry(&mesh, adjacency_view, detector, direction, travelled);
+                        if (entry.distance < 0) break;
+                        current = entry.tetrahedron_global_index;
+                        travelled = entry.distance;
+                    }
+                    const Point position = detector + direction * travelled;
+                    for (const auto &segment: Tracer::trace_ray(&mesh, adjacency_view, current.value(), position, direction)) {
+                        grammage += density(segment.tetrahedron_global_index) * segment.length;
+                        travelled += segment.length;
+                    }
+                    current.reset();
+                }
+                ptab[k] = grammage;
+            });
+
+            const Scalar point[3] = {detector[0], detector[1], detector[2]};
+            return GrammageMap{point, elevation_min, elevation_max, geometry_hash<Tracer>(mesh, density), table};
+        }
+
+        /// Grammage along the direction, bilinear in the angles
+        inline csda::Grammage operator()(const Scalar &azimuth, const Scalar &elevation) const {
+            const Scalar *ptab = table.data_ptr<Scalar>();
+            const Scalar fa = azimuth / (2. * M_PI) * n_azimuth;
+            const Scalar fa0 = floor(fa);
+            const Scalar ta = fa - fa0;
+            const auto a0 = static_cast<Index>(((static_cast<int64_t>(fa0) % n_azimuth) + n_azimuth) % n_azimuth);
+            const auto a1 = (a0 + 1) % n_azimuth;
+
+            const Scalar fe = std::clamp((elevation - elevation_min) / (elevation_max - elevation_min), 0., 1.) *
+                              (n_elevation - 1);
+            const auto e0 = std::min(static_cast<Index>(fe), n_elevation - 2);
+            const Scalar te = fe - e0;
+
+            const auto at = [&](const Index a, const Index e) { return ptab[a * n_elevation + e]; };
+            return (1. - ta) * ((1. - te) * at(a0, e0) + te * at(a0, e0 + 1)) +
+                   ta * ((1. - te) * at(a1, e0) + te * at(a1, e0 + 1));
+        }
+
+        /// Minimum kinetic energies to cross the grammages of the map, in the CSDA
+        inline Energies minimum_energies(const csda::LossTable &loss_table) const {
+            return utils::pvmap<Scalar>(table, [&loss_table](const csda::Grammage &grammage) {
+                return (grammage > 0.) ? loss_table.kinetic_energy(grammage) : 0.;
+            });
+        }
+
+        inline const Tabulation &get_table() const { return table; }
+
+        inline utils::Status save(const utils::Path &path) const {
+            auto stream = std::ofstream{path, std::ios::binary | std::ios::trunc};
+            if (!stream.is_open()) {
+                std::cerr << "Failed to open " << path << "\n";
+                return false;
+            }
+            const uint32_t size[2] = {static_cast<uint32_t>(n_azimuth), static_cast<uint32_t>(n_elevation)};
+            const Scalar header[5] = {detector[0], detector[1], detector[2], elevation_min, elevation_max};
+            stream.write(MAGIC, sizeof(MAGIC));
+            stream.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+            stream.write(reinterpret_cast<const char *>(size), sizeof(size));
+            stream.write(reinterpret_cast<const char *>(&geometry), sizeof(geometry));
+            stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+            stream.write(reinterpret_cast<const char *>(table.data_ptr<Scalar>()), table.numel() * sizeof(Scalar));
+            return static_cast<bool>(stream);
+        }
+
+        inline static GrammageMapOpt load(const utils::Path &path) {
+            if (!utils::check_path_exists(path)) return std::nullopt;
+
+            auto stream = std::ifstream{path, std::ios::binary};
+            char magic[sizeof(MAGIC)];
+            uint32_t version = 0, size[2] = {0, 0};
+            uint64_t geometry = 0;
+            Scalar header[5];
+            stream.read(magic, sizeof(magic));
+            stream.read(reinterpret_cast<char *>(&version), sizeof(version));
+            stream.read(reinterpret_cast<char *>(size), sizeof(size));
+            stream.read(reinterpret_cast<char *>(&geometry), sizeof(geometry));
+            stream.read(reinterpret_cast<char *>(header), sizeof(header));
+            if (!stream || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION ||
+                size[0] < 1 || size[1] < 2) {
+                std::cerr << "Invalid grammage map " << path << "\n";
+                return std::nullopt;
+            }
+
+            auto table = torch::empty({static_cast<Index>(size[0]), static_cast<Index>(size[1])},
+                                      torch::dtype(torch::kDouble));
+            stream.read(reinterpret_cast<char *>(table.data_ptr<Scalar>()), table.numel() * sizeof(Scalar));
+            if (!stream) {
+                std::cerr << "Truncated grammage map " << path << "\n";
+                return std::nullopt;
+            }
+            return GrammageMap{header, header[3], header[4], geometry, table};
+        }
+
+        /// Loads the map cached at the path, or computes and caches it
+        ///
+        /// A cached map is reused only for the same detector, grid and geometry (see geometry_hash).
+        template<typename Tracer, typename Density>
+        inline static GrammageMapOpt load_or_compute(const utils::Path &path,
+                                                     const typename Tracer::MeshType &mesh,
+                                                     const typename Tracer::PointType &detector,
+                                                     const Density &density,
+                                                     const Index n_azimuth = 360,
+                                                     const Index n_elevation = 91,
+                                                     const Scalar &elevation_min = 0.,
+                                                     const Scalar &elevation_max = 0.5 * M_PI) {
+            const auto cached = load(path);
+            if (cached.has_value() && cached->geometry == geometry_hash<Tracer>(mesh, density) &&
+                cached->n_azimuth == n_azimuth && cached->n_elevation == n_elevation &&
+                cached->elevation_min == elevation_min && cached->elevation_max == elevation_max &&
+                cached->detector[0] == detector[0] && cached->detector[1] == detector[1] &&
+                cached->detector[2] == detector[2])
+                return cached;
+
+            auto map = compute<Tracer>(mesh, detector, density, n_azimuth, n_elevation, elevation_min, elevation_max);
+            if (map.has_value() && !map->save(path))
+                std::cerr << "Failed to cache the grammage map to " << path << "\n";
+            return map;
+        }
+    };
+
+} // namespace noa::pms::grammage
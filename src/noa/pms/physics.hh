@@ -87,6 +87,10 @@ namespace noa::pms {
         constexpr Index NSF = 9;  // Number of screening factors and pole reduction for Coulomb scattering
         constexpr Index NLAR = 8; // Order of expansion for the computation of the magnetic deflection
 
+        // Kinetic energies handed out at once to a thread, in the parallel Coulomb tabulations.
+        // Each energy is written by a single thread, so results do not depend on the schedule
+        constexpr Index COULOMB_GRAIN = 8;
+
         // Polynomials order for the DCS model
         constexpr Index DCS_MODEL_ORDER_P = 6;
         constexpr Index DCS_MODEL_ORDER_Q = 2;
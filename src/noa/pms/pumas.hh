@@ -25,8 +25,14 @@
 
 #include "noa/kernels.hh"
 #include "noa/utils/common.hh"
+#include "noa/utils/mmap.hh"
+#include "noa/utils/random.hh"
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
 
 namespace noa::pms::pumas {
 
@@ -82,12 +88,142 @@ namespace noa::pms::pumas {
             }
     };
 
+    // Bank of particles stored as structure of arrays, for wave transport (see Context::transport_wave)
+    struct ParticleBank {
+        std::vector<double>         charge{};
+        std::vector<double>         energy{};
+        std::vector<double>         distance{};
+        std::vector<double>         grammage{};
+        std::vector<double>         time{};
+        std::vector<double>         weight{};
+        std::vector<double>         position[3]{};
+        std::vector<double>         direction[3]{};
+        std::vector<int>            decayed{};
+
+        // Random stream index and the number of variates it has consumed
+        std::vector<uint64_t>       primary{};
+        std::vector<uint64_t>       draws{};
+
+        // Outcome of the last transport: stopping event and end medium
+        std::vector<Event>          event{};
+        std::vector<Medium*>        medium{};
+
+        // Indices of the particles transported by the next wave
+        std::vector<std::size_t>    active{};
+
+        inline std::size_t size() const { return energy.size(); }
+
+        inline void reserve(std::size_t n) {
+            for (auto *column : {&charge, &energy, &distance, &grammage, &time, &weight})
+                column->reserve(n);
+            for (int k = 0; k < 3; k++) {
+                position[k].reserve(n);
+                direction[k].reserve(n);
+            }
+            decayed.reserve(n);
+            primary.reserve(n);
+            draws.reserve(n);
+            event.reserve(n);
+            medium.reserve(n);
+            active.reserve(n);
+        }
+
+        inline void clear() {
+            for (auto *column : {&charge, &energy, &distance, &grammage, &time, &weight})
+                column->clear();
+            for (int k = 0; k < 3; k++) {
+                position[k].clear();
+                direction[k].clear();
+            }
+            decayed.clear();
+            primary.clear();
+            draws.clear();
+            event.clear();
+            medium.clear();
+            active.clear();
+        }
+
+        // Append an active particle, returns its index in the bank
+        inline std::size_t add(uint64_t primary_index, const pumas_state &state) {
+            const auto i = this->size();
+            charge.push_back(state.charge);
+            energy.push_back(state.energy);
+            distance.push_back(state.distance);
+            grammage.push_back(state.grammage);
+            time.push_back(state.time);
+            weight.push_back(state.weight);
+            for (int k = 0; k < 3; k++) {
+                position[k].push_back(state.position[k]);
+                direction[k].push_back(state.direction[k]);
+            }
+            decayed.push_back(state.decayed);
+            primary.push_back(primary_index);
+            draws.push_back(0);
+            event.push_back(PUMAS_EVENT_NONE);
+            medium.push_back(nullptr);
+            active.push_back(i);
+            return i;
+        }
+
+        inline void load(std::size_t i, pumas_state &state) const {
+            state.charge = charge[i];
+            state.energy = energy[i];
+            state.distance = distance[i];
+            state.grammage = grammage[i];
+            state.time = time[i];
+            state.weight = weight[i];
+            for (int k = 0; k < 3; k++) {
+                state.position[k] = position[k][i];
+                state.direction[k] = direction[k][i];
+            }
+            state.decayed = decayed[i];
+        }
+
+        inline void store(std::size_t i, const pumas_state &state) {
+            charge[i] = state.charge;
+            energy[i] = state.energy;
+            distance[i] = state.distance;
+            grammage[i] = state.grammage;
+            time[i] = state.time;
+            weight[i] = state.weight;
+            for (int k = 0; k < 3; k++) {
+                position[k][i] = state.position[k];
+                direction[k][i] = state.direction[k];
+            }
+            decayed[i] = state.decayed;
+        }
+
+        // Keep in the active list only the particles satisfying the predicate
+        template<typename Predicate>
+        inline std::size_t retain(const Predicate &predicate) {
+            std::erase_if(active, [&predicate](std::size_t i) { return !predicate(i); });
+            return active.size();
+        }
+    };
+
+    // Locates all the active particles of a bank at once, before their transport by a wave.
+    // Fills, for the k-th active particle, its medium, the maximum step and the step type.
+    // Only this entry query is batched: the medium queries of the later steps go through Context::medium.
+    using BatchLocateCbFunc = std::function<void(class Context*, const ParticleBank&, Medium**, double*, Step*)>;
+    // Per-particle set up before its transport within a wave (e.g. switching modes)
+    using WaveHookFunc      = std::function<void(class Context&, class State&, std::size_t)>;
+
     // A wrapper class for pumas_context
     class Context {
         template <Particle default_particle> friend class PhysicsModel;
 
         pumas_context *context{nullptr};
 
+        // Counter-based random stream, see set_random_seed
+        utils::random::CounterStream stream{};
+
+        // Locations of the current wave, served to the first medium query of each transport
+        static constexpr std::size_t NO_PENDING = std::numeric_limits<std::size_t>::max();
+        std::size_t pending{NO_PENDING};
+        std::vector<Medium*> wave_media{};
+        std::vector<double> wave_steps{};
+        std::vector<Step> wave_types{};
+
         // Context is only create-able via PhysicsModel
         Context(Physics* physics) {
             switch (pumas_context_create(&this->context, physics, sizeof(this))) {
@@ -114,6 +250,14 @@ namespace noa::pms::pumas {
                 Medium** medium_ptr,
                 double* step_ptr) {
             auto* self = *((Context**)context->user_data);
+            if (self->pending != NO_PENDING) {
+                // PUMAS starts each transport by locating the particle, which the wave already did
+                const auto k = self->pending;
+                self->pending = NO_PENDING;
+                if (medium_ptr != nullptr) *medium_ptr = self->wave_media[k];
+                if (step_ptr != nullptr) *step_ptr = self->wave_steps[k];
+                return self->wave_types[k];
+            }
             return self->medium(
                         self,
                         (State*)state, // We expect state to be wrapped in State
@@ -121,20 +265,30 @@ namespace noa::pms::pumas {
                         step_ptr);
         }
 
+        static double random_callback(pumas_context* context) {
+            auto* self = *((Context**)context->user_data);
+            return self->stream();
+        }
+
         public:
         MediumCbFunc medium{nullptr};
+        // Optional, used by transport_wave in place of the first medium query of every particle (see BatchLocateCbFunc)
+        BatchLocateCbFunc batch_locate{nullptr};
 
         ~Context() {
             this->destroy();
         }
 
-        Context(Context &&other) noexcept : medium(std::move(other.medium)) {
+        Context(Context &&other) noexcept
+            : stream(other.stream), medium(std::move(other.medium)), batch_locate(std::move(other.batch_locate)) {
             this->context = other.context;
             *((Context**)this->context->user_data) = this;
             other.context = nullptr;
         }
         Context & operator=(Context &&other) noexcept {
             medium = std::move(other.medium);
+            batch_locate = std::move(other.batch_locate);
+            stream = other.stream;
             this->context = other.context;
             *((Context**)this->context->user_data) = this;
             other.context = nullptr;
@@ -157,6 +311,47 @@ namespace noa::pms::pumas {
             return ret;
         }
 
+        // Transport every active particle of the bank to its next event.
+        // This is a batched entry point around the scalar PUMAS transport, not event-based stepping:
+        // only the location of the whole wave is resolved at once, by batch_locate if set. Each particle
+        // is then transported in turn by pumas_context_transport, its per-step geometry queries, table
+        // lookups and energy losses being made one particle at a time.
+        // With a counter-based stream (see set_random_seed) each particle draws from the stream
+        // of its primary index, resuming where its previous transport stopped.
+        // Returns the number of particles transported; events and end media are stored in the bank.
+        inline std::size_t transport_wave(ParticleBank &bank, const WaveHookFunc &prepare = nullptr) {
+            const auto n = bank.active.size();
+            if (batch_locate != nullptr) {
+                wave_media.resize(n);
+                wave_steps.resize(n);
+                wave_types.resize(n);
+                batch_locate(this, bank, wave_media.data(), wave_steps.data(), wave_types.data());
+            }
+
+            const bool counter_based = (this->context->random == &Context::random_callback);
+            auto state = this->create_state();
+            for (std::size_t k = 0; k < n; k++) {
+                const auto i = bank.active[k];
+                bank.load(i, state.get());
+                if (counter_based) {
+                    this->stream.reset(bank.primary[i]);
+                    this->stream.skip_to(bank.draws[i]);
+                    pumas_context_random_reset_randn(this->context);
+                }
+                if (prepare != nullptr) prepare(*this, state, i);
+
+                Medium *media[2];
+                if (batch_locate != nullptr) pending = k;
+                bank.event[i] = this->do_transport(state, media);
+                pending = NO_PENDING;
+
+                bank.store(i, state.get());
+                bank.medium[i] = media[1];
+                if (counter_based) bank.draws[i] = this->stream.draws();
+            }
+            return n;
+        }
+
         inline State create_state() {
             return State(this);
         }
@@ -165,6 +360,22 @@ namespace noa::pms::pumas {
         inline const pumas_context * operator->() const { return this->context; }
 
         inline auto rnd() { return this->context->random(this->context); }
+
+        // Replace PUMAS' Mersenne Twister with a counter-based stream keyed by (seed, primary index).
+        // The n-th draw of a primary then only depends on (seed, primary, n), regardless of threading.
+        inline void set_random_seed(uint64_t seed) {
+            this->stream = utils::random::CounterStream{seed};
+            this->context->random = &Context::random_callback;
+            pumas_context_random_reset_randn(this->context);
+        }
+
+        // Rewind the counter-based stream to the beginning of the given primary's history
+        inline void set_primary(uint64_t primary_index) {
+            this->stream.reset(primary_index);
+            pumas_context_random_reset_randn(this->context);
+        }
+
+        inline const utils::random::CounterStream & random_stream() const { return this->stream; }
     };
     using ContextOpt = std::optional<Context>;
 
@@ -175,9 +386,12 @@ namespace noa::pms::pumas {
         using MDFPath = utils::Path;
         using DEDXPath = utils::Path;
         using BinaryPath = utils::Path;
+        using CachePath = utils::Path;
 
         Particle particle{default_particle};
         Physics *physics{nullptr};
+        // Backing storage of physics mapped from a binary dump, see load_physics
+        std::optional<utils::MappedFile> mapping{};
 
         std::vector<MediumU> media{};
         std::vector<LocalsCbFunc> media_locals;
@@ -186,30 +400,94 @@ namespace noa::pms::pumas {
 
         inline utils::Status create_physics(
                 const MDFPath &mdf_path,
-                const DEDXPath &dedx_path) {
+                const DEDXPath &dedx_path,
+                int n_threads) {
             if (utils::check_path_exists(mdf_path) && utils::check_path_exists(dedx_path)) {
+                // Other settings are left to PUMAS defaults
+                pumas_physics_settings settings{};
+                settings.n_threads = n_threads;
                 const auto status =
-                        pumas_physics_create(&physics, particle, mdf_path.c_str(), dedx_path.c_str(), nullptr);
+                        pumas_physics_create(&physics, particle, mdf_path.c_str(), dedx_path.c_str(), &settings);
                 return status == PUMAS_RETURN_SUCCESS;
             }
             return false;
         }
 
+        // The dump is memory mapped rather than read: tables are paged in on demand
+        // and shared between all the processes loading the same file
         inline utils::Status load_physics(const BinaryPath &binary_path) {
             if (utils::check_path_exists(binary_path)) {
-                auto handle = fopen(binary_path.c_str(), "rb");
-                if (handle == nullptr) {
-                        perror(binary_path.string().c_str());
-                        return false;
+                auto file = utils::MappedFile::map(binary_path);
+                if (!file.has_value()) return false;
+
+                // Dumps of another format are rejected here, the default PUMAS error handler exits
+                int tag = 0;
+                size_t layout[5] = {};
+                pumas_physics_dump_format(&tag, layout);
+                int header[2] = {0, 0};
+                if (file->size() >= sizeof(header)) std::memcpy(header, file->data(), sizeof(header));
+                if (header[0] != tag || static_cast<size_t>(header[1]) < layout[0] ||
+                    static_cast<size_t>(header[1]) > file->size() - sizeof(header)) {
+                    std::cerr << "Incompatible PUMAS physics dump " << binary_path << "\n";
+                    return false;
                 }
+
+                // Errors of the relocation are returned rather than handled
+                // (the error handler is global, not thread safe)
+                const auto handler = pumas_error_handler_get();
+                pumas_error_handler_set(nullptr);
                 const auto status =
-                        pumas_physics_load(&physics, handle);
-                fclose(handle);
-                return status == PUMAS_RETURN_SUCCESS;
+                        pumas_physics_map(&physics, file->data(), file->size());
+                pumas_error_handler_set(handler);
+                if (status != PUMAS_RETURN_SUCCESS) {
+                        physics = nullptr;
+                        return false;
+                }
+                mapping = std::move(file);
+                return true;
             }
             return false;
         }
 
+        // Key of the tables built from the given inputs: MDF and dE/dX contents, particle,
+        // PUMAS version and format of the dump (tag and layout of the dumped structures)
+        inline static std::optional<uint64_t> cache_key(
+                Particle particle_,
+                const MDFPath &mdf_path,
+                const DEDXPath &dedx_path) {
+            if (!utils::check_path_exists(mdf_path) || !utils::check_path_exists(dedx_path))
+                return std::nullopt;
+
+            const auto options = std::to_string(particle_) + "/" +
+                                 std::to_string(PUMAS_VERSION_MAJOR) + "." +
+                                 std::to_string(PUMAS_VERSION_MINOR) + "." +
+                                 std::to_string(PUMAS_VERSION_PATCH) + "/" +
+                                 std::to_string(sizeof(void *));
+            int tag = 0;
+            size_t layout[5] = {};
+            pumas_physics_dump_format(&tag, layout);
+            auto format = std::to_string(tag);
+            for (const auto size : layout) format += "/" + std::to_string(size);
+            auto key = utils::fnv1a_file(mdf_path, utils::fnv1a(format, utils::fnv1a(options)));
+            if (!key.has_value()) return std::nullopt;
+
+            auto dedx_files = std::vector<utils::Path>{};
+            for (const auto &entry : std::filesystem::directory_iterator{dedx_path})
+                if (entry.is_regular_file()) dedx_files.push_back(entry.path());
+            std::sort(dedx_files.begin(), dedx_files.end());
+            for (const auto &file : dedx_files) {
+                key = utils::fnv1a_file(file, utils::fnv1a(file.filename().string(), key.value()));
+                if (!key.has_value()) return std::nullopt;
+            }
+            return key;
+        }
+
+        inline static CachePath cache_file(const CachePath &cache_dir, uint64_t key) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx.pumas", static_cast<unsigned long long>(key));
+            return cache_dir / name;
+        }
+
         static double locals_callback(Medium* medium, pumas_state* state, Locals* locals) {
                 const auto* meta = (MediumU::Meta*)(medium + 1);
                 const auto& idx = meta->medium_index;
@@ -228,19 +506,23 @@ namespace noa::pms::pumas {
 
         PhysicsModel(PhysicsModel &&other)
         noexcept
-                : particle{other.particle}, physics{other.physics} {
+                : particle{other.particle}, physics{other.physics}, mapping{std::move(other.mapping)} {
             other.physics = nullptr;
+            other.mapping.reset();
         }
 
         auto &operator=(PhysicsModel &&other) noexcept {
             particle = other.particle;
             physics = other.physics;
+            mapping = std::move(other.mapping);
             other.physics = nullptr;
+            other.mapping.reset();
             return *this;
         }
 
         ~PhysicsModel() {
-            pumas_physics_destroy(&physics);
+            // Mapped physics lives in the mapping, released along with it
+            if (!mapping.has_value()) pumas_physics_destroy(&physics);
             physics = nullptr;
         }
 
@@ -322,11 +604,13 @@ namespace noa::pms::pumas {
             return true;
         }
 
+        // Tabulation is spread over n_threads (OpenMP default if not positive)
         inline static PhysicsModelOpt load_from_mdf(
                 const MDFPath &mdf_path,
-                const DEDXPath &dedx_path) {
+                const DEDXPath &dedx_path,
+                int n_threads = 0) {
             auto model = PhysicsModel{};
-            const auto status = model.create_physics(mdf_path, dedx_path);
+            const auto status = model.create_physics(mdf_path, dedx_path, n_threads);
             return status ? PhysicsModelOpt{std::move(model)} : PhysicsModelOpt{};
         }
 
@@ -336,6 +620,45 @@ namespace noa::pms::pumas {
             return status ? PhysicsModelOpt{std::move(model)} : PhysicsModelOpt{};
         }
 
+        // Load the tables for the given MDF from a content-addressed cache, building them on a miss.
+        // Cache entries are keyed by the MDF and dE/dX contents, so that stale tables are never picked up.
+        inline static PhysicsModelOpt load_cached(
+                const MDFPath &mdf_path,
+                const DEDXPath &dedx_path,
+                const CachePath &cache_dir,
+                int n_threads = 0) {
+            const auto key = cache_key(default_particle, mdf_path, dedx_path);
+            if (!key.has_value()) return std::nullopt;
+
+            const auto cached = cache_file(cache_dir, key.value());
+            if (std::filesystem::exists(cached)) {
+                auto model = load_from_binary(cached);
+                if (model.has_value()) return model;
+                std::cerr << "Rebuilding invalid cache entry " << cached << "\n";
+            }
+
+            auto model = load_from_mdf(mdf_path, dedx_path, n_threads);
+            if (!model.has_value()) return std::nullopt;
+
+            // Missing dE/dX tables are generated by PUMAS while building, key on the final inputs
+            const auto built_key = cache_key(default_particle, mdf_path, dedx_path);
+            if (!built_key.has_value()) return model;
+            std::error_code error;
+            std::filesystem::create_directories(cache_dir, error);
+            const auto target = cache_file(cache_dir, built_key.value());
+            // Concurrent builders each write their own file, the last rename wins
+            auto temporary = target;
+            temporary += "." + std::to_string(::getpid()) + ".tmp";
+            if (model->save_binary(temporary)) {
+                std::filesystem::rename(temporary, target, error);
+                if (error) {
+                    std::cerr << "Failed to store " << target << ": " << error.message() << "\n";
+                    std::filesystem::remove(temporary, error);
+                }
+            }
+            return model;
+        }
+
     };
 
     using MuonModel     = PhysicsModel<PUMAS_PARTICLE_MUON>;
@@ -29,6 +29,11 @@
 #include <noa/3rdparty/tnl-noa/src/TNL/Meshes/Topologies/Tetrahedron.h>
 #include <noa/3rdparty/tnl-noa/src/TNL/Meshes/Mesh.h>
 #include <noa/3rdparty/tnl-noa/src/TNL/Containers/StaticArray.h>
+#include <noa/3rdparty/tnl-noa/src/TNL/Containers/Array.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 namespace noa::pms::trace {
     using namespace noa::TNL;
@@ -40,7 +45,10 @@ namespace noa::pms::trace {
         using CellTopology = Meshes::Topologies::Tetrahedron;
         using MeshConfig = Meshes::DefaultConfig<CellTopology, CellTopology::dimension, Real, Index, LocalIndex>;
         using Mesh = Meshes::Mesh<MeshConfig, DeviceType>;
+        using HostMesh = Meshes::Mesh<MeshConfig, Devices::Host>;
         using Point = typename Mesh::PointType;
+        using IndexArray = Array<Index, DeviceType, Index>;
+        using IndexView = typename IndexArray::ConstViewType;
 
         __cuda_callable__
         static Real get_ray_plane_intersection(
@@ -112,7 +120,110 @@ namespace noa::pms::trace {
             return check0 && check1 && check2 && check3;
         }
 
+        __cuda_callable__
+        static void get_tetrahedron_points(const Mesh *mesh_pointer, const Index tetrahedron_global_index, Point *points) {
+            const typename Mesh::Cell &tetrahedron = mesh_pointer->template getEntity<Mesh::getMeshDimension()>(
+                    tetrahedron_global_index);
+            for (LocalIndex point_id = 0; point_id < 4; point_id++) {
+                points[point_id] = mesh_pointer->template getEntity<0>(
+                        tetrahedron.template getSubentityIndex<0>(point_id)).getPoint();
+            }
+        }
+
+        /// Barycentric coordinates of a point (affine = true) or of a vector (affine = false),
+        /// the i-th one vanishes on the face opposite to the i-th vertex
+        __cuda_callable__
+        static void get_barycentric(const Point *points, const Point &vector, bool affine, Real *lambda) {
+            const Point edge1 = points[1] - points[0];
+            const Point edge2 = points[2] - points[0];
+            const Point edge3 = points[3] - points[0];
+            const Point relative = affine ? Point(vector - points[0]) : vector;
+            const Real volume = dot(edge1, VectorProduct(edge2, edge3));
+
+            lambda[1] = dot(relative, VectorProduct(edge2, edge3)) / volume;
+            lambda[2] = dot(relative, VectorProduct(edge3, edge1)) / volume;
+            lambda[3] = dot(relative, VectorProduct(edge1, edge2)) / volume;
+            lambda[0] = (affine ? Real(1) : Real(0)) - lambda[1] - lambda[2] - lambda[3];
+        }
+
+        __cuda_callable__
+        static bool check_point_in_tetrahedron(
+                const Mesh *mesh_pointer,
+                const Index tetrahedron_global_index,
+                const Point &point,
+                Real tolerance) {
+            Point points[4] = {};
+            get_tetrahedron_points(mesh_pointer, tetrahedron_global_index, points);
+            Real lambda[4];
+            get_barycentric(points, point, true, lambda);
+            return lambda[0] >= -tolerance && lambda[1] >= -tolerance &&
+                   lambda[2] >= -tolerance && lambda[3] >= -tolerance;
+        }
+
     public:
+        using MeshType = Mesh;
+        using PointType = Point;
+
+        /// Axis aligned bounding box
+        struct BoundingBox {
+            Point lower;
+            Point upper;
+
+            __cuda_callable__
+            bool contains(const Point &point) const {
+                for (int i = 0; i < 3; i++) {
+                    if (point[i] < lower[i] || point[i] > upper[i]) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            /// Distance along the ray to the box (slab test)
+            /// \param origin Ray origin
+            /// \param direction Ray direction
+            /// \return 0 -- if the origin is inside, -1 -- if the ray misses the box
+            __cuda_callable__
+            Real get_entry_distance(const Point &origin, const Point &direction) const {
+                Real entry = 0;
+                Real exit = std::numeric_limits<Real>::max();
+                for (int i = 0; i < 3; i++) {
+                    if (direction[i] == 0) {
+                        if (origin[i] < lower[i] || origin[i] > upper[i]) {
+                            return -1;
+                        }
+                        continue;
+                    }
+                    const Real t0 = (lower[i] - origin[i]) / direction[i];
+                    const Real t1 = (upper[i] - origin[i]) / direction[i];
+                    entry = TNL::max(entry, TNL::min(t0, t1));
+                    exit = TNL::min(exit, TNL::max(t0, t1));
+                    if (entry > exit) {
+                        return -1;
+                    }
+                }
+                return entry;
+            }
+        };
+
+        /// Get the bounding box of a mesh
+        /// \param mesh_pointer Pointer to host mesh
+        /// \return Bounding box of the mesh vertices
+        static BoundingBox get_bounding_box(const Mesh *mesh_pointer) {
+            BoundingBox box;
+            box.lower = std::numeric_limits<Real>::max();
+            box.upper = std::numeric_limits<Real>::lowest();
+            const Index vertices = mesh_pointer->template getEntitiesCount<0>();
+            for (Index vertex = 0; vertex < vertices; vertex++) {
+                const Point &point = mesh_pointer->template getEntity<0>(vertex).getPoint();
+                for (int i = 0; i < 3; i++) {
+                    box.lower[i] = TNL::min(box.lower[i], point[i]);
+                    box.upper[i] = TNL::max(box.upper[i], point[i]);
+                }
+            }
+            return box;
+        }
+
         /// Intersection structure
         struct Intersection {
             /// Index of the first triangle on the ray
@@ -125,8 +236,316 @@ namespace noa::pms::trace {
             /// True -- if distance between first triangle on the ray and second triangle less than epsilon,
             /// False -- if otherwise
             bool is_intersection_with_triangle = true;
+
+            /// Tetrahedron left and local index of the vertex opposite to the face crossed,
+            /// only set by get_exit_face_in_tetrahedron
+            Index tetrahedron_global_index = -1;
+            LocalIndex opposite_vertex = -1;
+        };
+
+        /// Device view of the mesh adjacency, see Adjacency
+        struct AdjacencyView {
+            IndexView cell_faces;
+            IndexView face_neighbours;
+            IndexView vertex_offsets;
+            IndexView vertex_cells;
+            IndexView border_faces;
+        };
+
+        /// Compact (CSR) adjacency of the mesh cells, built once per mesh
+        struct Adjacency {
+            /// [4 * cells] global index of the face opposite to each local vertex of a cell
+            IndexArray cell_faces;
+            /// [4 * cells] cell across the face opposite to each local vertex of a cell, -1 on the mesh border
+            IndexArray face_neighbours;
+            /// [vertices + 1] offsets of the cells around each vertex in vertex_cells
+            IndexArray vertex_offsets;
+            /// [4 * cells] cells around each vertex, the larger ones first
+            IndexArray vertex_cells;
+            /// [border faces] 4 * cell + local index of the opposite vertex, for the faces on the mesh border
+            IndexArray border_faces;
+
+            AdjacencyView get_view() const {
+                return {cell_faces.getConstView(), face_neighbours.getConstView(),
+                        vertex_offsets.getConstView(), vertex_cells.getConstView(), border_faces.getConstView()};
+            }
         };
 
+        /// Build the adjacency of a mesh
+        /// \param mesh Host copy of the mesh
+        /// \return Adjacency arrays, allocated on the device
+        static Adjacency build_adjacency(const HostMesh &mesh) {
+            const Index cells = mesh.template getEntitiesCount<3>();
+            const Index vertices = mesh.template getEntitiesCount<0>();
+
+            std::vector<Index> cell_faces(4 * cells), face_neighbours(4 * cells), vertex_cells(4 * cells);
+            std::vector<Index> vertex_offsets(vertices + 1, 0);
+            std::vector<Index> border_faces;
+            std::vector<Real> volumes(cells);
+
+            for (Index cell = 0; cell < cells; cell++) {
+                const auto &tetrahedron = mesh.template getEntity<3>(cell);
+                Index vertex[4];
+                Point points[4];
+                for (LocalIndex point_id = 0; point_id < 4; point_id++) {
+                    vertex[point_id] = tetrahedron.template getSubentityIndex<0>(point_id);
+                    points[point_id] = mesh.template getEntity<0>(vertex[point_id]).getPoint();
+                    vertex_offsets[vertex[point_id] + 1]++;
+                }
+                const Point edge2 = points[2] - points[0];
+                const Point edge3 = points[3] - points[0];
+                volumes[cell] = TNL::abs(dot(points[1] - points[0], VectorProduct(edge2, edge3)));
+
+                for (LocalIndex face_id = 0; face_id < 4; face_id++) {
+                    const Index face_global_index = tetrahedron.template getSubentityIndex<2>(face_id);
+                    const auto &face = mesh.template getEntity<2>(face_global_index);
+
+                    LocalIndex opposite = 0;
+                    for (LocalIndex point_id = 0; point_id < 4; point_id++) {
+                        bool on_face = false;
+                        for (LocalIndex face_point = 0; face_point < 3; face_point++) {
+                            on_face = on_face || face.template getSubentityIndex<0>(face_point) == vertex[point_id];
+                        }
+                        if (!on_face) {
+                            opposite = point_id;
+                        }
+                    }
+
+                    Index neighbour = -1;
+                    for (LocalIndex tetrahedron_id = 0;
+                         tetrahedron_id < face.template getSuperentitiesCount<3>(); tetrahedron_id++) {
+                        const Index other = face.template getSuperentityIndex<3>(tetrahedron_id);
+                        if (other != cell) {
+                            neighbour = other;
+                        }
+                    }
+                    cell_faces[4 * cell + opposite] = face_global_index;
+                    face_neighbours[4 * cell + opposite] = neighbour;
+                    if (neighbour < 0) {
+                        border_faces.push_back(4 * cell + opposite);
+                    }
+                }
+            }
+
+            for (Index vertex = 0; vertex < vertices; vertex++) {
+                vertex_offsets[vertex + 1] += vertex_offsets[vertex];
+            }
+            std::vector<Index> cursor(vertex_offsets.begin(), vertex_offsets.end() - 1);
+            for (Index cell = 0; cell < cells; cell++) {
+                const auto &tetrahedron = mesh.template getEntity<3>(cell);
+                for (LocalIndex point_id = 0; point_id < 4; point_id++) {
+                    vertex_cells[cursor[tetrahedron.template getSubentityIndex<0>(point_id)]++] = cell;
+                }
+            }
+            // A ray through a vertex is more likely to enter one of its larger cells
+            for (Index vertex = 0; vertex < vertices; vertex++) {
+                std::sort(vertex_cells.begin() + vertex_offsets[vertex], vertex_cells.begin() + vertex_offsets[vertex + 1],
+                          [&volumes](const Index a, const Index b) { return volumes[a] > volumes[b]; });
+            }
+
+            Adjacency adjacency;
+            adjacency.cell_faces = Array<Index, Devices::Host, Index>(cell_faces);
+            adjacency.face_neighbours = Array<Index, Devices::Host, Index>(face_neighbours);
+            adjacency.vertex_offsets = Array<Index, Devices::Host, Index>(vertex_offsets);
+            adjacency.vertex_cells = Array<Index, Devices::Host, Index>(vertex_cells);
+            adjacency.border_faces = Array<Index, Devices::Host, Index>(border_faces);
+            return adjacency;
+        }
+
+        /// Calculate the face the ray leaves the tetrahedron through, from barycentric coordinates
+        ///
+        /// Along the ray, each barycentric coordinate is linear: the exit is where the first one vanishes.
+        /// Unlike get_first_border_in_tetrahedron, an origin slightly outside of the tetrahedron
+        /// (e.g. after an offset along the ray) still gives its exit face.
+        /// \param mesh_pointer Pointer to device mesh
+        /// \param adjacency Adjacency view of the mesh
+        /// \param tetrahedron_global_index Current tetrahedron global index in mesh (origin located here)
+        /// \param origin Ray origin
+        /// \param direction Ray direction
+        /// \param epsilon Threshold on the distance between the first two faces crossed, see Intersection
+        /// \return Intersection structure, with the tetrahedron and the vertex opposite to the face set
+        __cuda_callable__
+        static Intersection get_exit_face_in_tetrahedron(
+                const Mesh *mesh_pointer,
+                const AdjacencyView &adjacency,
+                const Index tetrahedron_global_index,
+                const Point &origin,
+                const Point &direction,
+                Real epsilon) {
+            Point points[4] = {};
+            get_tetrahedron_points(mesh_pointer, tetrahedron_global_index, points);
+            Real lambda[4], speed[4];
+            get_barycentric(points, origin, true, lambda);
+            get_barycentric(points, direction, false, speed);
+
+            Intersection result;
+            result.distance = std::numeric_limits<Real>::max();
+            result.tetrahedron_global_index = tetrahedron_global_index;
+            Real second_minimal_distance = std::numeric_limits<Real>::max();
+
+            for (LocalIndex point_id = 0; point_id < 4; point_id++) {
+                if (speed[point_id] >= 0) {
+                    continue;
+                }
+                const Real current_distance = TNL::max(-lambda[point_id] / speed[point_id], Real(0));
+                if (current_distance < result.distance) {
+                    second_minimal_distance = result.distance;
+                    result.distance = current_distance;
+                    result.opposite_vertex = point_id;
+                } else if (current_distance < second_minimal_distance) {
+                    second_minimal_distance = current_distance;
+                }
+            }
+
+            if (result.opposite_vertex < 0) {
+                result.distance = -1;
+                return result;
+            }
+            result.nearest_face_global_index = adjacency.cell_faces[4 * tetrahedron_global_index + result.opposite_vertex];
+            if (second_minimal_distance - result.distance < epsilon) {
+                result.is_intersection_with_triangle = false;
+            }
+            return result;
+        }
+
+        /// Get next tetrahedron after an intersection from get_exit_face_in_tetrahedron
+        ///
+        /// Through a face, the next tetrahedron is read from the adjacency. Near an edge or a vertex,
+        /// the face neighbour is checked first, then the cells around the face vertices.
+        /// \param mesh_pointer Pointer to device mesh
+        /// \param adjacency Adjacency view of the mesh
+        /// \param intersection Intersection structure from get_exit_face_in_tetrahedron function
+        /// \param origin New ray origin (intersection point)
+        /// \param direction New ray direction
+        /// \param ray_offset Offset along ray for check if point (= origin + direction * ray_offset) is inside of a tetrahedron
+        /// \return {Next tetrahedron in ray} -- if success, {} - if otherwise (the ray leaves the mesh)
+        __cuda_callable__
+        static std::optional<Index> get_next_tetrahedron(
+                const Mesh *mesh_pointer,
+                const AdjacencyView &adjacency,
+                const Intersection &intersection,
+                const Point &origin,
+                const Point &direction,
+                Real ray_offset) {
+            const Index current = intersection.tetrahedron_global_index;
+            const Index neighbour = adjacency.face_neighbours[4 * current + intersection.opposite_vertex];
+            if (intersection.is_intersection_with_triangle) {
+                if (neighbour < 0) {
+                    return {};
+                }
+                return neighbour;
+            }
+
+            const Point point_with_offset = origin + direction * ray_offset;
+            const Real tolerance = std::numeric_limits<Real>::epsilon() * 16;
+            if (neighbour >= 0 && check_point_in_tetrahedron(mesh_pointer, neighbour, point_with_offset, tolerance)) {
+                return neighbour;
+            }
+
+            const typename Mesh::Cell &tetrahedron = mesh_pointer->template getEntity<Mesh::getMeshDimension()>(current);
+            for (LocalIndex point_id = 0; point_id < 4; point_id++) {
+                if (point_id == intersection.opposite_vertex) {
+                    continue;
+                }
+                const Index vertex = tetrahedron.template getSubentityIndex<0>(point_id);
+                for (Index k = adjacency.vertex_offsets[vertex]; k < adjacency.vertex_offsets[vertex + 1]; k++) {
+                    const Index candidate = adjacency.vertex_cells[k];
+                    if (candidate != current && candidate != neighbour &&
+                        check_point_in_tetrahedron(mesh_pointer, candidate, point_with_offset, tolerance)) {
+                        return candidate;
+                    }
+                }
+            }
+
+            return {};
+        }
+
+        /// Calculate where a ray outside of the mesh enters it through the border
+        ///
+        /// The mesh needs not be convex: a ray that left it may enter it again further on.
+        /// Faces of the border are tested in turn (Moller-Trumbore), keeping the nearest one the ray enters through.
+        /// \param mesh_pointer Pointer to device mesh
+        /// \param adjacency Adjacency view of the mesh
+        /// \param origin Ray origin
+        /// \param direction Ray direction
+        /// \param min_distance Only the entries further than this distance along the ray are considered
+        /// \return Intersection structure, with the distance and the tetrahedron entered, distance -1 if there is no entry
+        __cuda_callable__
+        static Intersection get_mesh_entry(
+                const Mesh *mesh_pointer,
+                const AdjacencyView &adjacency,
+                const Point &origin,
+                const Point &direction,
+                Real min_distance = 0) {
+            const Real tolerance = std::numeric_limits<Real>::epsilon() * 16;
+            Intersection result;
+            result.distance = std::numeric_limits<Real>::max();
+
+            for (Index k = 0; k < adjacency.border_faces.getSize(); k++) {
+                const Index cell = adjacency.border_faces[k] / 4;
+                const LocalIndex opposite = adjacency.border_faces[k] % 4;
+                Point points[4] = {};
+                get_tetrahedron_points(mesh_pointer, cell, points);
+                Point face[3] = {};
+                for (LocalIndex point_id = 0, j = 0; point_id < 4; point_id++) {
+                    if (point_id != opposite) {
+                        face[j++] = points[point_id];
+                    }
+                }
+
+                const Point edge1 = face[1] - face[0];
+                const Point edge2 = face[2] - face[0];
+                // Entering: the ray goes against the outward normal, away from the opposite vertex
+                const Point normal = VectorProduct(edge1, edge2);
+                const Real side = dot(points[opposite] - face[0], normal);
+                if (side == 0 || dot(direction, normal) * side <= 0) {
+                    continue;
+                }
+
+                const Point p = VectorProduct(direction, edge2);
+                const Real determinant = dot(edge1, p);
+                const Point to_origin = origin - face[0];
+                const Real u = dot(to_origin, p) / determinant;
+                if (u < -tolerance || u > 1 + tolerance) {
+                    continue;
+                }
+                const Point q = VectorProduct(to_origin, edge1);
+                const Real v = dot(direction, q) / determinant;
+                if (v < -tolerance || u + v > 1 + tolerance) {
+                    continue;
+                }
+                const Real distance = dot(edge2, q) / determinant;
+                if (distance > min_distance && distance < result.distance) {
+                    result.distance = distance;
+                    result.tetrahedron_global_index = cell;
+                    result.opposite_vertex = opposite;
+                    result.nearest_face_global_index = adjacency.cell_faces[4 * cell + opposite];
+                }
+            }
+
+            if (result.tetrahedron_global_index < 0) {
+                result.distance = -1;
+            }
+            return result;
+        }
+
+        /// Offset along a ray past the face it crosses at the point, for trace_ray
+        ///
+        /// A fixed offset vanishes below the resolution of Real (1e-12 m is no offset at all in float):
+        /// it is scaled to a few ulps of the largest of the point coordinates and the step through the cell.
+        /// \param point Crossing point
+        /// \param step Length of the ray in the cell just left
+        /// \param ray_offset Minimum offset
+        __cuda_callable__
+        static Real get_ray_offset(const Point &point, Real step, Real ray_offset) {
+            constexpr Real ulps = 8;
+            Real scale = TNL::abs(step);
+            for (int i = 0; i < 3; i++) {
+                scale = TNL::max(scale, TNL::abs(point[i]));
+            }
+            return TNL::max(ray_offset, ulps * std::numeric_limits<Real>::epsilon() * scale);
+        }
+
         /// Get next tetrahedron after intersection
         /// \param mesh_pointer Pointer to device mesh
         /// \param intersection Intersection structure from get_first_border_in_tetrahedron function
@@ -256,5 +675,108 @@ namespace noa::pms::trace {
 
             return Algorithms::reduce<DeviceType>(Index(), mesh_size, fetch, reduction, std::optional<Index>{});
         }
+
+        /// Piece of a ray inside a tetrahedron
+        struct Segment {
+            Index tetrahedron_global_index = -1;
+            Real length = 0;
+        };
+
+        /// Ordered tetrahedra crossed by a ray, with the path lengths inside them
+        using Path = std::vector<Segment>;
+
+        /// March a ray through the mesh with its adjacency, until it leaves the mesh
+        /// \param mesh_pointer Pointer to host mesh
+        /// \param adjacency Adjacency view of the mesh, see build_adjacency
+        /// \param tetrahedron_global_index Tetrahedron containing the ray origin
+        /// \param origin Ray origin
+        /// \param direction Ray direction (unit vector)
+        /// \param epsilon See get_exit_face_in_tetrahedron
+        /// \param ray_offset Minimum offset past each face, see get_ray_offset
+        /// \return Path of the ray, its lengths sum up to the distance to the mesh border
+        static Path trace_ray(
+                const Mesh *mesh_pointer,
+                const AdjacencyView &adjacency,
+                Index tetrahedron_global_index,
+                const Point &origin,
+                const Point &direction,
+                Real epsilon = 1e-7,
+                Real ray_offset = 0) {
+            Path path{};
+            Point position = origin;
+            std::optional<Index> current = tetrahedron_global_index;
+            const Index mesh_size = mesh_pointer->template getEntitiesCount<Mesh::getMeshDimension()>();
+
+            while (current && static_cast<Index>(path.size()) < mesh_size) {
+                const auto intersection = get_exit_face_in_tetrahedron(
+                        mesh_pointer, adjacency, *current, position, direction, epsilon);
+                if (intersection.distance < 0) {
+                    break;
+                }
+                path.push_back({*current, intersection.distance});
+
+                position += direction * intersection.distance;
+                current = get_next_tetrahedron(mesh_pointer, adjacency, intersection, position, direction,
+                                               get_ray_offset(position, intersection.distance, ray_offset));
+            }
+            return path;
+        }
+
+        /// March a ray through the mesh, from tetrahedron to tetrahedron, until it leaves the mesh
+        /// \param mesh_pointer Pointer to host mesh
+        /// \param tetrahedron_global_index Tetrahedron containing the ray origin
+        /// \param origin Ray origin
+        /// \param direction Ray direction (unit vector)
+        /// \param epsilon See get_first_border_in_tetrahedron
+        /// \param ray_offset Minimum offset past each face, see get_ray_offset
+        /// \return Path of the ray, its lengths sum up to the distance to the mesh border
+        ///         (the offsets past the faces are counted in the next segments)
+        static Path trace_ray(
+                const Mesh *mesh_pointer,
+                Index tetrahedron_global_index,
+                const Point &origin,
+                const Point &direction,
+                Real epsilon = 1e-7,
+                Real ray_offset = 0) {
+            Path path{};
+            Point position = origin;
+            std::optional<Index> current = tetrahedron_global_index;
+            // A straight line crosses a convex cell at most once
+            const Index mesh_size = mesh_pointer->template getEntitiesCount<Mesh::getMeshDimension()>();
+            // The origin is moved past each face, so that the face is not hit again:
+            // the offset belongs to the next segment
+            Real offset = 0;
+
+            while (current && static_cast<Index>(path.size()) < mesh_size) {
+                const auto intersection = get_first_border_in_tetrahedron(
+                        mesh_pointer, *current, position, direction, epsilon);
+                if (intersection.nearest_face_global_index < 0) {
+                    break;
+                }
+                path.push_back({*current, offset + intersection.distance});
+
+                position += direction * intersection.distance;
+                offset = get_ray_offset(position, intersection.distance, ray_offset);
+                current = get_next_tetrahedron(mesh_pointer, intersection, position, direction, offset);
+                position += direction * offset;
+            }
+            return path;
+        }
+
+        /// March a ray through the mesh, from the tetrahedron containing its origin
+        /// \return Path of the ray -- if the origin is inside the mesh, {} -- if otherwise
+        static std::optional<Path> trace_ray(
+                const Mesh *mesh_pointer,
+                const Point &origin,
+                const Point &direction,
+                Real epsilon = 1e-7,
+                Real ray_offset = 0) {
+            const auto start = get_current_tetrahedron(
+                    mesh_pointer, mesh_pointer->template getEntitiesCount<Mesh::getMeshDimension()>(), origin);
+            if (!start) {
+                return {};
+            }
+            return trace_ray(mesh_pointer, *start, origin, direction, epsilon, ray_offset);
+        }
     };
 }
@@ -0,0 +1,319 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * \file tracks.hh
+ * Binary track recording for particle transport simulations
+ */
+
+#pragma once
+
+#include "noa/utils/common.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace noa::pms::tracks {
+
+    using ParticleId = uint64_t;
+    using MediumId = int32_t;
+    using EventId = int32_t;
+
+    /// File layout:
+    ///   header: MAGIC (8 bytes), VERSION (uint32), CHUNK_CAPACITY (uint32)
+    ///   chunks: n (uint64), then the columns of n entries each, in order:
+    ///           particle (uint64), x, y, z, ux, uy, uz, energy (double), medium, event (int32)
+    inline constexpr char MAGIC[8] = {'N', 'O', 'A', 'T', 'R', 'A', 'C', 'K'};
+    inline constexpr uint32_t VERSION = 1;
+
+    /// Fixed-capacity columnar buffer of track records
+    struct Chunk {
+        static constexpr std::size_t CAPACITY = 1 << 14;
+
+        std::size_t size{0};
+        ParticleId particle[CAPACITY];
+        double position[3][CAPACITY];
+        double direction[3][CAPACITY];
+        double energy[CAPACITY];
+        MediumId medium[CAPACITY];
+        EventId event[CAPACITY];
+
+        inline bool full() const { return size == CAPACITY; }
+    };
+
+    /// Track data read back from a dump, one entry per recorded step
+    struct Tracks {
+        std::vector<ParticleId> particle;
+        std::vector<double> position[3];
+        std::vector<double> direction[3];
+        std::vector<double> energy;
+        std::vector<MediumId> medium;
+        std::vector<EventId> event;
+
+        inline std::size_t size() const { return particle.size(); }
+    };
+    using TracksOpt = std::optional<Tracks>;
+
+    /// Asynchronous writer of binary track dumps
+    ///
+    /// Each thread records through its own Writer into a private chunk. Full chunks
+    /// are handed over to a background thread that appends them to the dump, while
+    /// the writer takes a recycled chunk from a bounded pool.
+    class TrackRecorder {
+        std::ofstream stream;
+
+        std::mutex mutex;
+        std::condition_variable cv_full;
+        std::condition_variable cv_free;
+        std::deque<std::unique_ptr<Chunk>> full_chunks;
+        std::vector<std::unique_ptr<Chunk>> free_chunks;
+        std::size_t allocated{0};
+        std::size_t in_flight{0}; // submitted, not yet recycled
+        std::size_t max_chunks;
+        bool closing{false};
+
+        std::thread worker;
+
+        inline void write_chunk(const Chunk &chunk) {
+            const uint64_t n = chunk.size;
+            const auto column = [this, n](const auto *data) {
+                stream.write(reinterpret_cast<const char *>(data), n * sizeof(*data));
+            };
+            stream.write(reinterpret_cast<const char *>(&n), sizeof(n));
+            column(chunk.particle);
+            for (const auto &p : chunk.position) column(p);
+            for (const auto &d : chunk.direction) column(d);
+            column(chunk.energy);
+            column(chunk.medium);
+            column(chunk.event);
+        }
+
+        inline void run() {
+            auto lock = std::unique_lock{mutex};
+            while (true) {
+                cv_full.wait(lock, [this] { return closing || !full_chunks.empty(); });
+                if (full_chunks.empty()) break;
+
+                auto chunk = std::move(full_chunks.front());
+                full_chunks.pop_front();
+
+                lock.unlock();
+                write_chunk(*chunk);
+                chunk->size = 0;
+                lock.lock();
+
+                free_chunks.push_back(std::move(chunk));
+                in_flight--;
+                cv_free.notify_one();
+            }
+            stream.flush();
+        }
+
+        inline std::unique_ptr<Chunk> acquire() {
+            auto lock = std::unique_lock{mutex};
+            if (closing)
+                throw std::runtime_error("TrackRecorder: recording after close");
+            // Wait for a recycled chunk only when one is bound to come back
+            if (free_chunks.empty() && (allocated < max_chunks || in_flight == 0)) {
+                allocated++;
+                lock.unlock();
+                // Default-initialised: the columns are written before they are read
+                return std::make_unique_for_overwrite<Chunk>();
+            }
+            cv_free.wait(lock, [this] { return !free_chunks.empty(); });
+            auto chunk = std::move(free_chunks.back());
+            free_chunks.pop_back();
+            return chunk;
+        }
+
+        /// \return false if the chunk holds records that are dropped, the recorder being closed
+        inline bool submit(std::unique_ptr<Chunk> chunk) {
+            if (chunk == nullptr || chunk->size == 0) {
+                if (chunk != nullptr) release(std::move(chunk));
+                return true;
+            }
+            {
+                const auto lock = std::lock_guard{mutex};
+                if (closing) return false;
+                full_chunks.push_back(std::move(chunk));
+                in_flight++;
+            }
+            cv_full.notify_one();
+            return true;
+        }
+
+        inline void release(std::unique_ptr<Chunk> chunk) {
+            {
+                const auto lock = std::lock_guard{mutex};
+                free_chunks.push_back(std::move(chunk));
+            }
+            cv_free.notify_one();
+        }
+
+    public:
+        /// Per-thread recording handle, not to be shared between threads
+        class Writer {
+            friend class TrackRecorder;
+
+            TrackRecorder *owner{nullptr};
+            std::unique_ptr<Chunk> chunk{};
+
+            explicit Writer(TrackRecorder *owner_) : owner{owner_}, chunk{owner_->acquire()} {}
+
+            inline bool hand_over() {
+                if (owner == nullptr || chunk == nullptr) return true;
+                return owner->submit(std::move(chunk));
+            }
+
+        public:
+            Writer(Writer &&other) noexcept = default;
+            Writer &operator=(Writer &&other) = delete;
+
+            Writer(const Writer &other) = delete;
+            Writer &operator=(const Writer &other) = delete;
+
+            ~Writer() {
+                if (!hand_over())
+                    std::cerr << "TrackRecorder: records of a writer destroyed after close are dropped\n";
+            }
+
+            inline void record(const ParticleId particle,
+                               const double *position,
+                               const double *direction,
+                               const double energy,
+                               const MediumId medium,
+                               const EventId event) {
+                // A flush hands the chunk over, the next record takes a new one
+                if (chunk == nullptr) chunk = owner->acquire();
+                auto &c = *chunk;
+                const auto i = c.size;
+                c.particle[i] = particle;
+                for (int k = 0; k < 3; k++) {
+                    c.position[k][i] = position[k];
+                    c.direction[k][i] = direction[k];
+                }
+                c.energy[i] = energy;
+                c.medium[i] = medium;
+                c.event[i] = event;
+                c.size = i + 1;
+                if (c.full()) {
+                    if (!owner->submit(std::move(chunk)))
+                        throw std::runtime_error("TrackRecorder: recording after close");
+                }
+            }
+
+            /// Records any structure exposing PUMAS' state fields (position, direction, energy)
+            template<typename StateType>
+            inline void record(const ParticleId particle, const StateType &state,
+                               const MediumId medium, const EventId event) {
+                record(particle, state.position, state.direction, state.energy, medium, event);
+            }
+
+            /// Hand over the pending records to the background writer, the writer remains usable.
+            /// Throws if the recorder is already closed, the records being dropped
+            inline void flush() {
+                if (!hand_over())
+                    throw std::runtime_error("TrackRecorder: records flushed after close are dropped");
+            }
+        };
+
+        /// \param path Dump file, truncated if it exists
+        /// \param max_writers Expected number of concurrent writers
+        /// \param chunks_per_thread Bounds the memory held by the recorder, per concurrent writer
+        explicit TrackRecorder(const utils::Path &path,
+                               const std::size_t max_writers = 1,
+                               const std::size_t chunks_per_thread = 4)
+                : stream{path, std::ios::binary | std::ios::trunc},
+                  max_chunks{max_writers * chunks_per_thread} {
+            if (!stream.is_open())
+                throw std::runtime_error("TrackRecorder: could not open " + path.string());
+            const uint32_t capacity = Chunk::CAPACITY;
+            stream.write(MAGIC, sizeof(MAGIC));
+            stream.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+            stream.write(reinterpret_cast<const char *>(&capacity), sizeof(capacity));
+            worker = std::thread{&TrackRecorder::run, this};
+        }
+
+        TrackRecorder(const TrackRecorder &other) = delete;
+        TrackRecorder &operator=(const TrackRecorder &other) = delete;
+
+        ~TrackRecorder() { close(); }
+
+        /// Writers must be flushed or destroyed before the recorder is closed
+        inline Writer writer() { return Writer{this}; }
+
+        /// Write out all submitted chunks and stop the background thread.
+        /// Later records are rejected: see Writer::flush
+        inline void close() {
+            if (!worker.joinable()) return;
+            {
+                const auto lock = std::lock_guard{mutex};
+                closing = true;
+            }
+            cv_full.notify_one();
+            worker.join();
+            stream.close();
+        }
+    };
+
+    /// Read a binary track dump written by TrackRecorder
+    inline TracksOpt load_tracks(const utils::Path &path) {
+        if (!utils::check_path_exists(path)) return std::nullopt;
+
+        auto stream = std::ifstream{path, std::ios::binary};
+        char magic[sizeof(MAGIC)];
+        uint32_t version = 0, capacity = 0;
+        stream.read(magic, sizeof(magic));
+        stream.read(reinterpret_cast<char *>(&version), sizeof(version));
+        stream.read(reinterpret_cast<char *>(&capacity), sizeof(capacity));
+        if (!stream || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION) {
+            std::cerr << "Invalid track dump " << path << "\n";
+            return std::nullopt;
+        }
+
+        auto tracks = Tracks{};
+        uint64_t n = 0;
+        while (stream.read(reinterpret_cast<char *>(&n), sizeof(n))) {
+            const auto column = [&stream, n](auto &vec) {
+                const auto offset = vec.size();
+                vec.resize(offset + n);
+                stream.read(reinterpret_cast<char *>(vec.data() + offset), n * sizeof(vec[0]));
+            };
+            column(tracks.particle);
+            for (auto &p : tracks.position) column(p);
+            for (auto &d : tracks.direction) column(d);
+            column(tracks.energy);
+            column(tracks.medium);
+            column(tracks.event);
+            if (!stream) {
+                std::cerr << "Truncated track dump " << path << "\n";
+                return std::nullopt;
+            }
+        }
+        return tracks;
+    }
+
+} // namespace noa::pms::tracks
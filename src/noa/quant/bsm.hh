@@ -30,20 +30,62 @@
 
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <tuple>
 #include <vector>
 #include <cmath>
 #include <cstdint>
+#include <stdexcept>
 
 #include <torch/torch.h>
 
+#include "noa/utils/simd.hh"
+
 namespace noa::quant {
 
 using Slice = torch::indexing::Slice;
 
     namespace bsm_impl {
 
+    /**
+     * Factorises the tridiagonal matrix A of `brennan_schwartz` for `brennan_schwartz_solve`,
+     * eliminating the upper diagonal from the bottom. A does not change between time steps,
+     * so that it is factorised once per solve.
+     *
+     * @param inv_alpha_hat On output, inverses of the eliminated main diagonal. Size: n.
+     * @param ratio On output, ratio[i] = beta[i] / alpha_hat[i+1]. Size: n - 1.
+     */
+    inline void
+    brennan_schwartz_factor(int64_t n, const double* alpha, const double* beta, const double* gamma,
+                            double* inv_alpha_hat, double* ratio) {
+        double alpha_hat = alpha[n-1];
+        inv_alpha_hat[n-1] = 1 / alpha_hat;
+        for (int64_t i = n - 2; i >= 0; i--) {
+            ratio[i] = beta[i] / alpha_hat;
+            alpha_hat = alpha[i] - ratio[i] * gamma[i];
+            inv_alpha_hat[i] = 1 / alpha_hat;
+        }
+    }
+
+    /**
+     * Brennan-Schwartz solve of Ax - b >= 0 ; x >= g and (Ax-b)'(x-g)=0, with A factorised by
+     * `brennan_schwartz_factor`. Works in the caller's buffers, O(n).
+     *
+     * @param b_hat Scratch. Size: n.
+     * @param x On output, the solution. Size: n. May alias b.
+     */
+    inline void
+    brennan_schwartz_solve(int64_t n, const double* inv_alpha_hat, const double* ratio, const double* gamma,
+                           const double* b, const double* g, double* b_hat, double* x) {
+        b_hat[n-1] = b[n-1];
+        for (int64_t i = n - 2; i >= 0; i--)
+            b_hat[i] = b[i] - ratio[i] * b_hat[i+1];
+        x[0] = std::max(b_hat[0] * inv_alpha_hat[0], g[0]);
+        for (int64_t i = 1; i < n; i++)
+            x[i] = std::max((b_hat[i] - gamma[i-1] * x[i-1]) * inv_alpha_hat[i], g[i]);
+    }
+
     /**
      * Computes solution to Ax - b >= 0 ; x >= g and (Ax-b)'(x-g)=0.
      * A is tridiagonal matrix with alpha, beta, gamma coefficients.
@@ -57,32 +99,83 @@ using Slice = torch::indexing::Slice;
                      const torch::Tensor& gamma, const torch::Tensor& b,
                      const torch::Tensor& g) {
         int64_t n = alpha.sizes()[0];
-        torch::Tensor alpha_hat = torch::zeros(n, torch::kFloat64);
-        torch::Tensor b_hat = torch::zeros(n, torch::kFloat64);
+        torch::Tensor alpha_c = alpha.contiguous(), beta_c = beta.contiguous(), gamma_c = gamma.contiguous();
+        torch::Tensor b_c = b.contiguous(), g_c = g.contiguous();
         torch::Tensor x = torch::zeros(n, torch::kFloat64);
 
-        auto alpha_a = alpha.accessor<double, 1>();
-        auto beta_a = beta.accessor<double, 1>();
-        auto gamma_a = gamma.accessor<double, 1>();
-        auto b_a = b.accessor<double, 1>();
-        auto g_a = g.accessor<double, 1>();
-        auto alpha_hat_a = alpha_hat.accessor<double, 1>();
-        auto b_hat_a = b_hat.accessor<double, 1>();
-        auto x_a = x.accessor<double, 1>();
-
-        alpha_hat_a[n-1] = alpha_a[n-1];
-        b_hat_a[n-1] = b_a[n-1];
-        for (int64_t i = n - 2; i >= 0; i--) {
-            alpha_hat_a[i] = alpha_a[i] - beta_a[i] * gamma_a[i] / alpha_hat_a[i+1];
-            b_hat_a[i] = b_a[i] - beta_a[i] * b_hat_a[i+1] / alpha_hat_a[i+1];
-        }
-        x_a[0] = std::max(b_hat_a[0] / alpha_hat_a[0], g_a[0]);
-        for (int64_t i = 1; i < n; i++)
-            x_a[i] = std::max((b_hat_a[i] - gamma_a[i-1] * x_a[i-1]) / alpha_hat_a[i], g_a[i]);
+        std::vector<double> inv_alpha_hat(n), ratio(n), b_hat(n);
+        brennan_schwartz_factor(n, alpha_c.data_ptr<double>(), beta_c.data_ptr<double>(),
+                                gamma_c.data_ptr<double>(), inv_alpha_hat.data(), ratio.data());
+        brennan_schwartz_solve(n, inv_alpha_hat.data(), ratio.data(), gamma_c.data_ptr<double>(),
+                               b_c.data_ptr<double>(), g_c.data_ptr<double>(), b_hat.data(), x.data_ptr<double>());
         return x;
     }
 
 
+    /**
+     * Reverse mode of `brennan_schwartz_solve` at the solution x, the exercise decisions being
+     * those of the forward sweep: a point on the obstacle (x_i = g_i) depends on g_i only.
+     * Adjoints of the factorisation are accumulated for `brennan_schwartz_factor_adjoint`.
+     *
+     * @param x_bar Adjoint of x, consumed. Size: n.
+     * @param b_hat Scratch. Size: n.
+     * @param b_bar On output, adjoint of b. Size: n.
+     * @param g_bar On output, adjoint of g. Size: n.
+     * @param alpha_hat_bar Accumulates the adjoint of the eliminated main diagonal. Size: n.
+     * @param ratio_bar Accumulates the adjoint of the ratios. Size: n - 1.
+     * @param gamma_bar Accumulates the adjoint of gamma. Size: n - 1.
+     */
+    inline void
+    brennan_schwartz_solve_adjoint(int64_t n, const double* inv_alpha_hat, const double* ratio, const double* gamma,
+                                   const double* b, const double* g, const double* x, double* x_bar,
+                                   double* b_hat, double* b_bar, double* g_bar,
+                                   double* alpha_hat_bar, double* ratio_bar, double* gamma_bar) {
+        b_hat[n-1] = b[n-1];
+        for (int64_t i = n - 2; i >= 0; i--)
+            b_hat[i] = b[i] - ratio[i] * b_hat[i+1];
+
+        for (int64_t i = n - 1; i >= 0; i--) {
+            if (x[i] == g[i]) {
+                g_bar[i] = x_bar[i];
+                b_bar[i] = 0;
+                continue;
+            }
+            const double t = x_bar[i] * inv_alpha_hat[i];
+            g_bar[i] = 0;
+            b_bar[i] = t;
+            alpha_hat_bar[i] -= x[i] * t;
+            if (i > 0) {
+                x_bar[i-1] -= gamma[i-1] * t;
+                gamma_bar[i-1] -= x[i-1] * t;
+            }
+        }
+        for (int64_t i = 0; i < n - 1; i++) {
+            ratio_bar[i] -= b_hat[i+1] * b_bar[i];
+            b_bar[i+1] -= ratio[i] * b_bar[i];
+        }
+    }
+
+    /**
+     * Reverse mode of `brennan_schwartz_factor`, accumulating the adjoints of the diagonals of A.
+     * alpha_hat_bar is consumed.
+     */
+    inline void
+    brennan_schwartz_factor_adjoint(int64_t n, const double* gamma, const double* inv_alpha_hat, const double* ratio,
+                                    double* alpha_hat_bar, const double* ratio_bar,
+                                    double* alpha_bar, double* beta_bar, double* gamma_bar) {
+        for (int64_t i = 0; i < n - 1; i++) {
+            // alpha_hat[i] = alpha[i] - ratio[i] * gamma[i]
+            alpha_bar[i] += alpha_hat_bar[i];
+            const double r_bar = ratio_bar[i] - gamma[i] * alpha_hat_bar[i];
+            gamma_bar[i] -= ratio[i] * alpha_hat_bar[i];
+            // ratio[i] = beta[i] / alpha_hat[i+1]
+            beta_bar[i] += r_bar * inv_alpha_hat[i+1];
+            alpha_hat_bar[i+1] -= ratio[i] * r_bar * inv_alpha_hat[i+1];
+        }
+        alpha_bar[n-1] += alpha_hat_bar[n-1];
+    }
+
+
     /**
      * Computes diagonals of the A matrix (for implicit step).
      * @return alpha, beta, gamma for `noa::quant::brennan_schwartz()`
@@ -112,17 +205,21 @@ using Slice = torch::indexing::Slice;
     }
 
 
-    torch::Tensor
-    get_crank_B_matrix(int64_t n_points, double lambda) {
-        torch::Tensor B = torch::zeros({n_points, n_points}, torch::kFloat64);
-        auto B_a = B.accessor<double, 2>();
-        for (int64_t i = 0; i < n_points - 1; i++) {
-            B_a[i][i] = 1 - lambda;
-            B_a[i][i + 1] = lambda / 2;
-            B_a[i + 1][i] = lambda / 2;
+    /**
+     * Explicit half of the Crank-Nicolson step, f = B w with B tridiagonal:
+     * 1 - lambda on the main diagonal, lambda / 2 on the off diagonals. O(n), f must not alias w.
+     */
+    inline void
+    crank_explicit_step(int64_t n, double lambda, const double* w, double* f) {
+        const double diag = 1 - lambda, off = lambda / 2;
+        if (n == 1) {
+            f[0] = diag * w[0];
+            return;
         }
-        B_a[n_points - 1][n_points - 1] = 1 - lambda;
-        return B;
+        f[0] = diag * w[0] + off * w[1];
+        for (int64_t i = 1; i < n - 1; i++)
+            f[i] = diag * w[i] + off * (w[i-1] + w[i+1]);
+        f[n-1] = diag * w[n-1] + off * w[n-2];
     }
 
 
@@ -137,22 +234,91 @@ using Slice = torch::indexing::Slice;
               double K, double T, double r, double sigma) {
         double k = 2 * r / std::pow(sigma, 2);
         double coef = 0.25 * std::pow(k+1, 2);
-        torch::Tensor V = torch::zeros_like(w_matrix, torch::kFloat64);
-
-        auto w_matrix_a = w_matrix.accessor<double, 2>();
-        auto x_array_a = x_array.accessor<double, 1>();
-        auto tau_array_a = tau_array.accessor<double, 1>();
-        auto V_a = V.accessor<double, 2>();
-
-        for (int64_t n = 0; n < tau_array.sizes()[0]; n++)
-            for (int64_t m = 0; m < x_array.sizes()[0]; m++)
-                V_a[m][n] = K * w_matrix_a[m][n] *
-                            std::exp(0.5 * (1-k) * x_array_a[m] - coef * tau_array_a[n]);
+        // the factor is separable in x and tau
+        torch::Tensor V = (K * w_matrix * torch::exp(0.5 * (1-k) * x_array).unsqueeze(1) *
+                           torch::exp(-coef * tau_array).unsqueeze(0)).contiguous();
         torch::Tensor t_array = T - 2 * tau_array / std::pow(sigma, 2);
         t_array.index_put_({-1}, 0.0);
         torch::Tensor S_array = K * torch::exp(x_array);
         return std::make_tuple(V, S_array, t_array);
     }
+
+
+    namespace simd = noa::utils::simd;
+
+    /**
+     * Time stepping of `price_american_put_bs` for the contracts of the lanes of a SIMD pack,
+     * each with its own grid spacing and k. The grids are interleaved lane by lane,
+     * w[m * W + lane], so that the explicit step and the Brennan-Schwartz sweeps run across
+     * the contracts. Only the current time row is kept.
+     *
+     * @param w On output, the solution at tau_max. Size: npoints_S * W.
+     * @param exercise On output, the number of grid points in the exercise region
+     *     at each time step, exercise[nu * W + lane]. Size: npoints_t * W.
+     */
+    template<typename Lanes>
+    inline void
+    american_put_lanes(int64_t npoints_S, int64_t npoints_t,
+                       const Lanes& x_min, const Lanes& delta_x, const Lanes& delta_tau, const Lanes& k,
+                       double* w, double* exercise) {
+        constexpr int W = Lanes::width;
+        const int64_t n = npoints_S;
+        const Lanes lambda = delta_tau / (delta_x * delta_x);
+        const Lanes diag = 1. - lambda, off = 0.5 * lambda;
+        const Lanes alpha = 1. + lambda, gamma = -off;  // beta = gamma
+        const Lanes growth_rate = 0.25 * (k + 1.) * (k + 1.);
+
+        std::vector<double> payoff_x(n * W), inv_alpha_hat(n * W), ratio(n * W), b_hat(n * W);
+        for (int64_t m = 0; m < n; m++) {
+            const Lanes x = x_min + static_cast<double>(m) * delta_x;
+            const Lanes payoff = exp(0.5 * (k - 1.) * x) - exp(0.5 * (k + 1.) * x);
+            max(payoff, Lanes(0.)).store(payoff_x.data() + m * W);
+        }
+        // ratio[n - 1] = 0 starts the elimination
+        Lanes alpha_hat = alpha;
+        Lanes(0.).store(ratio.data() + (n - 1) * W);
+        (1. / alpha_hat).store(inv_alpha_hat.data() + (n - 1) * W);
+        for (int64_t i = n - 2; i >= 0; i--) {
+            const Lanes r = gamma / alpha_hat;
+            r.store(ratio.data() + i * W);
+            alpha_hat = alpha - r * gamma;
+            (1. / alpha_hat).store(inv_alpha_hat.data() + i * W);
+        }
+
+        std::copy(payoff_x.begin(), payoff_x.end(), w);
+        Lanes(0.).store(exercise);
+        const Lanes payoff_min = Lanes::load(payoff_x.data());
+        const auto at = [](int64_t m) { return m * W; };
+
+        for (int64_t nu = 0; nu < npoints_t - 1; nu++) {
+            const Lanes growth = exp(growth_rate * (static_cast<double>(nu) * delta_tau));
+            const Lanes growth_next = exp(growth_rate * (static_cast<double>(nu + 1) * delta_tau));
+
+            // explicit step, fused with the elimination of the implicit step from the top of the grid
+            Lanes w_up{0.}, w_mid = Lanes::load(w + at(n - 1)), b{0.};
+            for (int64_t i = n - 1; i > 0; i--) {
+                const Lanes w_down = Lanes::load(w + at(i - 1));
+                b = diag * w_mid + off * (w_down + w_up) - Lanes::load(ratio.data() + at(i)) * b;
+                b.store(b_hat.data() + at(i));
+                w_up = w_mid;
+                w_mid = w_down;
+            }
+            // with the boundary at x_min
+            b = diag * w_mid + off * w_up + off * (growth + growth_next) * payoff_min - Lanes::load(ratio.data()) * b;
+            b.store(b_hat.data());
+
+            // the exercise region is the leading run of points on the obstacle
+            Lanes x{0.}, count{0.}, exercised{1.};
+            for (int64_t i = 0; i < n; i++) {
+                const Lanes g = growth_next * Lanes::load(payoff_x.data() + at(i));
+                x = max((Lanes::load(b_hat.data() + at(i)) - gamma * x) * Lanes::load(inv_alpha_hat.data() + at(i)), g);
+                x.store(w + at(i));
+                exercised = select(x == g, exercised, Lanes(0.));
+                count += exercised;
+            }
+            count.store(exercise + at(nu + 1));
+        }
+    }
     }  // namespace bsm_impl
 
 
@@ -190,29 +356,36 @@ price_american_put_bs(double K, double T, double r, double sigma,
     torch::Tensor x = torch::linspace(x_min, x_max, npoints_S, torch::kFloat64);
     torch::Tensor tau_array = torch::linspace(0, tau_max, npoints_t, torch::kFloat64);
     auto tau_array_a = tau_array.accessor<double, 1>();
-    torch::Tensor w_matrix = torch::zeros({npoints_S, npoints_t}, torch::kFloat64);
     auto [alpha, beta, gamma] = bsm_impl::get_A_diags(npoints_S - 1, lambda);
-    torch::Tensor B = bsm_impl::get_crank_B_matrix(npoints_S, lambda);
 
-    // setting initial and boundary conditions
-    w_matrix.index_put_({Slice(), 0},
-                        bsm_impl::g_func(torch::zeros_like(x), x, k));
-    w_matrix.index_put_({0, Slice()},
-                        bsm_impl::g_func(tau_array, torch::full_like(tau_array, x_min), k));
+    // w is stored by time step, so that each step reads and writes contiguous rows
+    torch::Tensor w_rows = torch::empty({npoints_t, npoints_S}, torch::kFloat64);
+    double* w = w_rows.data_ptr<double>();
+
+    // payoff g(tau, x) = exp((k+1)^2 tau / 4) payoff_x(x), separable in tau and x
+    torch::Tensor payoff_x = bsm_impl::g_func(torch::zeros_like(x), x, k);
+    const double* payoff_x_a = payoff_x.data_ptr<double>();
+
+    // buffers of the time stepping
+    std::vector<double> inv_alpha_hat(npoints_S), ratio(npoints_S), f(npoints_S), g(npoints_S), b_hat(npoints_S);
+    bsm_impl::brennan_schwartz_factor(npoints_S, alpha.data_ptr<double>(), beta.data_ptr<double>(),
+                                      gamma.data_ptr<double>(), inv_alpha_hat.data(), ratio.data());
+
+    // setting initial condition, the boundary at x_min enters through the explicit step
+    std::copy(payoff_x_a, payoff_x_a + npoints_S, w);
 
     for (int64_t nu = 0; nu < npoints_t - 1; nu++) {
-        torch::Tensor w = w_matrix.index({Slice(), nu});
-        torch::Tensor d = torch::zeros_like(w);
-        d.index_put_({0}, 0.5 * lambda * (bsm_impl::g_func(tau_array_a[nu], x_min, k) +
-                                                   bsm_impl::g_func(tau_array_a[nu+1], x_min, k)));
         // explicit step
-        torch::Tensor f = torch::matmul(B, w) + d;
-        f = f.squeeze();
+        bsm_impl::crank_explicit_step(npoints_S, lambda, w + nu * npoints_S, f.data());
+        f[0] += 0.5 * lambda * (bsm_impl::g_func(tau_array_a[nu], x_min, k) +
+                                bsm_impl::g_func(tau_array_a[nu+1], x_min, k));
         // implicit step
-        torch::Tensor w_ = bsm_impl::brennan_schwartz(alpha, beta, gamma, f,
-                bsm_impl::g_func(torch::full_like(x, tau_array_a[nu+1]), x, k));
-        w_matrix.index_put_({Slice(), nu+1}, w_);
+        const double growth = std::exp(0.25 * tau_array_a[nu+1] * std::pow(k+1, 2));
+        for (int64_t m = 0; m < npoints_S; m++) g[m] = growth * payoff_x_a[m];
+        bsm_impl::brennan_schwartz_solve(npoints_S, inv_alpha_hat.data(), ratio.data(), gamma.data_ptr<double>(),
+                                         f.data(), g.data(), b_hat.data(), w + (nu + 1) * npoints_S);
     }
+    torch::Tensor w_matrix = w_rows.t();
     return bsm_impl::transform(w_matrix, x, tau_array, K, T, r, sigma);
 }
 
@@ -250,4 +423,263 @@ find_early_exercise(const torch::Tensor& V, const torch::Tensor& S_array,
     return std::make_tuple(stop_V_values, stop_S_values);
 }
 
+
+/**
+ * Calculates the values of a book of American put options under the Black-Scholes model,
+ * using the Brennan-Schwartz algorithm on the grids of `price_american_put_bs`.
+ *
+ * The grids of SIMD width contracts are solved together, interleaved so that the sweeps
+ * vectorise across the contracts, and the blocks of contracts in parallel.
+ * Only the current time row of each grid is kept, the cost per contract being that
+ * of `price_american_put_bs` without the (S, t) grid of values.
+ *
+ * @param S0 Spot prices. Shape: (n_contracts,).
+ * @param K Strike prices. Shape: (n_contracts,).
+ * @param T Times to expiry in years. Shape: (n_contracts,).
+ * @param r Risk-free rates. Shape: (n_contracts,).
+ * @param sigma Volatilities. Shape: (n_contracts,).
+ * @param S_min Minimum underlying price of the grids, below all the spot prices.
+ * @param S_max Maximum underlying price of the grids, above all the spot prices.
+ * @param npoints_S Number of underlying price points on the grids.
+ * @param npoints_t Number of time points on the grids.
+ * @return 1) Values of the options at S0, interpolated linearly in log S. Shape: (n_contracts,).
+ *         2) Early exercise price of the underlying at each time of the grid, as in
+ *            `find_early_exercise`: the first grid price at which holding the option beats
+ *            exercising it, K at expiry. Shape: (n_contracts, npoints_t).
+ *         3) Time values from the grids, from expiry to 0. Shape: (n_contracts, npoints_t).
+ */
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor>
+price_american_put_bs_batch(const torch::Tensor& S0, const torch::Tensor& K, const torch::Tensor& T,
+                            const torch::Tensor& r, const torch::Tensor& sigma,
+                            double S_min, double S_max,
+                            int64_t npoints_S = 1000, int64_t npoints_t = 1000) {
+    const int64_t n_contracts = S0.numel();
+    for (const auto* param : {&S0, &K, &T, &r, &sigma})
+        if (param->dim() != 1 || param->numel() != n_contracts)
+            throw std::invalid_argument("Parameters of the contracts must be 1-D tensors of the same size");
+    if (npoints_S < 2 || npoints_t < 2)
+        throw std::invalid_argument("At least 2 points are required in S and t");
+    if (n_contracts > 0 && (S0.min().item<double>() <= S_min || S0.max().item<double>() >= S_max))
+        throw std::invalid_argument("Spot prices must be inside (S_min, S_max)");
+
+    const auto as_double = [](const torch::Tensor& t) { return t.to(torch::kFloat64).contiguous(); };
+    const torch::Tensor S0_c = as_double(S0), K_c = as_double(K), T_c = as_double(T);
+    const torch::Tensor r_c = as_double(r), sigma_c = as_double(sigma);
+    const double *S0_a = S0_c.data_ptr<double>(), *K_a = K_c.data_ptr<double>(), *T_a = T_c.data_ptr<double>();
+    const double *r_a = r_c.data_ptr<double>(), *sigma_a = sigma_c.data_ptr<double>();
+
+    torch::Tensor prices = torch::empty(n_contracts, torch::kFloat64);
+    torch::Tensor stop_S = torch::empty({n_contracts, npoints_t}, torch::kFloat64);
+    double* prices_a = prices.data_ptr<double>();
+    double* stop_S_a = stop_S.data_ptr<double>();
+
+    using Lanes = simd::Pack<double>;
+    constexpr int W = Lanes::width;
+    const int64_t n_blocks = (n_contracts + W - 1) / W;
+    const double x_range = std::log(S_max / S_min);
+    const double steps_S = static_cast<double>(npoints_S) - 1.0;
+    const double steps_t = static_cast<double>(npoints_t) - 1.0;
+
+    at::parallel_for(0, n_blocks, 1, [&](int64_t begin, int64_t end) {
+        std::vector<double> w(npoints_S * W), exercise(npoints_t * W);
+        for (int64_t block = begin; block < end; block++) {
+            const int64_t first = block * W;
+            const int n = static_cast<int>(std::min<int64_t>(W, n_contracts - first));
+            const Lanes strike = Lanes::load(K_a + first, n);
+            const Lanes vol = Lanes::load(sigma_a + first, n);
+            const Lanes x_min = log(Lanes(S_min) / strike);
+            const Lanes delta_x = Lanes(x_range / steps_S);
+            const Lanes tau_max = 0.5 * Lanes::load(T_a + first, n) * vol * vol;
+            const Lanes k = 2. * Lanes::load(r_a + first, n) / (vol * vol);
+            bsm_impl::american_put_lanes(npoints_S, npoints_t, x_min, delta_x, tau_max / steps_t, k,
+                                         w.data(), exercise.data());
+
+            for (int lane = 0; lane < n; lane++) {
+                const int64_t c = first + lane;
+                const double k_c = k[lane], x0 = std::log(S0_a[c] / K_a[c]);
+                const double p = (x0 - x_min[lane]) / delta_x[lane];
+                const int64_t m = std::clamp<int64_t>(static_cast<int64_t>(p), 0, npoints_S - 2);
+                const auto value = [&](int64_t i) {
+                    const double x = x_min[lane] + static_cast<double>(i) * delta_x[lane];
+                    return K_a[c] * w[i * W + lane] *
+                           std::exp(0.5 * (1 - k_c) * x - 0.25 * (k_c + 1) * (k_c + 1) * tau_max[lane]);
+                };
+                const double t = p - static_cast<double>(m);
+                prices_a[c] = (1 - t) * value(m) + t * value(m + 1);
+
+                stop_S_a[c * npoints_t] = K_a[c];
+                for (int64_t nu = 1; nu < npoints_t; nu++) {
+                    const auto i = std::min(static_cast<int64_t>(exercise[nu * W + lane]), npoints_S - 1);
+                    stop_S_a[c * npoints_t + nu] = S_min * std::exp(static_cast<double>(i) * delta_x[lane]);
+                }
+            }
+        }
+    });
+
+    torch::Tensor t_array = T_c.unsqueeze(1) *
+            (1 - torch::linspace(0, 1, npoints_t, torch::kFloat64)).unsqueeze(0);
+    t_array.index_put_({Slice(), -1}, 0.0);
+    return std::make_tuple(prices, stop_S, t_array);
+}
+
+
+/// Value and sensitivities of an American put option, see `price_american_put_bs_greeks`
+struct AmericanPutGreeks {
+    double price;
+    double delta;
+    double gamma;
+    double vega;
+    double rho;
+    double theta;  // -dV/dT, per year
+};
+
+/**
+ * Calculates the value of American put option under the Black-Scholes model and its Greeks,
+ * using the Brennan-Schwartz algorithm on the grid of `price_american_put_bs`.
+ *
+ * Delta and gamma are differences on the grid at S0. Vega, rho and theta are computed by
+ * one reverse sweep of the time stepping, the adjoint of the tridiagonal solves keeping the
+ * exercise decisions of the forward pass. They are the exact derivatives of the discrete
+ * price, at about twice the cost of a price.
+ *
+ * @param S0 Spot price, inside (S_min, S_max).
+ * @param K Strike price.
+ * @param T Time to expiry in years.
+ * @param r Risk-free rate.
+ * @param sigma Volatility.
+ * @param S_min Minimum underlying price for the (S, t) grid.
+ * @param S_max Maximum underlying price for the (S, t) grid.
+ * @param npoints_S Number of underlying price points on the grid, at least 4.
+ * @param npoints_t Number of time points on the grid.
+ * @return Value of the option at S0, interpolated linearly in log S, with its Greeks.
+ */
+AmericanPutGreeks
+price_american_put_bs_greeks(double S0, double K, double T, double r, double sigma,
+                             double S_min, double S_max,
+                             int64_t npoints_S = 1000, int64_t npoints_t = 1000) {
+    if (npoints_S < 4 || npoints_t < 2)
+        throw std::invalid_argument("At least 4 points in S and 2 in t are required");
+    if (S0 <= S_min || S0 >= S_max)
+        throw std::invalid_argument("Spot price must be inside (S_min, S_max)");
+
+    const int64_t n = npoints_S;
+    const double tau_max = 0.5 * T * std::pow(sigma, 2);
+    const double x_min = std::log(S_min / K);
+    const double x_max = std::log(S_max / K);
+    const double delta_tau = tau_max / (static_cast<double>(npoints_t) - 1.0);
+    const double delta_x = (x_max - x_min) / (static_cast<double>(npoints_S) - 1.0);
+    const double lambda = delta_tau / std::pow(delta_x, 2);
+    const double k = 2*r / std::pow(sigma, 2);
+    const double c = 0.25 * std::pow(k+1, 2);
+
+    std::vector<double> x(n), payoff_x(n);
+    for (int64_t m = 0; m < n; m++) {
+        x[m] = x_min + static_cast<double>(m) * delta_x;
+        payoff_x[m] = bsm_impl::g_func(0., x[m], k);
+    }
+    const auto growth = [&](int64_t j) { return std::exp(c * static_cast<double>(j) * delta_tau); };
+
+    std::vector<double> alpha(n, 1 + lambda), beta(n - 1, -0.5 * lambda), gamma(n - 1, -0.5 * lambda);
+    std::vector<double> inv_alpha_hat(n), ratio(n), f(n), g(n), b_hat(n);
+    bsm_impl::brennan_schwartz_factor(n, alpha.data(), beta.data(), gamma.data(), inv_alpha_hat.data(), ratio.data());
+
+    // forward pass, keeping the rows of w for the reverse sweep
+    std::vector<double> w(npoints_t * n);
+    std::copy(payoff_x.begin(), payoff_x.end(), w.begin());
+    const auto explicit_step = [&](int64_t nu) {
+        bsm_impl::crank_explicit_step(n, lambda, w.data() + nu * n, f.data());
+        const double growth_next = growth(nu + 1);
+        f[0] += 0.5 * lambda * (growth(nu) + growth_next) * payoff_x[0];
+        for (int64_t m = 0; m < n; m++) g[m] = growth_next * payoff_x[m];
+    };
+    for (int64_t nu = 0; nu < npoints_t - 1; nu++) {
+        explicit_step(nu);
+        bsm_impl::brennan_schwartz_solve(n, inv_alpha_hat.data(), ratio.data(), gamma.data(),
+                                         f.data(), g.data(), b_hat.data(), w.data() + (nu + 1) * n);
+    }
+
+    // V = K w exp(0.5 (1-k) x - c tau_max) at tau_max, interpolated linearly in x
+    const double* w_T = w.data() + (npoints_t - 1) * n;
+    const auto scale = [&](int64_t m) { return K * std::exp(0.5 * (1-k) * x[m] - c * tau_max); };
+    const auto value = [&](int64_t m) { return scale(m) * w_T[m]; };
+    const double x0 = std::log(S0 / K);
+    const int64_t m0 = std::clamp<int64_t>(static_cast<int64_t>((x0 - x_min) / delta_x), 1, n - 3);
+    const double t0 = (x0 - x[m0]) / delta_x;
+    const double weights[2] = {1 - t0, t0};
+
+    AmericanPutGreeks greeks{};
+    double V_x = 0, V_xx = 0;
+    for (int j = 0; j < 2; j++) {
+        const int64_t m = m0 + j;
+        greeks.price += weights[j] * value(m);
+        V_x += weights[j] * (value(m + 1) - value(m - 1)) / (2 * delta_x);
+        V_xx += weights[j] * (value(m + 1) - 2 * value(m) + value(m - 1)) / (delta_x * delta_x);
+    }
+    greeks.delta = V_x / S0;
+    greeks.gamma = (V_xx - V_x) / (S0 * S0);
+
+    // reverse sweep
+    double k_bar = 0, c_bar = 0, tau_max_bar = 0, delta_tau_bar = 0, lambda_bar = 0;
+    std::vector<double> w_bar(n, 0.), f_bar(n), g_bar(n), payoff_x_bar(n, 0.);
+    std::vector<double> alpha_hat_bar(n, 0.), ratio_bar(n, 0.), gamma_bar(n, 0.);
+    for (int j = 0; j < 2; j++) {
+        const int64_t m = m0 + j;
+        w_bar[m] = weights[j] * scale(m);
+        k_bar -= 0.5 * x[m] * weights[j] * value(m);
+    }
+    c_bar -= tau_max * greeks.price;
+    tau_max_bar -= c * greeks.price;
+
+    const auto growth_adjoint = [&](int64_t j, double growth_bar) {
+        c_bar += growth_bar * growth(j) * static_cast<double>(j) * delta_tau;
+        delta_tau_bar += growth_bar * growth(j) * c * static_cast<double>(j);
+    };
+    for (int64_t nu = npoints_t - 2; nu >= 0; nu--) {
+        explicit_step(nu);
+        bsm_impl::brennan_schwartz_solve_adjoint(n, inv_alpha_hat.data(), ratio.data(), gamma.data(),
+                                                 f.data(), g.data(), w.data() + (nu + 1) * n, w_bar.data(),
+                                                 b_hat.data(), f_bar.data(), g_bar.data(),
+                                                 alpha_hat_bar.data(), ratio_bar.data(), gamma_bar.data());
+        // g = growth(nu + 1) payoff_x
+        const double growth_next = growth(nu + 1);
+        double growth_next_bar = 0;
+        for (int64_t m = 0; m < n; m++) {
+            growth_next_bar += g_bar[m] * payoff_x[m];
+            payoff_x_bar[m] += g_bar[m] * growth_next;
+        }
+        // boundary at x_min
+        const double boundary_bar = 0.5 * lambda * payoff_x[0] * f_bar[0];
+        lambda_bar += 0.5 * (growth(nu) + growth_next) * payoff_x[0] * f_bar[0];
+        payoff_x_bar[0] += 0.5 * lambda * (growth(nu) + growth_next) * f_bar[0];
+        growth_adjoint(nu, boundary_bar);
+        growth_adjoint(nu + 1, growth_next_bar + boundary_bar);
+        // explicit step, B being symmetric
+        const double* w_nu = w.data() + nu * n;
+        for (int64_t m = 0; m < n; m++) {
+            const double neighbours = (m > 0 ? w_nu[m-1] : 0.) + (m < n - 1 ? w_nu[m+1] : 0.);
+            lambda_bar += f_bar[m] * (0.5 * neighbours - w_nu[m]);
+        }
+        bsm_impl::crank_explicit_step(n, lambda, f_bar.data(), w_bar.data());
+    }
+    for (int64_t m = 0; m < n; m++) payoff_x_bar[m] += w_bar[m];
+
+    std::vector<double> alpha_bar(n, 0.), beta_bar(n, 0.);
+    bsm_impl::brennan_schwartz_factor_adjoint(n, gamma.data(), inv_alpha_hat.data(), ratio.data(),
+                                              alpha_hat_bar.data(), ratio_bar.data(),
+                                              alpha_bar.data(), beta_bar.data(), gamma_bar.data());
+    for (int64_t m = 0; m < n; m++) lambda_bar += alpha_bar[m];
+    for (int64_t m = 0; m < n - 1; m++) lambda_bar -= 0.5 * (beta_bar[m] + gamma_bar[m]);
+    // payoff_x = max(0, exp(0.5 (k-1) x) - exp(0.5 (k+1) x))
+    for (int64_t m = 0; m < n; m++) k_bar += payoff_x_bar[m] * 0.5 * x[m] * payoff_x[m];
+
+    // chain to the parameters of the contract
+    k_bar += c_bar * 0.5 * (k + 1);
+    delta_tau_bar += lambda_bar / std::pow(delta_x, 2);
+    tau_max_bar += delta_tau_bar / (static_cast<double>(npoints_t) - 1.0);
+    greeks.vega = tau_max_bar * T * sigma - k_bar * 4 * r / std::pow(sigma, 3);
+    greeks.rho = k_bar * 2 / std::pow(sigma, 2);
+    greeks.theta = -tau_max_bar * 0.5 * std::pow(sigma, 2);
+    return greeks;
+}
+
 } // namespace noa::quant
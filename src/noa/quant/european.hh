@@ -0,0 +1,134 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * Analytic prices of European options, e.g. the controls of `noa::quant::ControlVariate`.
+ *
+ * References:
+ *     - [Heston1993] Heston, S. L. (1993). A closed-form solution for options with
+ *       stochastic volatility with applications to bond and currency options.
+ *       The Review of Financial Studies, 6(2), 327-343.
+ *
+ *     - [Lewis2001] Lewis, A. L. (2001). A simple option formula for general
+ *       jump-diffusion and other exponential Lévy processes. Available at SSRN 282110.
+ *
+ *     - [Albrecher2007] Albrecher, H., Mayer, P., Schoutens, W., & Tistaert, J. (2007).
+ *       The little Heston trap. Wilmott Magazine, January, 83-92.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+
+namespace noa::quant {
+
+    namespace european_impl {
+
+    inline double normal_cdf(double x) {
+        return 0.5 * std::erfc(-x * M_SQRT1_2);
+    }
+
+    }  // namespace european_impl
+
+
+/**
+ * Black-Scholes price of a European option.
+ *
+ * @param S0 Price of the underlying.
+ * @param K Strike.
+ * @param T Time to maturity.
+ * @param r Risk-free rate.
+ * @param sigma Volatility.
+ * @param call Call if true, put otherwise.
+ */
+inline double
+price_european_bs(double S0, double K, double T, double r, double sigma, bool call = true) {
+    if (T <= 0 || sigma <= 0)
+        throw std::invalid_argument("Maturity and volatility must be positive");
+    const double sd = sigma * std::sqrt(T);
+    const double d1 = (std::log(S0 / K) + (r + 0.5 * sigma * sigma) * T) / sd;
+    const double d2 = d1 - sd;
+    if (call)
+        return S0 * european_impl::normal_cdf(d1) - K * std::exp(-r * T) * european_impl::normal_cdf(d2);
+    return K * std::exp(-r * T) * european_impl::normal_cdf(-d2) - S0 * european_impl::normal_cdf(-d1);
+}
+
+/**
+ * Price of a European option in the Heston model (see `generate_heston` for the dynamics),
+ * with the risk-neutral drift r.
+ *
+ * The call is given by the single integral of [Lewis2001]:
+ *
+ * C = S0 - sqrt(S0·K)·exp(-rT/2) / π · ∫ Re[exp(iuk)·φ(u - i/2)] / (u² + 1/4) du, u ∈ (0, ∞),
+ *
+ * with k = log(S0/K) + rT and φ the characteristic function of log(S(T)/S0) - rT, in the form
+ * of [Albrecher2007] which is continuous in u. The integral is computed by the midpoint rule
+ * after the change of variable u = a·tan(t), a being the inverse of the standard deviation
+ * of the log-price, so that the nodes follow the decay of φ for any maturity.
+ *
+ * @param S0 Price of the underlying.
+ * @param K Strike.
+ * @param T Time to maturity.
+ * @param r Risk-free rate.
+ * @param v0 Initial variance v(0).
+ * @param kappa, theta, eps, rho Parameters of the variance, as for `generate_heston`.
+ * @param call Call if true, put otherwise.
+ * @param n_points Number of integration nodes.
+ */
+inline double
+price_european_heston(double S0, double K, double T, double r,
+                      double v0, double kappa, double theta, double eps, double rho,
+                      bool call = true, int64_t n_points = 1024) {
+    using complex = std::complex<double>;
+    if (T <= 0 || eps <= 0)
+        throw std::invalid_argument("Maturity and volatility of variance must be positive");
+
+    const double k = std::log(S0 / K) + r * T;
+    const auto phi = [&](const complex& z) {
+        const complex iz = complex(0, 1) * z;
+        const complex b = kappa - rho * eps * iz;
+        const complex d = std::sqrt(b * b + eps * eps * (iz + z * z));
+        const complex g = (b - d) / (b + d);
+        const complex e = std::exp(-d * T);
+        const complex C = kappa * theta / (eps * eps) * ((b - d) * T - 2. * std::log((1. - g * e) / (1. - g)));
+        const complex D = (b - d) / (eps * eps) * (1. - e) / (1. - g * e);
+        return std::exp(C + D * v0);
+    };
+
+    const double a = 1 / std::sqrt(std::max(std::max(v0, theta), 1e-8) * T);
+    const double h = 0.5 * M_PI / static_cast<double>(n_points);
+    double integral = 0;
+    for (int64_t j = 0; j < n_points; j++) {
+        const double t = (static_cast<double>(j) + 0.5) * h;
+        const double cos_t = std::cos(t);
+        const double u = a * std::tan(t);
+        // du = a dt / cos²(t)
+        integral += std::real(std::exp(complex(0, u * k)) * phi(complex(u, -0.5))) *
+                    a / (cos_t * cos_t * (u * u + 0.25)) * h;
+    }
+    const double call_price = S0 - std::sqrt(S0 * K) * std::exp(-0.5 * r * T) / M_PI * integral;
+    // put-call parity: C - P = S0 - K exp(-rT)
+    return call ? call_price : call_price - S0 + K * std::exp(-r * T);
+}
+
+} // namespace noa::quant
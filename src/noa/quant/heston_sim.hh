@@ -27,17 +27,27 @@
  *
  *     - [Andersen2007] Andersen, L.B., 2007. Efficient simulation of the Heston
  *       stochastic volatility model. Available at SSRN 946405.
+ *
+ *     - [Acklam2010] Acklam, P. J. (2010). An algorithm for computing the
+ *       inverse normal cumulative distribution function.
  */
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cmath>
+#include <limits>
 #include <tuple>
 #include <stdexcept>
+#include <vector>
 
 #include <torch/torch.h>
 
+#include "noa/utils/random.hh"
+#include "noa/utils/simd.hh"
+
 namespace noa::quant {
 
 using namespace torch::indexing;
@@ -75,6 +85,709 @@ noncentral_chisquare(const torch::Tensor& df, const torch::Tensor& nonc) {
     return torch::where(psi <= PSI_CRIT, sample_quad, sample_exp);
 }
 
+    namespace heston_impl {
+
+    namespace simd = noa::utils::simd;
+
+    /**
+     * Forward mode derivative: a value with its tangents along N directions.
+     * Used to replay a path with its derivatives w.r.t. the model parameters.
+     */
+    template<int N>
+    struct Tangent {
+        double value = 0;
+        double d[N] = {};
+
+        Tangent() = default;
+
+        Tangent(double value_) : value{value_} {}
+
+        /// Independent variable, along the direction k
+        static Tangent variable(double value, int k, double dk = 1) {
+            Tangent res{value};
+            res.d[k] = dk;
+            return res;
+        }
+
+        friend Tangent operator-(const Tangent& a) {
+            Tangent res{-a.value};
+            for (int k = 0; k < N; k++) res.d[k] = -a.d[k];
+            return res;
+        }
+
+        friend Tangent operator+(const Tangent& a, const Tangent& b) {
+            Tangent res{a.value + b.value};
+            for (int k = 0; k < N; k++) res.d[k] = a.d[k] + b.d[k];
+            return res;
+        }
+
+        friend Tangent operator-(const Tangent& a, const Tangent& b) {
+            Tangent res{a.value - b.value};
+            for (int k = 0; k < N; k++) res.d[k] = a.d[k] - b.d[k];
+            return res;
+        }
+
+        friend Tangent operator*(const Tangent& a, const Tangent& b) {
+            Tangent res{a.value * b.value};
+            for (int k = 0; k < N; k++) res.d[k] = a.d[k] * b.value + a.value * b.d[k];
+            return res;
+        }
+
+        friend Tangent operator/(const Tangent& a, const Tangent& b) {
+            Tangent res{a.value / b.value};
+            for (int k = 0; k < N; k++) res.d[k] = (a.d[k] - res.value * b.d[k]) / b.value;
+            return res;
+        }
+
+        friend Tangent operator+(const Tangent& a, double b) { return a + Tangent(b); }
+        friend Tangent operator+(double a, const Tangent& b) { return Tangent(a) + b; }
+        friend Tangent operator-(const Tangent& a, double b) { return a - Tangent(b); }
+        friend Tangent operator-(double a, const Tangent& b) { return Tangent(a) - b; }
+
+        friend Tangent operator*(const Tangent& a, double b) {
+            Tangent res{a.value * b};
+            for (int k = 0; k < N; k++) res.d[k] = a.d[k] * b;
+            return res;
+        }
+
+        friend Tangent operator*(double a, const Tangent& b) { return b * a; }
+        friend Tangent operator/(const Tangent& a, double b) { return a * (1 / b); }
+        friend Tangent operator/(double a, const Tangent& b) { return Tangent(a) / b; }
+
+        friend bool operator<(const Tangent& a, const Tangent& b) { return a.value < b.value; }
+        friend bool operator<=(const Tangent& a, const Tangent& b) { return a.value <= b.value; }
+        friend bool operator>(const Tangent& a, const Tangent& b) { return a.value > b.value; }
+        friend bool operator>=(const Tangent& a, const Tangent& b) { return a.value >= b.value; }
+
+        friend Tangent sqrt(const Tangent& a) {
+            Tangent res{std::sqrt(a.value)};
+            for (int k = 0; k < N; k++) res.d[k] = a.d[k] * 0.5 / res.value;
+            return res;
+        }
+
+        friend Tangent log(const Tangent& a) {
+            Tangent res{std::log(a.value)};
+            for (int k = 0; k < N; k++) res.d[k] = a.d[k] / a.value;
+            return res;
+        }
+
+        friend Tangent exp(const Tangent& a) {
+            Tangent res{std::exp(a.value)};
+            for (int k = 0; k < N; k++) res.d[k] = a.d[k] * res.value;
+            return res;
+        }
+    };
+
+    inline double value_of(double x) { return x; }
+
+    template<int N>
+    double value_of(const Tangent<N>& x) { return x.value; }
+
+    /**
+     * Inverse of the standard normal CDF [Acklam2010], relative error below 1.15e-9.
+     * Branch-free, so that it vectorises over SIMD packs as well.
+     *
+     * @param p Probability in the open interval (0, 1).
+     */
+    template<typename R>
+    R inverse_normal_cdf(const R& p) {
+        using std::log;
+        using std::sqrt;
+        using simd::select;
+        constexpr double P_LOW = 0.02425;
+
+        // central region
+        const R q = p - 0.5;
+        const R r = q * q;
+        const R central = (((((-3.969683028665376e+01 * r + 2.209460984245205e+02) * r - 2.759285104469687e+02) * r +
+                             1.383577518672690e+02) * r - 3.066479806614716e+01) * r + 2.506628277459239e+00) * q /
+                          (((((-5.447609879822406e+01 * r + 1.615858368580409e+02) * r - 1.556989798598866e+02) * r +
+                             6.680131188771972e+01) * r - 1.328068155288572e+01) * r + 1);
+        // tails, folded onto the lower one
+        const R tail_p = select(p < 0.5, p, R(1 - p));
+        const R t = sqrt(-2 * log(tail_p));
+        const R tail = (((((-7.784894002430293e-03 * t - 3.223964580411365e-01) * t - 2.400758277161838e+00) * t -
+                          2.549732539343734e+00) * t + 4.374664141464968e+00) * t + 2.938163982698783e+00) /
+                       ((((7.784695709041462e-03 * t + 3.224671290700398e-01) * t + 2.445134137142996e+00) * t +
+                         3.754408661907416e+00) * t + 1);
+        return select(tail_p < P_LOW, select(p < 0.5, tail, R(-tail)), central);
+    }
+
+    /// Maps a uniform variate to the open interval (0, 1) in the precision of the simulation
+    template<typename scalar_t>
+    scalar_t open_unit(double u) {
+        constexpr double EPS = std::numeric_limits<scalar_t>::epsilon();
+        return static_cast<scalar_t>(std::min(std::max(u, EPS), 1 - EPS));
+    }
+
+    /**
+     * Per step constants of Andersen's QE scheme, for a set of Heston parameters.
+     * V is a scalar, a SIMD pack of scalars or a `Tangent`.
+     */
+    template<typename V>
+    struct QECoefficients {
+        V c_bar, delta, kappa_bar;  // v(t+dt) = c_bar * noncentral chi-square(delta, kappa_bar * v(t))
+        V drift_dt, k0, k1, k2, k3, k4;
+    };
+
+    template<typename V>
+    QECoefficients<V> qe_coefficients(double dt, const V& kappa, const V& theta, const V& eps,
+                                      const V& rho, const V& drift) {
+        using std::exp;
+        const V e = exp(-kappa * dt);
+        const V eps2 = eps * eps;
+
+        V gamma2 = V(0.5);
+        // regularity condition [Andersen2007, section 4.3.2], always satisfied when rho <= 0
+        if (value_of(rho) > 0) {
+            const V L = rho * dt * (kappa / eps - 0.5 * rho);
+            const V R = 2 * kappa / (eps2 * (1 - e)) - rho / eps;
+            const double l = value_of(L), r = value_of(R);
+            if (!(r <= 0 || l == 0 || (l < 0 && r >= 0)) && l > 0) {
+                const V bound = R / L * 0.9; // multiply by 0.9 to have some margin
+                gamma2 = (value_of(bound) < 0.5) ? bound : V(0.5);
+            }
+        }
+        const V gamma1 = 1.0 - gamma2;
+
+        QECoefficients<V> c;
+        c.c_bar = eps2 * (1 - e) / (4 * kappa);
+        c.delta = 4 * kappa * theta / eps2;
+        c.kappa_bar = 4 * kappa * e / (eps2 * (1 - e));
+        c.drift_dt = drift * dt;
+        c.k0 = -rho * kappa * theta * dt / eps;
+        c.k1 = gamma1 * dt * (kappa * rho / eps - 0.5) - rho / eps;
+        c.k2 = gamma2 * dt * (kappa * rho / eps - 0.5) + rho / eps;
+        c.k3 = gamma1 * dt * (1 - rho * rho);
+        c.k4 = gamma2 * dt * (1 - rho * rho);
+        return c;
+    }
+
+    /// Broadcasts scalar coefficients to SIMD lanes
+    template<typename Lanes>
+    QECoefficients<Lanes> broadcast(const QECoefficients<double>& c) {
+        return {Lanes(c.c_bar), Lanes(c.delta), Lanes(c.kappa_bar),
+                Lanes(c.drift_dt), Lanes(c.k0), Lanes(c.k1), Lanes(c.k2), Lanes(c.k3), Lanes(c.k4)};
+    }
+
+    /**
+     * One step of the variance process, with the noncentral chi-square approximated as in
+     * `noa::quant::noncentral_chisquare`, both branches driven by a single uniform variate u
+     * [Andersen2007, section 3.2.4].
+     */
+    template<typename V, typename R>
+    V qe_variance_step(const QECoefficients<V>& c, const V& v, const R& u, double minimum_value) {
+        using std::log;
+        using std::sqrt;
+        using simd::select;
+        constexpr double PSI_CRIT = 1.5;  // threshold value for switching between sampling algorithms
+
+        const V nonc = c.kappa_bar * v;
+        const V m = c.delta + nonc;
+        const V psi = (2 * c.delta + 4 * nonc) / (m * m);
+        // quadratic, only selected for psi <= PSI_CRIT, where 2 / psi - 1 > 0
+        const V psi_inv = 2 / psi;
+        const V b2 = psi_inv - 1 + sqrt(psi_inv) * sqrt(select(psi_inv > 1, V(psi_inv - 1), V(0)));
+        const V a = m / (1 + b2);
+        // b2 is clamped in the exponential lanes, negative square roots fall back to slow libm calls
+        const V z = sqrt(select(b2 > 0, b2, V(0))) + inverse_normal_cdf(u);
+        const V sample_quad = a * z * z;
+        // exponential
+        const V p = (psi - 1) / (psi + 1);
+        // 1 / beta = m / (1 - p) = m (psi + 1) / 2
+        const V sample_exp = select(p < u, V(log((1 - p) / (1 - u)) * m * (psi + 1) / 2), V(0));
+
+        const V v_next = c.c_bar * select(psi <= PSI_CRIT, sample_quad, sample_exp);
+        return select(v_next < minimum_value, V(minimum_value), v_next);
+    }
+
+    /// One step of the log-price given the variance at both ends [Andersen2007, section 4.3]
+    template<typename V, typename R>
+    V qe_log_price_step(const QECoefficients<V>& c, const V& x, const V& v, const V& v_next, const R& u) {
+        using std::sqrt;
+        return x + c.drift_dt + c.k0 + c.k1 * v + c.k2 * v_next +
+               sqrt(c.k3 * v + c.k4 * v_next) * inverse_normal_cdf(u);
+    }
+
+    namespace random = noa::utils::random;
+
+    /**
+     * The uniform variates of step s for path i come from the Philox block (s - 1) of the stream
+     * (seed, i): the first half drives the variance, the second the price. Paths can thus be replayed.
+     */
+    inline random::Counter qe_counter(int64_t step, int64_t path) {
+        const auto block = static_cast<uint64_t>(step - 1);
+        const auto stream = static_cast<uint64_t>(path);
+        return random::Counter{uint32_t(block), uint32_t(block >> 32), uint32_t(stream), uint32_t(stream >> 32)};
+    }
+
+    /**
+     * Uniform variates of the fused kernel from the Philox streams, see `qe_counter`.
+     *
+     * With `antithetic`, paths 2i and 2i + 1 both draw from the stream i, path 2i + 1 taking
+     * the reflected variates 1 - u, so the normals of the price are opposite. The variance
+     * steps are not reflected in general: the exponential branch of the QE scheme is monotone
+     * in u, but the quadratic branch a (sqrt(b2) + Φ⁻¹(u))² is not once Φ⁻¹(u) < -sqrt(b2),
+     * and the variance paths of a pair need not be negatively correlated. The pairs stay
+     * unbiased, as 1 - u is uniform too.
+     */
+    struct PhiloxUniforms {
+        random::Key key;
+        bool antithetic;
+
+        explicit PhiloxUniforms(uint64_t seed, bool antithetic_ = false)
+                : key{uint32_t(seed), uint32_t(seed >> 32)}, antithetic{antithetic_} {}
+
+        /// Variates {u_var, u_price} of a path at a step
+        std::array<double, 2> operator()(int64_t step, int64_t path) const {
+            const auto bits = random::philox4x32(qe_counter(step, antithetic ? path >> 1 : path), key);
+            std::array<double, 2> u = {random::uniform01(bits[0], bits[1]), random::uniform01(bits[2], bits[3])};
+            if (antithetic && (path & 1)) u = {1 - u[0], 1 - u[1]};
+            return u;
+        }
+
+        /// Variates of a step for the W paths starting at `first`
+        template<typename scalar_t, int W>
+        void operator()(int64_t step, int64_t first, int,
+                        simd::Pack<scalar_t, W>& u_var, simd::Pack<scalar_t, W>& u_price) const {
+            uint32_t bits[4][W];
+            for (int i = 0; i < W; i++) {
+                const auto counter = qe_counter(step, antithetic ? (first + i) >> 1 : first + i);
+                for (int j = 0; j < 4; j++) bits[j][i] = counter[j];
+            }
+            random::philox4x32<W>(bits, key);
+            for (int i = 0; i < W; i++) {
+                double uv = random::uniform01(bits[0][i], bits[1][i]);
+                double up = random::uniform01(bits[2][i], bits[3][i]);
+                // uniform01 is a multiple of 2^-53 plus 2^-54, 1 - u is exact
+                if (antithetic && ((first + i) & 1)) {
+                    uv = 1 - uv;
+                    up = 1 - up;
+                }
+                u_var[i] = open_unit<scalar_t>(uv);
+                u_price[i] = open_unit<scalar_t>(up);
+            }
+        }
+    };
+
+    /**
+     * Uniform variates of the fused kernel read from step-major (n_steps, n_paths) tables,
+     * e.g. quasi-random points. Values must lie in the open interval (0, 1) in the precision
+     * of the simulation. The price table is not read if null.
+     */
+    template<typename scalar_t>
+    struct TableUniforms {
+        const scalar_t* u_var;
+        const scalar_t* u_price;
+        int64_t n_paths;
+
+        template<int W>
+        void operator()(int64_t step, int64_t first, int n,
+                        simd::Pack<scalar_t, W>& u_var_, simd::Pack<scalar_t, W>& u_price_) const {
+            const int64_t offset = (step - 1) * n_paths + first;
+            u_var_ = simd::Pack<scalar_t, W>::load(u_var + offset, n);
+            if (u_price != nullptr) u_price_ = simd::Pack<scalar_t, W>::load(u_price + offset, n);
+        }
+    };
+
+    /**
+     * Fused QE path kernel: each block of SIMD lanes (paths) is advanced through all the
+     * steps in registers, blocks run in parallel.
+     *
+     * The states of a block of n <= W paths starting at `first` are handed over to the sink,
+     * which stores them or reduces them on the fly:
+     *     auto state = sink.start(first, n, price, var);       // initial states
+     *     sink.step(state, first, n, step, price, var);        // after each step
+     *     sink.finish(state, first, n, price, var);            // terminal states
+     * Prices are left undefined if `with_price` is false.
+     * The variates of each step are drawn from `uniforms` (see `PhiloxUniforms`).
+     */
+    template<typename scalar_t, bool with_price, typename Uniforms, typename Sink>
+    void advance_qe(int64_t n_paths, int64_t n_steps, const Uniforms& uniforms,
+                    const QECoefficients<double>& coefficients, double minimum_var,
+                    const scalar_t* init_price, const scalar_t* init_var, const Sink& sink) {
+        using Lanes = simd::Pack<scalar_t>;
+        constexpr int W = Lanes::width;
+        const auto c = broadcast<Lanes>(coefficients);
+        const int64_t n_blocks = (n_paths + W - 1) / W;
+
+        at::parallel_for(0, n_blocks, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t block = begin; block < end; block++) {
+                const int64_t first = block * W;
+                const int n = static_cast<int>(std::min<int64_t>(W, n_paths - first));
+
+                Lanes v = Lanes::load(init_var + first, n);
+                Lanes price{}, x{};
+                if constexpr (with_price) {
+                    price = Lanes::load(init_price + first, n);
+                    x = log(price);
+                }
+                auto state = sink.start(first, n, price, v);
+
+                for (int64_t step = 1; step <= n_steps; step++) {
+                    Lanes u_var, u_price;
+                    uniforms(step, first, n, u_var, u_price);
+                    const Lanes v_next = qe_variance_step(c, v, u_var, minimum_var);
+                    if constexpr (with_price) {
+                        x = qe_log_price_step(c, x, v, v_next, u_price);
+                        price = exp(x);
+                    }
+                    v = v_next;
+                    sink.step(state, first, n, step, price, v);
+                }
+                sink.finish(state, first, n, price, v);
+            }
+        });
+    }
+
+    /// Sink of `advance_qe` storing row-major (n_paths, n_steps + 1) paths
+    template<typename scalar_t, bool with_price>
+    struct PathSink {
+        int64_t n_cols;
+        scalar_t* price_paths;
+        scalar_t* var_paths;
+
+        template<typename Lanes>
+        int start(int64_t first, int n, const Lanes& price, const Lanes& var) const {
+            store(first, n, 0, price, var);
+            return 0;
+        }
+
+        template<typename Lanes>
+        void step(int, int64_t first, int n, int64_t step, const Lanes& price, const Lanes& var) const {
+            store(first, n, step, price, var);
+        }
+
+        template<typename Lanes>
+        void finish(int, int64_t, int, const Lanes&, const Lanes&) const {}
+
+    private:
+        template<typename Lanes>
+        void store(int64_t first, int n, int64_t col, const Lanes& price, const Lanes& var) const {
+            for (int i = 0; i < n; i++) {
+                var_paths[(first + i) * n_cols + col] = var[i];
+                if constexpr (with_price) price_paths[(first + i) * n_cols + col] = price[i];
+            }
+        }
+    };
+
+    /// Fused QE paths, row-major (n_paths, n_steps + 1)
+    template<typename scalar_t, bool with_price>
+    void simulate_qe(int64_t n_paths, int64_t n_steps, const PhiloxUniforms& uniforms,
+                     const QECoefficients<double>& coefficients, double minimum_var,
+                     const scalar_t* init_price, const scalar_t* init_var,
+                     scalar_t* price_paths, scalar_t* var_paths) {
+        advance_qe<scalar_t, with_price>(n_paths, n_steps, uniforms, coefficients, minimum_var,
+                                         init_price, init_var,
+                                         PathSink<scalar_t, with_price>{n_steps + 1, price_paths, var_paths});
+    }
+
+    /**
+     * Sink of `advance_qe` reducing the price paths with an accumulator (see `noa::quant::TerminalPrice`).
+     * Only the statistic and the terminal price of each path are stored.
+     */
+    template<typename scalar_t, typename Accumulator>
+    struct AccumulatorSink {
+        const Accumulator& accumulator;
+        int64_t n_steps;
+        scalar_t* statistic;
+        scalar_t* terminal_price;
+
+        template<typename Lanes>
+        Lanes start(int64_t, int, const Lanes& price, const Lanes&) const {
+            return accumulator.init(price);
+        }
+
+        template<typename Lanes>
+        void step(Lanes& state, int64_t, int, int64_t, const Lanes& price, const Lanes&) const {
+            state = accumulator.update(state, price);
+        }
+
+        template<typename Lanes>
+        void finish(const Lanes& state, int64_t first, int n, const Lanes& price, const Lanes&) const {
+            const Lanes result = accumulator.finish(state, n_steps);
+            for (int i = 0; i < n; i++) {
+                statistic[first + i] = result[i];
+                terminal_price[first + i] = price[i];
+            }
+        }
+    };
+
+    /// Directions of the tangents: S(0), v(0), kappa, theta, eps, rho, drift
+    constexpr int N_TANGENTS = 7;
+
+    /**
+     * Replays the paths of `simulate_qe` with their tangents, to contract them with the
+     * gradients of the outputs. Row i of `grads` (n_paths, N_TANGENTS) gets the
+     * contribution of path i.
+     */
+    template<typename scalar_t, bool with_price>
+    void simulate_qe_tangents(int64_t n_paths, int64_t n_steps, const PhiloxUniforms& uniforms,
+                              const QECoefficients<Tangent<N_TANGENTS>>& c, double minimum_var,
+                              const scalar_t* init_price, const scalar_t* init_var,
+                              const scalar_t* grad_price, const scalar_t* grad_var,
+                              double* grads) {
+        using T = Tangent<N_TANGENTS>;
+        const int64_t n_cols = n_steps + 1;
+
+        at::parallel_for(0, n_paths, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t path = begin; path < end; path++) {
+                double* acc = grads + path * N_TANGENTS;
+                const scalar_t* g_price = (grad_price != nullptr) ? grad_price + path * n_cols : nullptr;
+                const scalar_t* g_var = (grad_var != nullptr) ? grad_var + path * n_cols : nullptr;
+
+                const double s0 = with_price ? static_cast<double>(init_price[path]) : 1.;
+                T v = T::variable(init_var[path], 1);
+                T x = T::variable(std::log(s0), 0, 1 / s0);
+
+                const auto accumulate = [&](int64_t col) {
+                    const double gv = (g_var != nullptr) ? static_cast<double>(g_var[col]) : 0.;
+                    const double gs = (g_price != nullptr) ? static_cast<double>(g_price[col]) * std::exp(x.value) : 0.;
+                    for (int k = 0; k < N_TANGENTS; k++) acc[k] += gv * v.d[k] + gs * x.d[k];
+                };
+
+                accumulate(0);
+                for (int64_t step = 1; step <= n_steps; step++) {
+                    const auto u = uniforms(step, path);
+                    const T v_next = qe_variance_step(c, v, open_unit<scalar_t>(u[0]), minimum_var);
+                    if constexpr (with_price) {
+                        x = qe_log_price_step(c, x, v, v_next, open_unit<scalar_t>(u[1]));
+                    }
+                    v = v_next;
+                    accumulate(step);
+                }
+            }
+        });
+    }
+
+    /// Seed of the Philox streams, from the torch generator so that torch::manual_seed still applies
+    inline uint64_t draw_seed() {
+        return torch::randint(std::numeric_limits<int64_t>::max(), {1}, torch::kInt64).item<int64_t>();
+    }
+
+    /**
+     * Autograd function of the fused QE kernel: pathwise derivatives w.r.t. the initial
+     * states and the model parameters, computed in the backward pass by replaying the
+     * paths (same Philox streams) in forward mode. Memory stays that of the outputs.
+     *
+     * Returns {price paths, variance paths}, or {variance paths} if `with_price` is false.
+     */
+    class QEPaths : public torch::autograd::Function<QEPaths> {
+    public:
+        static torch::autograd::variable_list
+        forward(torch::autograd::AutogradContext* ctx,
+                int64_t n_steps, double dt, double minimum_var, bool with_price, bool antithetic,
+                const torch::Tensor& init_state_price,
+                const torch::Tensor& init_state_var,
+                const torch::Tensor& kappa,
+                const torch::Tensor& theta,
+                const torch::Tensor& eps,
+                const torch::Tensor& rho,
+                const torch::Tensor& drift) {
+            const int64_t n_paths = init_state_var.size(0);
+            const auto seed = static_cast<int64_t>(draw_seed());
+
+            ctx->saved_data["n_steps"] = n_steps;
+            ctx->saved_data["dt"] = dt;
+            ctx->saved_data["minimum_var"] = minimum_var;
+            ctx->saved_data["with_price"] = with_price;
+            ctx->saved_data["seed"] = seed;
+            ctx->saved_data["antithetic"] = antithetic;
+            ctx->save_for_backward({init_state_price, init_state_var, kappa, theta, eps, rho, drift});
+
+            const auto coefficients = qe_coefficients<double>(
+                    dt, kappa.item<double>(), theta.item<double>(), eps.item<double>(),
+                    rho.item<double>(), drift.item<double>());
+            const torch::Tensor var0 = init_state_var.contiguous();
+            const torch::Tensor price0 = init_state_price.to(var0.dtype()).contiguous();
+            torch::Tensor var_paths = torch::empty({n_paths, n_steps + 1}, var0.options());
+            torch::Tensor price_paths = with_price ? torch::empty_like(var_paths) : torch::Tensor();
+
+            const auto uniforms = PhiloxUniforms{static_cast<uint64_t>(seed), antithetic};
+            AT_DISPATCH_FLOATING_TYPES(var0.scalar_type(), "noa::quant::heston_impl::simulate_qe", [&] {
+                if (with_price)
+                    simulate_qe<scalar_t, true>(n_paths, n_steps, uniforms, coefficients, minimum_var,
+                                                price0.data_ptr<scalar_t>(), var0.data_ptr<scalar_t>(),
+                                                price_paths.data_ptr<scalar_t>(), var_paths.data_ptr<scalar_t>());
+                else
+                    simulate_qe<scalar_t, false>(n_paths, n_steps, uniforms, coefficients, minimum_var,
+                                                 nullptr, var0.data_ptr<scalar_t>(),
+                                                 nullptr, var_paths.data_ptr<scalar_t>());
+            });
+
+            if (with_price)
+                return {price_paths, var_paths};
+            return {var_paths};
+        }
+
+        static torch::autograd::variable_list
+        backward(torch::autograd::AutogradContext* ctx, torch::autograd::variable_list grad_outputs) {
+            using T = Tangent<N_TANGENTS>;
+            const auto saved = ctx->get_saved_variables();
+            const int64_t n_steps = ctx->saved_data["n_steps"].toInt();
+            const double dt = ctx->saved_data["dt"].toDouble();
+            const double minimum_var = ctx->saved_data["minimum_var"].toDouble();
+            const bool with_price = ctx->saved_data["with_price"].toBool();
+            const auto uniforms = PhiloxUniforms{static_cast<uint64_t>(ctx->saved_data["seed"].toInt()),
+                                                 ctx->saved_data["antithetic"].toBool()};
+
+            const torch::Tensor var0 = saved[1].contiguous();
+            const torch::Tensor price0 = saved[0].to(var0.dtype()).contiguous();
+            const int64_t n_paths = var0.size(0);
+            const auto coefficients = qe_coefficients<T>(
+                    dt,
+                    T::variable(saved[2].item<double>(), 2), T::variable(saved[3].item<double>(), 3),
+                    T::variable(saved[4].item<double>(), 4), T::variable(saved[5].item<double>(), 5),
+                    T::variable(saved[6].item<double>(), 6));
+
+            const auto gradient = [&](const torch::Tensor& grad) {
+                return grad.defined() ? grad.to(var0.dtype()).contiguous() : grad;
+            };
+            const torch::Tensor grad_price = with_price ? gradient(grad_outputs[0]) : torch::Tensor();
+            const torch::Tensor grad_var = gradient(grad_outputs[with_price ? 1 : 0]);
+            torch::Tensor grads = torch::zeros({n_paths, N_TANGENTS}, torch::kFloat64);
+
+            AT_DISPATCH_FLOATING_TYPES(var0.scalar_type(), "noa::quant::heston_impl::simulate_qe_tangents", [&] {
+                const scalar_t* g_price = grad_price.defined() ? grad_price.data_ptr<scalar_t>() : nullptr;
+                const scalar_t* g_var = grad_var.defined() ? grad_var.data_ptr<scalar_t>() : nullptr;
+                if (with_price)
+                    simulate_qe_tangents<scalar_t, true>(n_paths, n_steps, uniforms, coefficients, minimum_var,
+                                                         price0.data_ptr<scalar_t>(), var0.data_ptr<scalar_t>(),
+                                                         g_price, g_var, grads.data_ptr<double>());
+                else
+                    simulate_qe_tangents<scalar_t, false>(n_paths, n_steps, uniforms, coefficients, minimum_var,
+                                                          nullptr, var0.data_ptr<scalar_t>(),
+                                                          g_price, g_var, grads.data_ptr<double>());
+            });
+
+            const auto parameter_grad = [&](int k) {
+                return grads.index({Slice(), k}).sum().reshape(saved[k].sizes()).to(saved[k].dtype());
+            };
+            return {torch::Tensor(), torch::Tensor(), torch::Tensor(), torch::Tensor(), torch::Tensor(),
+                    with_price ? grads.index({Slice(), 0}).to(saved[0].dtype()) : torch::Tensor(),
+                    grads.index({Slice(), 1}).to(saved[1].dtype()),
+                    parameter_grad(2), parameter_grad(3), parameter_grad(4),
+                    with_price ? parameter_grad(5) : torch::Tensor(),
+                    with_price ? parameter_grad(6) : torch::Tensor()};
+        }
+    };
+
+    /// The fused kernel handles CPU tensors of floating type, with scalar parameters
+    inline bool is_fusable(const torch::Tensor& init_state, std::initializer_list<torch::Tensor> parameters) {
+        if (!init_state.device().is_cpu() ||
+            (init_state.scalar_type() != torch::kFloat64 && init_state.scalar_type() != torch::kFloat32))
+            return false;
+        for (const auto& parameter : parameters)
+            if (!parameter.device().is_cpu() || parameter.numel() != 1)
+                return false;
+        return true;
+    }
+
+    /**
+     * Weight of v(t + dt) in the integral of the variance for the log-price step, element-wise over
+     * the parameters: 0.5 (central discretisation) unless the regularity condition
+     * [Andersen2007, section 4.3.2] requires less. It is always satisfied when rho <= 0, and for
+     * rho > 0 it bounds gamma2 by R / L only when L > 0 and R > 0.
+     */
+    inline torch::Tensor gamma2_tensor(double dt, const torch::Tensor& kappa, const torch::Tensor& eps,
+                                       const torch::Tensor& rho) {
+        torch::Tensor L = rho*dt*(kappa/eps - 0.5*rho);
+        torch::Tensor R = 2*kappa/(eps*eps*(1 - torch::exp(-kappa*dt))) - rho/eps;
+        torch::Tensor one_half = torch::full_like(L, 0.5);
+        torch::Tensor bounded = (rho > 0) & (L > 0) & (R > 0);
+        // L is replaced where unused, so that the derivatives of R / L stay finite there
+        torch::Tensor bound = R / torch::where(bounded, L, torch::ones_like(L)) * 0.9; // multiply by 0.9 to have some margin
+        return torch::where(bounded, torch::minimum(one_half, bound), one_half);
+    }
+
+    torch::Tensor
+    generate_cir_tensor(int64_t n_paths, int64_t n_steps, double dt,
+                        const torch::Tensor& init_state,
+                        const torch::Tensor& kappa,
+                        const torch::Tensor& theta,
+                        const torch::Tensor& eps,
+                        double minimum_value = 0)
+    {
+        if (init_state.dim() < 1 || init_state.size(-1) != n_paths)
+            throw std::invalid_argument("Shape of `init_state` must be (..., n_paths)");
+
+        // parameters broadcast against the leading dimensions of init_state
+        auto sizes = init_state.sizes().vec();
+        sizes.push_back(n_steps + 1);
+        torch::Tensor paths = torch::empty(sizes, init_state.options());
+        paths.index_put_({Ellipsis, 0}, init_state);
+
+        torch::Tensor delta = 4 * kappa * theta / (eps * eps) * torch::ones_like(init_state);
+        torch::Tensor exp = torch::exp(-kappa*dt);
+        torch::Tensor c_bar = 1 / (4*kappa) * eps * eps * (1 - exp);
+        for (int64_t i = 0; i < n_steps; i++) {
+            torch::Tensor v_cur = paths.index({Ellipsis, i});
+            torch::Tensor kappa_bar = v_cur * 4*kappa*exp / (eps * eps * (1 - exp));
+            // [Grzelak2019, definition 8.1.1]
+            torch::Tensor v_next = c_bar * noncentral_chisquare(delta, kappa_bar);
+            if (minimum_value != 0)
+                v_next = torch::clamp(v_next, minimum_value);
+            paths.index_put_({Ellipsis, i+1}, v_next);
+        }
+        return paths;
+    }
+
+
+    std::tuple<torch::Tensor, torch::Tensor>
+    generate_heston_tensor(int64_t n_paths, int64_t n_steps, double dt,
+                           const torch::Tensor& init_state_price,
+                           const torch::Tensor& init_state_var,
+                           const torch::Tensor& kappa,
+                           const torch::Tensor& theta,
+                           const torch::Tensor& eps,
+                           const torch::Tensor& rho,
+                           const torch::Tensor& drift,
+                           double minimum_var = 0,
+                           bool antithetic = false)
+    {
+        if (init_state_price.sizes() != init_state_var.sizes())
+            throw std::invalid_argument("Shapes of `init_state_price` and `init_state_var` must match");
+
+        torch::Tensor gamma2 = gamma2_tensor(dt, kappa, eps, rho);
+        torch::Tensor gamma1 = 1.0 - gamma2;
+
+        torch::Tensor k0 = -rho * kappa * theta * dt / eps;
+        torch::Tensor k1 = gamma1 * dt * (kappa * rho / eps - 0.5) - rho / eps;
+        torch::Tensor k2 = gamma2 * dt * (kappa * rho / eps - 0.5) + rho / eps;
+        torch::Tensor k3 = gamma1 * dt * (1 - rho * rho);
+        torch::Tensor k4 = gamma2 * dt * (1 - rho * rho);
+
+        torch::Tensor var_paths;
+        if (antithetic) {
+            // the pairs share the variance path of the first path, the normals of the price are opposite
+            const torch::Tensor first_var = init_state_var.index({Ellipsis, Slice(None, None, 2)});
+            var_paths = generate_cir_tensor(n_paths / 2, n_steps, dt, first_var, kappa, theta, eps, minimum_var)
+                    .repeat_interleave(2, -2);
+        } else {
+            var_paths = generate_cir_tensor(n_paths, n_steps, dt, init_state_var, kappa, theta, eps, minimum_var);
+        }
+        const auto normals = [&](const torch::Tensor& v) {
+            if (!antithetic)
+                return torch::randn_like(v);
+            const torch::Tensor z = torch::randn_like(v.index({Ellipsis, Slice(None, None, 2)}));
+            return torch::stack({z, -z}, -1).flatten(-2);
+        };
+        torch::Tensor log_paths = torch::empty(var_paths.sizes(), init_state_price.options());
+        log_paths.index_put_({Ellipsis, 0}, init_state_price.log());
+
+        for (int64_t i = 0; i < n_steps; i++) {
+            torch::Tensor v_i = var_paths.index({Ellipsis, i});
+            torch::Tensor v_next = var_paths.index({Ellipsis, i + 1});
+            torch::Tensor next_vals = drift*dt +
+                    log_paths.index({Ellipsis, i}) + k0 + k1*v_i + k2*v_next +
+                    torch::sqrt(k3*v_i + k4*v_next) * normals(v_i);
+            log_paths.index_put_({Ellipsis, i+1}, next_vals);
+        }
+        return std::make_tuple(log_paths.exp(), var_paths);
+    }
+    }  // namespace heston_impl
+
+
 /**
  * Generates paths of Cox-Ingersoll-Ross (CIR) process.
  *
@@ -98,6 +811,10 @@ noncentral_chisquare(const torch::Tensor& df, const torch::Tensor& nonc) {
             range [minimum_value, +∞). This may be needed in certain cases, e.g.
             for automatic differentiation.
  * @return Simulated paths of CIR process. Shape: (n_paths, n_steps + 1).
+ *
+ * On CPU, with scalar parameters, paths are generated by a fused kernel
+ * (`heston_impl::QEPaths`) differentiable w.r.t. `init_state`, `kappa`,
+ * `theta` and `eps`. Otherwise, steps are made with tensor operations.
  */
 torch::Tensor
 generate_cir(int64_t n_paths, int64_t n_steps, double dt,
@@ -109,23 +826,12 @@ generate_cir(int64_t n_paths, int64_t n_steps, double dt,
 {
     if (init_state.sizes() != torch::IntArrayRef{n_paths})
         throw std::invalid_argument("Shape of `init_state` must be (n_paths,)");
+    if (!heston_impl::is_fusable(init_state, {kappa, theta, eps}))
+        return heston_impl::generate_cir_tensor(n_paths, n_steps, dt, init_state, kappa, theta, eps, minimum_value);
 
-    torch::Tensor paths = torch::empty({n_paths, n_steps + 1},init_state.dtype());
-    paths.index_put_({Slice(), 0}, init_state);
-
-    torch::Tensor delta = 4 * kappa * theta / (eps * eps) * torch::ones_like(init_state);
-    torch::Tensor exp = torch::exp(-kappa*dt);
-    torch::Tensor c_bar = 1 / (4*kappa) * eps * eps * (1 - exp);
-    for (int64_t i = 0; i < n_steps; i++) {
-        torch::Tensor v_cur = paths.index({Slice(), i});
-        torch::Tensor kappa_bar = v_cur * 4*kappa*exp / (eps * eps * (1 - exp));
-        // [Grzelak2019, definition 8.1.1]
-        torch::Tensor v_next = c_bar * noncentral_chisquare(delta, kappa_bar);
-        if (minimum_value != 0)
-            v_next = torch::clamp(v_next, minimum_value);
-        paths.index_put_({Slice(), i+1}, v_next);
-    }
-    return paths;
+    torch::Tensor zero = torch::zeros({}, torch::kFloat64);
+    return heston_impl::QEPaths::apply(n_steps, dt, minimum_value, false, false,
+                                       init_state, init_state, kappa, theta, eps, zero, zero)[0];
 }
 
 /**
@@ -151,8 +857,18 @@ generate_cir(int64_t n_paths, int64_t n_steps, double dt,
             the range [minimum_var, +∞) to prevent it from being too close to
             zero. This is necessary when using autograd to compute the
             derivative of generated values w.r.t. v(0).
+ * @param antithetic Generate antithetic pairs: paths 2i and 2i + 1 are driven by
+            reflected random numbers. n_paths must be even, and the paths of a pair
+            should start from the same state. Average the payoffs of the pairs
+            (see `noa::quant::ControlVariate`) to get independent samples.
  * @return Two tensors: simulated paths for price, simulated paths for variance.
  *     Both tensors have shape (n_paths, n_steps + 1).
+ *
+ * On CPU, with scalar parameters, paths are generated by a fused kernel
+ * (`heston_impl::QEPaths`) differentiable w.r.t. the initial states and
+ * all the parameters. Otherwise, steps are made with tensor operations;
+ * antithetic pairs then share the variance path and have opposite price normals,
+ * as the non-central chi-square sampler cannot be reflected.
  */
 std::tuple<torch::Tensor, torch::Tensor>
 generate_heston(int64_t n_paths, int64_t n_steps, double dt,
@@ -163,49 +879,271 @@ generate_heston(int64_t n_paths, int64_t n_steps, double dt,
                 const torch::Tensor& eps,
                 const torch::Tensor& rho,
                 const torch::Tensor& drift,
-                double minimum_var = 0)
+                double minimum_var = 0,
+                bool antithetic = false)
 {
     if (init_state_price.sizes() != torch::IntArrayRef{n_paths})
         throw std::invalid_argument("Shape of `init_state_price` must be (n_paths,)");
     if (init_state_var.sizes() != torch::IntArrayRef{n_paths})
         throw std::invalid_argument("Shape of `init_state_var` must be (n_paths,)");
+    if (antithetic && n_paths % 2 != 0)
+        throw std::invalid_argument("Antithetic pairs require an even `n_paths`");
+    if (!heston_impl::is_fusable(init_state_var, {kappa, theta, eps, rho, drift}) ||
+        !init_state_price.device().is_cpu())
+        return heston_impl::generate_heston_tensor(n_paths, n_steps, dt, init_state_price, init_state_var,
+                                                   kappa, theta, eps, rho, drift, minimum_var, antithetic);
 
-    torch::Tensor gamma2 = torch::tensor(0.5, torch::kFloat64);
-    // regularity condition [Andersen 2007, section 4.3.2]
-    if (rho.item<double>() > 0) { // always satisfied when rho <= 0
-        torch::Tensor L = rho*dt*(kappa/eps - 0.5*rho);
-        torch::Tensor R = 2*kappa/(eps*eps*(1 - torch::exp(-kappa*dt))) - rho/eps;
-        if (R.item<double>() <= 0 || L.item<double>() == 0 || (L.item<double>() < 0 && R.item<double>() >= 0)) {
-            // When (L<0 && R<=0), L/R is always < 0.5.
-            // (L>0 && R<=0) never happens.
-            // In other cases, regularity condition is always satisfied.
-        }
-        else if (L.item<double>() > 0) {
-            torch::Tensor one_half = torch::tensor(0.5, torch::kFloat64);
-            gamma2 = torch::minimum(one_half, R / L * 0.9); // multiply by 0.9 to have some margin
+    auto paths = heston_impl::QEPaths::apply(n_steps, dt, minimum_var, true, antithetic,
+                                             init_state_price, init_state_var, kappa, theta, eps, rho, drift);
+    return std::make_tuple(paths[0], paths[1]);
+}
+
+/**
+ * Generates Heston time series as `generate_heston`, for n_sets parameter sets at once,
+ * e.g. the population of an optimiser or a finite difference stencil during calibration.
+ *
+ * @param init_state_price Initial prices S(0). Shape: (n_sets, n_paths), or broadcastable to it.
+ * @param init_state_var Initial variances v(0). Shape: (n_sets, n_paths), or broadcastable to it.
+ * @param kappa, theta, eps, rho, drift Parameters of the sets. Shape: (n_sets,), or scalars shared by all the sets.
+ * @return Two tensors: simulated paths for price, simulated paths for variance.
+ *     Both tensors have shape (n_sets, n_paths, n_steps + 1).
+ *
+ * The regularity condition on the discretisation of the price [Andersen2007, section 4.3.2] is
+ * applied element-wise, without synchronisation with the host. On CPU, when no derivative is
+ * required, paths are generated by the fused kernel of `generate_heston`, all the sets sharing the
+ * same random numbers (common random numbers reduce the noise of differences between sets).
+ * Otherwise, steps are made with tensor operations, differentiable w.r.t. all the inputs.
+ */
+std::tuple<torch::Tensor, torch::Tensor>
+generate_heston_sets(int64_t n_paths, int64_t n_steps, double dt,
+                     const torch::Tensor& init_state_price,
+                     const torch::Tensor& init_state_var,
+                     const torch::Tensor& kappa,
+                     const torch::Tensor& theta,
+                     const torch::Tensor& eps,
+                     const torch::Tensor& rho,
+                     const torch::Tensor& drift,
+                     double minimum_var = 0)
+{
+    const std::vector<torch::Tensor> parameters = {kappa, theta, eps, rho, drift};
+    if (init_state_price.dim() > 2 || init_state_var.dim() > 2)
+        throw std::invalid_argument("Initial states must be of shape (n_sets, n_paths)");
+    // Sets are broadcast over the parameters and the rows of the initial states,
+    // e.g. a stencil in v(0) with scalar parameters
+    std::vector<int64_t> set_counts;
+    for (const auto& parameter : parameters)
+        set_counts.push_back(parameter.numel());
+    for (const auto& state : {init_state_price, init_state_var})
+        if (state.dim() == 2) set_counts.push_back(state.size(0));
+    int64_t n_sets = 1;
+    for (const auto count : set_counts)
+        if (count != 1) n_sets = count;
+    for (const auto& parameter : parameters)
+        if (parameter.dim() > 1 || (parameter.numel() != 1 && parameter.numel() != n_sets))
+            throw std::invalid_argument("Parameters must be scalars or of shape (n_sets,)");
+    for (const auto count : set_counts)
+        if (count != 1 && count != n_sets)
+            throw std::invalid_argument("Initial states must be of shape (n_sets, n_paths), or broadcastable to it");
+
+    // Parameters as columns, broadcast against the (n_sets, n_paths) states
+    std::vector<torch::Tensor> columns;
+    for (const auto& parameter : parameters)
+        columns.push_back(parameter.reshape({-1, 1}).expand({n_sets, 1}));
+    const torch::Tensor price0 = init_state_price.expand({n_sets, n_paths});
+    const torch::Tensor var0 = init_state_var.expand({n_sets, n_paths});
+
+    bool fusable = var0.device().is_cpu() && price0.device().is_cpu() &&
+                   (var0.scalar_type() == torch::kFloat64 || var0.scalar_type() == torch::kFloat32);
+    bool requires_grad = price0.requires_grad() || var0.requires_grad();
+    for (const auto& parameter : parameters) {
+        fusable = fusable && parameter.device().is_cpu();
+        requires_grad = requires_grad || parameter.requires_grad();
+    }
+    if (!fusable || (requires_grad && torch::GradMode::is_enabled()))
+        return heston_impl::generate_heston_tensor(n_paths, n_steps, dt, price0, var0,
+                                                   columns[0], columns[1], columns[2], columns[3], columns[4],
+                                                   minimum_var);
+
+    const torch::Tensor values = torch::cat(columns, 1).to(torch::kFloat64).contiguous(); // (n_sets, 5)
+    const double* set_values = values.data_ptr<double>();
+    const torch::Tensor var0_data = var0.detach().contiguous();
+    const torch::Tensor price0_data = price0.detach().to(var0.dtype()).contiguous();
+    torch::Tensor var_paths = torch::empty({n_sets, n_paths, n_steps + 1}, var0_data.options());
+    torch::Tensor price_paths = torch::empty_like(var_paths);
+    const int64_t n_cols = n_steps + 1;
+    const auto seed = heston_impl::draw_seed();
+
+    AT_DISPATCH_FLOATING_TYPES(var0_data.scalar_type(), "noa::quant::generate_heston_sets", [&] {
+        for (int64_t set = 0; set < n_sets; set++) {
+            const double* p = set_values + 5 * set;
+            const auto coefficients = heston_impl::qe_coefficients<double>(dt, p[0], p[1], p[2], p[3], p[4]);
+            const int64_t offset = set * n_paths;
+            heston_impl::advance_qe<scalar_t, true>(
+                    n_paths, n_steps, heston_impl::PhiloxUniforms{seed}, coefficients, minimum_var,
+                    price0_data.data_ptr<scalar_t>() + offset, var0_data.data_ptr<scalar_t>() + offset,
+                    heston_impl::PathSink<scalar_t, true>{n_cols,
+                                                          price_paths.data_ptr<scalar_t>() + offset * n_cols,
+                                                          var_paths.data_ptr<scalar_t>() + offset * n_cols});
         }
+    });
+    return std::make_tuple(price_paths, var_paths);
+}
+
+/**
+ * Accumulators of the price along a path, for `stream_heston`.
+ *
+ * An accumulator maps the price S(t_k) of each step to a running state:
+ *     state = init(S(0)); state = update(state, S(t_k)), k = 1..n_steps; finish(state, n_steps),
+ * where the states are SIMD packs of paths. `reduce` gives the same statistic from
+ * stored (n_paths, n_steps + 1) price paths.
+ */
+struct TerminalPrice {
+    template<typename V>
+    V init(const V& price) const { return price; }
+    template<typename V>
+    V update(const V&, const V& price) const { return price; }
+    template<typename V>
+    V finish(const V& state, int64_t) const { return state; }
+
+    torch::Tensor reduce(const torch::Tensor& price_paths) const {
+        return price_paths.index({Slice(), -1});
+    }
+};
+
+/// Arithmetic average of S(t_1), ..., S(t_n), as for Asian options
+struct AveragePrice {
+    template<typename V>
+    V init(const V&) const { return V(0); }
+    template<typename V>
+    V update(const V& state, const V& price) const { return state + price; }
+    template<typename V>
+    V finish(const V& state, int64_t n_steps) const { return state / static_cast<double>(n_steps); }
+
+    torch::Tensor reduce(const torch::Tensor& price_paths) const {
+        return price_paths.index({Slice(), Slice(1, None)}).mean(1);
+    }
+};
+
+/// Maximum of S(t_0), ..., S(t_n), as for lookback options
+struct MaximumPrice {
+    template<typename V>
+    V init(const V& price) const { return price; }
+    template<typename V>
+    V update(const V& state, const V& price) const {
+        using std::max;
+        return max(state, price);
     }
-    torch::Tensor gamma1 = 1.0 - gamma2;
+    template<typename V>
+    V finish(const V& state, int64_t) const { return state; }
 
-    torch::Tensor k0 = -rho * kappa * theta * dt / eps;
-    torch::Tensor k1 = gamma1 * dt * (kappa * rho / eps - 0.5) - rho / eps;
-    torch::Tensor k2 = gamma2 * dt * (kappa * rho / eps - 0.5) + rho / eps;
-    torch::Tensor k3 = gamma1 * dt * (1 - rho * rho);
-    torch::Tensor k4 = gamma2 * dt * (1 - rho * rho);
+    torch::Tensor reduce(const torch::Tensor& price_paths) const {
+        return std::get<0>(price_paths.max(1));
+    }
+};
+
+/// Minimum of S(t_0), ..., S(t_n), as for lookback options
+struct MinimumPrice {
+    template<typename V>
+    V init(const V& price) const { return price; }
+    template<typename V>
+    V update(const V& state, const V& price) const {
+        using std::min;
+        return min(state, price);
+    }
+    template<typename V>
+    V finish(const V& state, int64_t) const { return state; }
+
+    torch::Tensor reduce(const torch::Tensor& price_paths) const {
+        return std::get<0>(price_paths.min(1));
+    }
+};
+
+/// 1 if the price reached the level at any of t_0, ..., t_n (from below if `up`, from above otherwise), 0 if not
+struct BarrierHit {
+    double level;
+    bool up = true;
 
-    torch::Tensor var_paths = generate_cir(n_paths, n_steps, dt, init_state_var, kappa, theta, eps, minimum_var);
-    torch::Tensor log_paths = torch::empty({n_paths, n_steps + 1}, init_state_price.dtype());
-    log_paths.index_put_({Slice(), 0}, init_state_price.log());
+    template<typename V>
+    V init(const V& price) const { return update(V(0), price); }
+    template<typename V>
+    V update(const V& state, const V& price) const {
+        using noa::utils::simd::select;
+        return select(up ? price >= level : price <= level, V(1), state);
+    }
+    template<typename V>
+    V finish(const V& state, int64_t) const { return state; }
 
-    for (int64_t i = 0; i < n_steps; i++) {
-        torch::Tensor v_i = var_paths.index({Slice(), i});
-        torch::Tensor v_next = var_paths.index({Slice(), i + 1});
-        torch::Tensor next_vals = drift*dt +
-                log_paths.index({Slice(), i}) + k0 + k1*v_i + k2*v_next +
-                torch::sqrt(k3*v_i + k4*v_next) * torch::randn_like(v_i);
-        log_paths.index_put_({Slice(), i+1}, next_vals);
+    torch::Tensor reduce(const torch::Tensor& price_paths) const {
+        const auto crossed = up ? price_paths.ge(level) : price_paths.le(level);
+        return crossed.any(1).to(price_paths.dtype());
     }
-    return std::make_tuple(log_paths.exp(), var_paths);
+};
+
+/**
+ * Simulates the Heston model as `generate_heston`, but keeps only a statistic of each
+ * price path (see `TerminalPrice`, `AveragePrice`, `MaximumPrice`, `MinimumPrice` and
+ * `BarrierHit`) and its terminal price. Memory is O(n_paths) instead of O(n_paths · n_steps).
+ *
+ * On CPU, with scalar parameters, paths are reduced on the fly by the fused kernel
+ * of `generate_heston` (same paths for the same seed), without derivatives.
+ * Otherwise, paths are generated with tensor operations by chunks of `chunk_size` paths.
+ *
+ * @param accumulator Accumulator of the price along the paths.
+ * @param chunk_size Number of paths generated at once, if not fused.
+ * @return Two tensors of shape (n_paths,): the statistic of the price paths, the terminal prices.
+ */
+template<typename Accumulator>
+std::tuple<torch::Tensor, torch::Tensor>
+stream_heston(int64_t n_paths, int64_t n_steps, double dt,
+              const torch::Tensor& init_state_price,
+              const torch::Tensor& init_state_var,
+              const torch::Tensor& kappa,
+              const torch::Tensor& theta,
+              const torch::Tensor& eps,
+              const torch::Tensor& rho,
+              const torch::Tensor& drift,
+              const Accumulator& accumulator,
+              double minimum_var = 0,
+              int64_t chunk_size = 4096)
+{
+    if (init_state_price.sizes() != torch::IntArrayRef{n_paths})
+        throw std::invalid_argument("Shape of `init_state_price` must be (n_paths,)");
+    if (init_state_var.sizes() != torch::IntArrayRef{n_paths})
+        throw std::invalid_argument("Shape of `init_state_var` must be (n_paths,)");
+    if (chunk_size < 1)
+        throw std::invalid_argument("`chunk_size` must be positive");
+
+    if (!heston_impl::is_fusable(init_state_var, {kappa, theta, eps, rho, drift}) ||
+        !init_state_price.device().is_cpu()) {
+        std::vector<torch::Tensor> statistics, terminal_prices;
+        for (int64_t first = 0; first < n_paths; first += chunk_size) {
+            const int64_t n = std::min(chunk_size, n_paths - first);
+            const auto chunk = Slice(first, first + n);
+            const auto paths = heston_impl::generate_heston_tensor(
+                    n, n_steps, dt, init_state_price.index({chunk}), init_state_var.index({chunk}),
+                    kappa, theta, eps, rho, drift, minimum_var);
+            statistics.push_back(accumulator.reduce(std::get<0>(paths)));
+            terminal_prices.push_back(std::get<0>(paths).index({Slice(), -1}));
+        }
+        return std::make_tuple(torch::cat(statistics), torch::cat(terminal_prices));
+    }
+
+    const auto coefficients = heston_impl::qe_coefficients<double>(
+            dt, kappa.item<double>(), theta.item<double>(), eps.item<double>(),
+            rho.item<double>(), drift.item<double>());
+    const torch::Tensor var0 = init_state_var.detach().contiguous();
+    const torch::Tensor price0 = init_state_price.detach().to(var0.dtype()).contiguous();
+    torch::Tensor statistic = torch::empty({n_paths}, var0.options());
+    torch::Tensor terminal_price = torch::empty_like(statistic);
+
+    AT_DISPATCH_FLOATING_TYPES(var0.scalar_type(), "noa::quant::stream_heston", [&] {
+        heston_impl::advance_qe<scalar_t, true>(
+                n_paths, n_steps, heston_impl::PhiloxUniforms{heston_impl::draw_seed()}, coefficients, minimum_var,
+                price0.data_ptr<scalar_t>(), var0.data_ptr<scalar_t>(),
+                heston_impl::AccumulatorSink<scalar_t, Accumulator>{
+                        accumulator, n_steps, statistic.data_ptr<scalar_t>(), terminal_price.data_ptr<scalar_t>()});
+    });
+    return std::make_tuple(statistic, terminal_price);
 }
 
 } // namespace noa::quant
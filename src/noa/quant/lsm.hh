@@ -31,11 +31,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <cmath>
 #include <stdexcept>
 #include <torch/torch.h>
 #include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "noa/utils/simd.hh"
 
 namespace noa::quant {
 
@@ -94,72 +99,328 @@ struct LSMResult {
     torch::Tensor option_price;
     torch::Tensor reg_poly_coefs;
     torch::Tensor initial_cont_value;
+    torch::Tensor payoffs;  // discounted cashflows of the pricing paths, set by the pricing step
 
     //std::optional<std::list<torch::Tensor> reg_x_vals; return_extra flag for cpp ignored  
     //std::optional<std::list<torch::Tensor> reg_x_vals;    
 };
 
-LSMResult
-_lsm_regression_step(
-    const torch::Tensor& paths,
-    double& dt,
-    const torch::Tensor& strike,
-    const torch::Tensor& rate,
-    int64_t reg_poly_degree,
-    bool return_extra
-)
-{
-    int64_t n_paths = paths.sizes()[0];
-    int64_t n_steps = paths.sizes()[1] - 1;
+    namespace lsm_impl {
+
+    namespace simd = noa::utils::simd;
 
-    torch::Tensor cashflow = torch::where(paths.index({Slice(), -1}) < strike,
-                                          strike - paths.index({Slice(), -1}),
-                                          0);
-    torch::Tensor tau = n_steps * torch::ones(n_paths, torch::kInt64);
+    /// Largest degree of the regression polynomial
+    constexpr int64_t MAX_DEGREE = 8;
 
-    torch::Tensor reg_poly_coefs = torch::zeros({paths.sizes()[1], reg_poly_degree + 1});
-    // no nan in libtorch...
-    // reg_poly_coefs.index({-1}) *= torch::nan;  // continuation value is not defined at expiration
-    // reg_poly_coefs.index({0}) *= torch::nan;
+    /// Paths per block of the parallel accumulation of the normal equations
+    constexpr int64_t BLOCK_SIZE = 4096;
 
-    if (return_extra) {
+    /// Number of sums accumulated per block: Σ x^k, k <= 2 degree, then Σ x^k y, k <= degree
+    inline int64_t n_sums(int64_t degree) {
+        return 3 * degree + 2;
     }
 
-    for (int64_t j = n_steps - 1; j > 0; j--) {
-        torch::Tensor itm_mask = paths.index({Slice(), j}) < strike;
-        if (torch::sum(itm_mask).item<int64_t>() == 0) {
-            continue;
+    /**
+     * Least squares polynomial from the normal equations G a = b, G being the Hankel matrix of
+     * the power sums, G[k][l] = moments[k + l] = Σ x^(k+l), and b[k] = Σ x^k y.
+     *
+     * Solved by Cholesky. When G is numerically singular (fewer distinct points than coefficients),
+     * the polynomial is truncated to the largest regular leading block, the higher coefficients being 0.
+     */
+    inline void solve_normal_equations(const double* moments, const double* rhs, int64_t n_basis, double* coefs) {
+        double L[MAX_DEGREE + 1][MAX_DEGREE + 1];
+        int64_t rank = 0;
+        for (; rank < n_basis; rank++) {
+            const int64_t k = rank;
+            for (int64_t l = 0; l < k; l++) {
+                double sum = moments[k + l];
+                for (int64_t m = 0; m < l; m++) sum -= L[k][m] * L[l][m];
+                L[k][l] = sum / L[l][l];
+            }
+            double pivot = moments[2 * k];
+            for (int64_t m = 0; m < k; m++) pivot -= L[k][m] * L[k][m];
+            if (!(pivot > 1e-10 * moments[2 * k])) break;
+            L[k][k] = std::sqrt(pivot);
         }
-        torch::Tensor paths_itm = paths.index({Slice(), j}).index({itm_mask});
 
-        torch::Tensor A = torch::vander(paths_itm, reg_poly_degree + 1);
-        torch::Tensor y = torch::exp(-rate * (tau.index({itm_mask}) - j) * dt) * cashflow.index({itm_mask});
-        torch::Tensor fit_params;
-        std::tie(fit_params, std::ignore, std::ignore, std::ignore) =
-                torch::linalg::lstsq(A, y, torch::nullopt, torch::nullopt);
-        torch::Tensor C_hat = torch::matmul(A, fit_params);
-        reg_poly_coefs.index({j}) = fit_params;
+        double z[MAX_DEGREE + 1];
+        for (int64_t k = 0; k < rank; k++) {
+            double sum = rhs[k];
+            for (int64_t m = 0; m < k; m++) sum -= L[k][m] * z[m];
+            z[k] = sum / L[k][k];
+        }
+        for (int64_t k = n_basis - 1; k >= 0; k--) {
+            if (k >= rank) {
+                coefs[k] = 0;
+                continue;
+            }
+            double sum = z[k];
+            for (int64_t m = k + 1; m < rank; m++) sum -= L[m][k] * coefs[m];
+            coefs[k] = sum / L[k][k];
+        }
+    }
 
-        if (return_extra) {
+    /// Polynomial with coefficients from the lowest power, at x a scalar or a SIMD pack
+    template<typename V>
+    inline V horner(const double* coefs, int64_t degree, const V& x) {
+        V result = coefs[degree];
+        for (int64_t k = degree - 1; k >= 0; k--) result = result * x + coefs[k];
+        return result;
+    }
+
+    /// Calls f(std::integral_constant<int, degree>), so that the loops over the powers unroll
+    template<int D = 0, typename F>
+    inline void with_degree(int64_t degree, const F& f) {
+        if constexpr (D <= MAX_DEGREE) {
+            if (degree == D)
+                f(std::integral_constant<int, D>{});
+            else
+                with_degree<D + 1>(degree, f);
         }
+    }
 
-        torch::Tensor payoff_itm_now = strike - paths_itm;
-        torch::Tensor stop_now_mask = (payoff_itm_now >= C_hat);
-        cashflow.index_put_({itm_mask}, torch::where(stop_now_mask, payoff_itm_now, cashflow.index({itm_mask})));
-        tau.index_put_({itm_mask}, torch::where(stop_now_mask, j, tau.index({itm_mask})));
+    /**
+     * One step of `regression_kernel` for the paths [first, last) of an option, W at a time:
+     * applies the exercise decision of the next step (continuation coefficients `c_next`) to the
+     * values v, then adds the normal equations of the step to acc. last - first is a multiple of W.
+     */
+    template<int D, int W>
+    inline void regression_lanes(const double* s, const double* s_next, const double* c_next,
+                                 double discount_next, double strike, int64_t first, int64_t last,
+                                 double* v, double* acc) {
+        using Lanes = simd::Pack<double, W>;
+        Lanes power_sums[2 * D + 1], value_sums[D + 1];
+        for (auto& sum : power_sums) sum = Lanes(0.);
+        for (auto& sum : value_sums) sum = Lanes(0.);
+
+        for (int64_t i = first; i < last; i += W) {
+            Lanes value = Lanes::load(v + i);
+            if (s_next != nullptr) {
+                const Lanes price = Lanes::load(s_next + i);
+                const Lanes payoff = (strike - price) * discount_next;
+                const Lanes continuation = horner(c_next, D, price / strike);
+                value = select((price < strike) & (payoff >= continuation), payoff, value);
+                value.store(v + i);
+            }
+            const Lanes price = Lanes::load(s + i);
+            const Lanes x = price / strike;
+            // out of the money paths have zero weight
+            Lanes power = select(price < strike, Lanes(1.), Lanes(0.));
+#pragma GCC unroll 17
+            for (int k = 0; k <= 2 * D; k++) {
+                power_sums[k] += power;
+                if (k <= D) value_sums[k] += power * value;
+                power *= x;
+            }
+        }
+        for (int k = 0; k <= 2 * D; k++)
+            for (int l = 0; l < W; l++) acc[k] += power_sums[k][l];
+        for (int k = 0; k <= D; k++)
+            for (int l = 0; l < W; l++) acc[2 * D + 1 + k] += value_sums[k][l];
     }
 
-    torch::Tensor C_hat = torch::mean(torch::exp(-rate * tau * dt) * cashflow);
-    torch::Tensor payoff_now = torch::maximum(strike - paths.index({0, 0}), torch::tensor(0.0));
-    torch::Tensor option_price = torch::maximum(payoff_now, C_hat);
+    /// `regression_lanes` over any range of paths: packs of 4, then the remainder one by one.
+    /// Wider packs are slower, their 3 D + 2 accumulators no longer fit in the registers.
+    template<int D>
+    inline void regression_block(const double* s, const double* s_next, const double* c_next,
+                                 double discount_next, double strike, int64_t first, int64_t last,
+                                 double* v, double* acc) {
+        constexpr int W = 4;
+        const int64_t middle = first + (last - first) / W * W;
+        regression_lanes<D, W>(s, s_next, c_next, discount_next, strike, first, middle, v, acc);
+        regression_lanes<D, 1>(s, s_next, c_next, discount_next, strike, middle, last, v, acc);
+    }
 
-    LSMResult result{option_price, reg_poly_coefs, C_hat};
-    if (return_extra) {
+    /**
+     * Backward induction of LSM for a ladder of puts with strikes K_o and maturity steps m_o,
+     * on column-major paths S[j * n_paths + i], all the options sharing the path columns.
+     *
+     * Cashflows are kept discounted to t = 0, so that the regression at step j needs no
+     * per path discounting, and the continuation value is regressed on the powers of the
+     * moneyness x = S / K_o, bounded by 1 in the money, which keeps the normal equations well
+     * conditioned. Each step is a single pass over the column: for each block of paths and
+     * each option, the exercise decision of step j + 1 is applied and the normal equations of
+     * step j are accumulated. Blocks and options are processed in parallel, the options of a
+     * block reusing its column from cache.
+     *
+     * @param value On output, the cashflows of the paths discounted to t = 0. Size: n_options * n_paths.
+     * @param coefs On output, the coefficients of the continuation value of step j, discounted to
+     *     t = 0, in powers of x from the lowest. Size: n_options * (n_steps + 1) * (degree + 1),
+     *     zero-initialised.
+     * @param partial Scratch. Size: ceil(n_paths / BLOCK_SIZE) * n_options * n_sums(degree).
+     */
+    inline void regression_kernel(const double* S, int64_t n_paths, int64_t n_steps, double dt,
+                                  const double* strikes, const int64_t* maturities, int64_t n_options,
+                                  double rate, int64_t degree,
+                                  double* value, double* coefs, double* partial) {
+        const int64_t n_basis = degree + 1;
+        const int64_t n_blocks = (n_paths + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const int64_t stride = n_sums(degree);
+        const auto discount = [&](int64_t j) { return std::exp(-rate * static_cast<double>(j) * dt); };
+        const int64_t last_maturity = *std::max_element(maturities, maturities + n_options);
+
+        at::parallel_for(0, n_blocks * n_options, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t task = begin; task < end; task++) {
+                const int64_t block = task / n_options, option = task % n_options;
+                const double strike = strikes[option];
+                const double* terminal = S + maturities[option] * n_paths;
+                const double discount_T = discount(maturities[option]);
+                double* v = value + option * n_paths;
+                const int64_t last = std::min(n_paths, (block + 1) * BLOCK_SIZE);
+                for (int64_t i = block * BLOCK_SIZE; i < last; i++)
+                    v[i] = std::max(strike - terminal[i], 0.) * discount_T;
+            }
+        });
+
+        const auto step_coefs = [&](int64_t option, int64_t j) { return coefs + (option * (n_steps + 1) + j) * n_basis; };
+
+        for (int64_t j = last_maturity - 1; j > 0; j--) {
+            const double* s = S + j * n_paths;
+            const double discount_next = discount(j + 1);
+            at::parallel_for(0, n_blocks * n_options, 1, [&](int64_t begin, int64_t end) {
+                for (int64_t task = begin; task < end; task++) {
+                    const int64_t block = task / n_options, option = task % n_options;
+                    if (j >= maturities[option]) continue;
+                    const double* s_next = (j + 1 < maturities[option]) ? s + n_paths : nullptr;
+                    double* acc = partial + task * stride;
+                    std::fill(acc, acc + stride, 0.);
+                    const int64_t last = std::min(n_paths, (block + 1) * BLOCK_SIZE);
+                    with_degree(degree, [&](auto D) {
+                        regression_block<decltype(D)::value>(s, s_next, step_coefs(option, j + 1), discount_next,
+                                                             strikes[option], block * BLOCK_SIZE, last,
+                                                             value + option * n_paths, acc);
+                    });
+                }
+            });
+
+            for (int64_t option = 0; option < n_options; option++) {
+                if (j >= maturities[option]) continue;
+                double* sums = partial + option * stride;
+                for (int64_t block = 1; block < n_blocks; block++)
+                    for (int64_t k = 0; k < stride; k++) sums[k] += partial[(block * n_options + option) * stride + k];
+                if (sums[0] > 0)  // some paths are in the money
+                    solve_normal_equations(sums, sums + 2 * degree + 1, n_basis,
+                                           coefs + (option * (n_steps + 1) + j) * n_basis);
+            }
+        }
+
+        // exercise decision of step 1
+        const double discount_1 = discount(1);
+        at::parallel_for(0, n_blocks * n_options, 1, [&](int64_t begin, int64_t end) {
+            for (int64_t task = begin; task < end; task++) {
+                const int64_t block = task / n_options, option = task % n_options;
+                if (maturities[option] < 2) continue;
+                const double strike = strikes[option];
+                const double* c = step_coefs(option, 1);
+                double* v = value + option * n_paths;
+                const int64_t last = std::min(n_paths, (block + 1) * BLOCK_SIZE);
+                for (int64_t i = block * BLOCK_SIZE; i < last; i++) {
+                    const double price = S[n_paths + i];
+                    const double payoff = (strike - price) * discount_1;
+                    if (price < strike && payoff >= horner(c, degree, price / strike)) v[i] = payoff;
+                }
+            }
+        });
     }
 
-    return result;
+    /**
+     * Pricing pass of LSM for a ladder of puts, on row-major paths S[i * (n_steps + 1) + j]:
+     * each path is stopped at the first step where the exercise value beats the continuation
+     * value regressed by `regression_kernel`. The row of a path is reused by all the options.
+     *
+     * @param payoffs On output, the cashflows of the paths discounted to t = 0. Size: n_options * n_paths.
+     *     May be null.
+     * @param stops On output, the stopping steps of the paths. Size: n_options * n_paths. May be null.
+     */
+    inline void pricing_kernel(const double* S, int64_t n_paths, int64_t n_steps, double dt,
+                               const double* strikes, const int64_t* maturities, int64_t n_options,
+                               double rate, int64_t degree, const double* coefs, double* payoffs,
+                               int64_t* stops = nullptr) {
+        const int64_t n_basis = degree + 1;
+        std::vector<double> discount(n_steps + 1);
+        for (int64_t j = 0; j <= n_steps; j++) discount[j] = std::exp(-rate * static_cast<double>(j) * dt);
+
+        at::parallel_for(0, n_paths, BLOCK_SIZE, [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; i++) {
+                const double* path = S + i * (n_steps + 1);
+                for (int64_t option = 0; option < n_options; option++) {
+                    const double strike = strikes[option];
+                    const double* c = coefs + option * (n_steps + 1) * n_basis;
+                    const int64_t maturity = maturities[option];
+                    int64_t j = 1;
+                    for (; j < maturity; j++) {
+                        const double payoff = (strike - path[j]) * discount[j];
+                        if (path[j] < strike && payoff >= horner(c + j * n_basis, degree, path[j] / strike))
+                            break;
+                    }
+                    if (payoffs != nullptr)
+                        payoffs[option * n_paths + i] = std::max(strike - path[j], 0.) * discount[j];
+                    if (stops != nullptr) stops[option * n_paths + i] = j;
+                }
+            }
+        });
+    }
+
+    }  // namespace lsm_impl
+
+/**
+ * Regression pass of LSM: the continuation values of the in-the-money paths are regressed
+ * on polynomials of the underlying, step by step backwards (see `lsm_impl::regression_kernel`).
+ *
+ * @return The price, the regression coefficients of the continuation value discounted to
+ *     step j, in powers of the underlying from the highest (as `torch::vander`), of shape
+ *     (n_steps + 1, reg_poly_degree + 1), and the estimated continuation value at t = 0.
+ */
+LSMResult
+_lsm_regression_step(
+    const torch::Tensor& paths,
+    double& dt,
+    const torch::Tensor& strike,
+    const torch::Tensor& rate,
+    int64_t reg_poly_degree,
+    [[maybe_unused]] bool return_extra
+)
+{
+    if (reg_poly_degree < 0 || reg_poly_degree > lsm_impl::MAX_DEGREE)
+        throw std::invalid_argument("Degree of the regression polynomial must be in [0, 8]");
+
+    int64_t n_paths = paths.sizes()[0];
+    int64_t n_steps = paths.sizes()[1] - 1;
+    int64_t n_basis = reg_poly_degree + 1;
+    double K = strike.item<double>();
+    double r = rate.item<double>();
+
+    // columns are traversed once per step
+    torch::Tensor columns = paths.detach().to(torch::kCPU, torch::kFloat64).t().contiguous();
+    torch::Tensor value = torch::empty(n_paths, torch::kFloat64);
+    torch::Tensor coefs = torch::zeros({n_steps + 1, n_basis}, torch::kFloat64);
+    torch::Tensor partial = torch::empty(
+            {(n_paths + lsm_impl::BLOCK_SIZE - 1) / lsm_impl::BLOCK_SIZE, lsm_impl::n_sums(reg_poly_degree)},
+            torch::kFloat64);
+    lsm_impl::regression_kernel(columns.data_ptr<double>(), n_paths, n_steps, dt, &K, &n_steps, 1, r, reg_poly_degree,
+                                value.data_ptr<double>(), coefs.data_ptr<double>(), partial.data_ptr<double>());
+
+    // coefficients in powers of S, discounted to step j
+    torch::Tensor power_scale = torch::pow(K, -torch::arange(n_basis, torch::kFloat64));
+    torch::Tensor step_scale = torch::exp(r * dt * torch::arange(n_steps + 1, torch::kFloat64));
+    torch::Tensor reg_poly_coefs = (coefs * power_scale.unsqueeze(0) * step_scale.unsqueeze(1)).flip(1);
+
+    torch::Tensor C_hat = value.mean();
+    torch::Tensor payoff_now = torch::maximum(strike - paths.index({0, 0}), torch::tensor(0.0));
+    torch::Tensor option_price = torch::maximum(payoff_now, C_hat);
+
+    return LSMResult{option_price, reg_poly_coefs, C_hat};
 }
 
+/**
+ * Pricing pass of LSM on paths independent of the regression: each path is stopped at the
+ * first step j in [1, M) where the exercise value beats the regressed continuation value,
+ * else at expiry (see `lsm_impl::pricing_kernel`, shared with `price_american_put_lsm_ladder`).
+ * The stopping steps are fixed, but the cashflows are built in torch, so that the price can be
+ * differentiated w.r.t. the paths, the strike and the rate (delta, vega, ...).
+ *
+ * @return `result_reg_step` with the price and the cashflows of the paths discounted to t = 0.
+ */
 LSMResult
 _lsm_pricing_step(
     const torch::Tensor& paths,
@@ -172,47 +433,38 @@ _lsm_pricing_step(
 {
     int64_t n_paths = paths.sizes()[0];
     int64_t n_steps = paths.sizes()[1] - 1;
-    torch::Tensor payoff = torch::zeros(n_paths);
-    torch::Tensor stopped_mask = torch::zeros(n_paths, torch::TensorOptions().dtype(torch::kBool));
+    int64_t n_basis = reg_poly_degree + 1;
+    double K = strike.item<double>();
+    double r = rate.item<double>();
     torch::Tensor payoff_now = torch::maximum(strike - paths.index({0, 0}), torch::tensor(0.0));
 
     torch::Tensor option_price;
+    torch::Tensor payoff;
     if (torch::all(payoff_now > result_reg_step.initial_cont_value).item<bool>()) {
         option_price = payoff_now;
+        payoff = payoff_now.expand({n_paths});
     } else {
-        for (int64_t j = 1; j < n_steps - 1; ++j) {
-            torch::Tensor itm_mask = (paths.index({Slice(), j}) < strike) & (~stopped_mask);
-            if (itm_mask.numel() == 0) {
-                continue;
-            }
-            torch::Tensor paths_itm = paths.index({Slice(), j}).index({itm_mask});
-            
-            torch::Tensor vander = torch::vander(paths_itm, reg_poly_degree + 1);
-            torch::Tensor cont_value = torch::matmul(vander, result_reg_step.reg_poly_coefs.index({j}));  // continuation value
-
-            torch::Tensor payoff_itm_now = strike - paths_itm;
-            torch::Tensor stop_now_mask = (payoff_itm_now >= cont_value);
-            payoff.index_put_({itm_mask}, torch::where(
-                stop_now_mask,
-                payoff_itm_now * torch::exp(-rate * j * dt),
-                payoff.index({itm_mask})
-            ));
-
-            stopped_mask.index_put_({itm_mask}, stopped_mask.index({itm_mask}) | stop_now_mask); 
-        }
-
-        // last step - expiration time
-        torch::Tensor stop_now_mask = ~stopped_mask;
-        payoff_now = torch::maximum(strike - paths.index({Slice(), -1}), torch::zeros(n_paths));
-        payoff = torch::where(
-            stop_now_mask,
-            payoff_now * torch::exp(-rate * n_steps * dt),
-            payoff
-        );
-        option_price = torch::mean(payoff);
+        // coefficients back in powers of S / K from the lowest, discounted to t = 0
+        torch::Tensor power_scale = torch::pow(K, torch::arange(n_basis, torch::kFloat64));
+        torch::Tensor step_scale = torch::exp(-r * dt * torch::arange(n_steps + 1, torch::kFloat64));
+        torch::Tensor coefs = (result_reg_step.reg_poly_coefs.to(torch::kCPU, torch::kFloat64).flip(1) *
+                               power_scale.unsqueeze(0) * step_scale.unsqueeze(1)).contiguous();
+
+        // rows are traversed once per path, for the stopping decisions only
+        torch::Tensor rows = paths.detach().to(torch::kCPU, torch::kFloat64).contiguous();
+        torch::Tensor tau = torch::empty(n_paths, torch::kInt64);
+        lsm_impl::pricing_kernel(rows.data_ptr<double>(), n_paths, n_steps, dt, &K, &n_steps, 1, r, reg_poly_degree,
+                                 coefs.data_ptr<double>(), nullptr, tau.data_ptr<int64_t>());
+
+        // cashflows in torch, differentiable w.r.t. the paths, the strike and the rate
+        tau = tau.to(paths.device());
+        torch::Tensor stopped = paths.gather(1, tau.unsqueeze(1)).squeeze(1);
+        payoff = torch::relu(strike - stopped) * torch::exp(-rate * tau * dt);
+        option_price = payoff.mean();
     }
 
     result_reg_step.option_price = option_price;
+    result_reg_step.payoffs = payoff;
     return result_reg_step;
 }
 
@@ -246,5 +498,91 @@ price_american_put_lsm(
     return {result_reg_step.option_price, result_reg_step.reg_poly_coefs, result_reg_step.initial_cont_value};
 }
 
+/**
+ * Prices a ladder of American puts (strikes and maturities) with the Longstaff-Schwartz
+ * method, on one set of paths.
+ *
+ * The options share the traversals of the paths: the regression pass reads each time column
+ * once for all the options, accumulating their normal equations side by side, and the pricing
+ * pass reads each path once (see `lsm_impl::regression_kernel`, `lsm_impl::pricing_kernel`).
+ * Work is parallel over blocks of paths and options, so that a ladder costs little more
+ * than a single strike in memory traffic. Regression and pricing are not differentiable.
+ *
+ * @param paths_regression Paths of the regression pass, starting from the same point S0.
+ *     Shape: (N, M + 1), where M is the number of time steps.
+ * @param paths_pricing Paths of the pricing pass, independent of `paths_regression`. Shape: (N', M + 1).
+ * @param dt Time step.
+ * @param strikes Strikes of the options. Shape: (n_options,).
+ * @param rate Risk-free rate, as for `price_american_put_lsm`.
+ * @param maturities Maturities of the options as numbers of time steps, in [1, M].
+ *     Shape: (n_options,). If undefined, all the options expire at step M.
+ * @param reg_poly_degree Degree of the regression polynomial.
+ * @return 1) Prices of the options at initial moment of time. Shape: (n_options,).
+ *         2) Regression coefficients of the continuation values, as for `price_american_put_lsm`.
+ *            Shape: (n_options, M + 1, reg_poly_degree + 1).
+ *         3) Cashflows of the pricing paths discounted to initial moment of time. Shape: (n_options, N').
+ */
+std::tuple<torch::Tensor, torch::Tensor, torch::Tensor>
+price_american_put_lsm_ladder(
+    const torch::Tensor& paths_regression,
+    const torch::Tensor& paths_pricing,
+    double dt,
+    const torch::Tensor& strikes,
+    double rate,
+    const torch::Tensor& maturities = torch::Tensor(),
+    int64_t reg_poly_degree = 3)
+{
+    if (paths_regression.dim() != 2 || paths_pricing.dim() != 2 ||
+        paths_regression.sizes()[1] != paths_pricing.sizes()[1] || paths_regression.sizes()[1] < 2)
+        throw std::invalid_argument("Paths must be of shape (n_paths, n_steps + 1) with the same number of time steps");
+    if (strikes.dim() != 1 || (maturities.defined() && maturities.sizes() != strikes.sizes()))
+        throw std::invalid_argument("Shapes of `strikes` and `maturities` must be (n_options,)");
+    if (reg_poly_degree < 0 || reg_poly_degree > lsm_impl::MAX_DEGREE)
+        throw std::invalid_argument("Degree of the regression polynomial must be in [0, 8]");
+
+    int64_t n_regression = paths_regression.sizes()[0];
+    int64_t n_pricing = paths_pricing.sizes()[0];
+    int64_t n_steps = paths_regression.sizes()[1] - 1;
+    int64_t n_options = strikes.sizes()[0];
+    int64_t n_basis = reg_poly_degree + 1;
+
+    torch::Tensor K = strikes.detach().to(torch::kCPU, torch::kFloat64).contiguous();
+    torch::Tensor steps = maturities.defined()
+            ? maturities.to(torch::kCPU, torch::kInt64).contiguous()
+            : torch::full({n_options}, n_steps, torch::kInt64);
+    if (n_options == 0)
+        return {torch::empty({0}, torch::kFloat64), torch::empty({0, n_steps + 1, n_basis}, torch::kFloat64),
+                torch::empty({0, n_pricing}, torch::kFloat64)};
+    if ((steps < 1).any().item<bool>() || (steps > n_steps).any().item<bool>())
+        throw std::invalid_argument("Maturities must be in [1, n_steps]");
+
+    torch::Tensor columns = paths_regression.detach().to(torch::kCPU, torch::kFloat64).t().contiguous();
+    torch::Tensor rows = paths_pricing.detach().to(torch::kCPU, torch::kFloat64).contiguous();
+    torch::Tensor value = torch::empty({n_options, n_regression}, torch::kFloat64);
+    torch::Tensor coefs = torch::zeros({n_options, n_steps + 1, n_basis}, torch::kFloat64);
+    torch::Tensor partial = torch::empty(
+            {(n_regression + lsm_impl::BLOCK_SIZE - 1) / lsm_impl::BLOCK_SIZE, n_options,
+             lsm_impl::n_sums(reg_poly_degree)}, torch::kFloat64);
+    torch::Tensor payoffs = torch::empty({n_options, n_pricing}, torch::kFloat64);
+
+    lsm_impl::regression_kernel(columns.data_ptr<double>(), n_regression, n_steps, dt,
+                                K.data_ptr<double>(), steps.data_ptr<int64_t>(), n_options, rate, reg_poly_degree,
+                                value.data_ptr<double>(), coefs.data_ptr<double>(), partial.data_ptr<double>());
+    lsm_impl::pricing_kernel(rows.data_ptr<double>(), n_pricing, n_steps, dt,
+                             K.data_ptr<double>(), steps.data_ptr<int64_t>(), n_options, rate, reg_poly_degree,
+                             coefs.data_ptr<double>(), payoffs.data_ptr<double>());
+
+    // exercise at initial moment of time if it beats the continuation value of the regression
+    torch::Tensor payoff_now = torch::relu(K - columns.index({0, 0}));
+    torch::Tensor prices = torch::where(payoff_now > value.mean(1), payoff_now, payoffs.mean(1));
+
+    // coefficients in powers of S, discounted to step j
+    torch::Tensor power_scale = torch::pow(K.unsqueeze(1), -torch::arange(n_basis, torch::kFloat64));
+    torch::Tensor step_scale = torch::exp(rate * dt * torch::arange(n_steps + 1, torch::kFloat64));
+    torch::Tensor reg_poly_coefs = (coefs * power_scale.unsqueeze(1) * step_scale.view({1, -1, 1})).flip(2);
+
+    return {prices, reg_poly_coefs, payoffs};
+}
+
 
 }
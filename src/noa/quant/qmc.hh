@@ -0,0 +1,341 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * Quasi-Monte Carlo path generation: Owen scrambled Sobol points (`noa::utils::sobol`),
+ * mapped to Brownian paths with the Brownian bridge construction.
+ *
+ * The bridge draws the terminal value first, then the midpoints of the remaining
+ * intervals, so that the first (best distributed) Sobol coordinates carry most of
+ * the variance of the path [Glasserman2003, section 5.2.3]. Scrambling randomises the
+ * points: independent seeds give independent unbiased estimates, whose spread measures
+ * the error.
+ *
+ * References:
+ *     - [Glasserman2003] Glasserman, P. (2003). Monte Carlo methods in financial
+ *       engineering. Springer.
+ *
+ *     - [Jaeckel2002] Jäckel, P. (2002). Monte Carlo methods in finance. Wiley.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include <torch/torch.h>
+
+#include "noa/quant/heston_sim.hh"
+#include "noa/utils/sobol.hh"
+
+namespace noa::quant {
+
+/**
+ * Brownian bridge over n_steps unit time steps [Jaeckel2002, section 10.8.3],
+ * for any number of steps.
+ */
+class BrownianBridge {
+    int64_t n_steps;
+    // point bridge_index[i] is drawn at stage i between left_index[i] - 1 and right_index[i]
+    std::vector<int64_t> bridge_index, left_index, right_index;
+    std::vector<double> left_weight, right_weight, std_dev;
+
+public:
+    explicit BrownianBridge(int64_t n_steps_)
+            : n_steps{n_steps_},
+              bridge_index(n_steps_), left_index(n_steps_), right_index(n_steps_),
+              left_weight(n_steps_), right_weight(n_steps_), std_dev(n_steps_) {
+        if (n_steps < 1)
+            throw std::invalid_argument("Brownian bridge requires at least one step");
+
+        // times t_k = k + 1 of the points
+        const auto t = [](int64_t k) { return static_cast<double>(k + 1); };
+        std::vector<bool> drawn(n_steps, false);
+        drawn[n_steps - 1] = true;
+        bridge_index[0] = n_steps - 1;
+        std_dev[0] = std::sqrt(t(n_steps - 1));
+
+        int64_t j = 0;
+        for (int64_t i = 1; i < n_steps; i++) {
+            // next interval (j - 1, k] with undrawn points, k being drawn
+            while (drawn[j]) j++;
+            int64_t k = j;
+            while (!drawn[k]) k++;
+            const int64_t l = j + ((k - 1 - j) >> 1);
+            drawn[l] = true;
+            bridge_index[i] = l;
+            left_index[i] = j;
+            right_index[i] = k;
+
+            const double t_left = (j > 0) ? t(j - 1) : 0.;
+            left_weight[i] = (t(k) - t(l)) / (t(k) - t_left);
+            right_weight[i] = (t(l) - t_left) / (t(k) - t_left);
+            std_dev[i] = std::sqrt((t(l) - t_left) * (t(k) - t(l)) / (t(k) - t_left));
+
+            j = k + 1;
+            if (j >= n_steps) j = 0;
+        }
+    }
+
+    inline int64_t get_steps() const { return n_steps; }
+
+    /**
+     * Maps independent standard normals, in the order of importance, to the increments
+     * of a Brownian motion over unit time steps (independent standard normals too).
+     * Both arrays have n_steps elements.
+     */
+    template<typename Real>
+    void increments(const Real* normals, Real* output) const {
+        Real* path = output;
+        path[n_steps - 1] = std_dev[0] * normals[0];
+        for (int64_t i = 1; i < n_steps; i++) {
+            const int64_t j = left_index[i], k = right_index[i], l = bridge_index[i];
+            path[l] = right_weight[i] * path[k] + std_dev[i] * normals[i];
+            if (j > 0) path[l] += left_weight[i] * path[j - 1];
+        }
+        for (int64_t k = n_steps - 1; k > 0; k--) path[k] -= path[k - 1];
+    }
+
+    /// Increments of the paths given normals of shape (n_paths, n_steps), on CPU
+    torch::Tensor increments(const torch::Tensor& normals) const {
+        if (normals.dim() != 2 || normals.size(1) != n_steps)
+            throw std::invalid_argument("Shape of `normals` must be (n_paths, n_steps)");
+        const torch::Tensor input = normals.to(torch::kFloat64).contiguous();
+        torch::Tensor output = torch::empty_like(input);
+        const double* in = input.data_ptr<double>();
+        double* out = output.data_ptr<double>();
+        at::parallel_for(0, input.size(0), 1, [&](int64_t begin, int64_t end) {
+            for (int64_t path = begin; path < end; path++)
+                increments(in + path * n_steps, out + path * n_steps);
+        });
+        return output.to(normals.dtype());
+    }
+};
+
+    namespace qmc_impl {
+
+    /// Standard normal cumulative distribution function
+    inline double normal_cdf(double x) {
+        return 0.5 * std::erfc(-x * M_SQRT1_2);
+    }
+
+    inline void check_points(int64_t n_points) {
+        if (n_points < 1 || n_points > (int64_t{1} << 32))
+            throw std::invalid_argument("The number of quasi-random points must be in [1, 2^32]");
+    }
+
+    /**
+     * Step-major (n_steps, n_paths) uniform variates of the QE scheme for quasi-random paths.
+     * The variance of step k uses the Sobol coordinate `var_dim(k)`. If `price_dim` is not
+     * negative, the price uses the Brownian bridge over the coordinates price_dim(0), price_dim(1), ...
+     * mapped back to uniforms.
+     */
+    template<typename scalar_t, typename VarDim, typename PriceDim>
+    void qe_tables(const noa::utils::sobol::ScrambledSobol& sobol, int64_t n_paths, int64_t n_steps,
+                   const VarDim& var_dim, const PriceDim& price_dim, bool with_price,
+                   scalar_t* u_var, scalar_t* u_price) {
+        const BrownianBridge bridge{n_steps};
+        at::parallel_for(0, n_paths, 1, [&](int64_t begin, int64_t end) {
+            std::vector<double> normals(n_steps), increments(n_steps);
+            for (int64_t path = begin; path < end; path++) {
+                const auto index = static_cast<uint32_t>(path);
+                for (int64_t k = 0; k < n_steps; k++)
+                    u_var[k * n_paths + path] = heston_impl::open_unit<scalar_t>(sobol(index, var_dim(k)));
+                if (!with_price) continue;
+                for (int64_t k = 0; k < n_steps; k++)
+                    normals[k] = heston_impl::inverse_normal_cdf(sobol(index, price_dim(k)));
+                bridge.increments(normals.data(), increments.data());
+                for (int64_t k = 0; k < n_steps; k++)
+                    u_price[k * n_paths + path] = heston_impl::open_unit<scalar_t>(normal_cdf(increments[k]));
+            }
+        });
+    }
+
+    } // namespace qmc_impl
+
+/**
+ * Owen scrambled Sobol points, see `noa::utils::sobol::ScrambledSobol`.
+ *
+ * @param n_points Number of points, preferably a power of 2.
+ * @param n_dims Dimension of the points.
+ * @param seed Seed of the scrambling.
+ * @return Points in (0, 1)^n_dims. Shape: (n_points, n_dims). Dtype: torch::kFloat64.
+ */
+torch::Tensor
+sobol_uniforms(int64_t n_points, int64_t n_dims, uint64_t seed) {
+    qmc_impl::check_points(n_points);
+    const noa::utils::sobol::ScrambledSobol sobol{n_dims, seed};
+    torch::Tensor points = torch::empty({n_points, n_dims}, torch::kFloat64);
+    double* data = points.data_ptr<double>();
+    at::parallel_for(0, n_points, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; i++)
+            for (int64_t dim = 0; dim < n_dims; dim++)
+                data[i * n_dims + dim] = sobol(static_cast<uint32_t>(i), dim);
+    });
+    return points;
+}
+
+/**
+ * Quasi-Monte Carlo version of `generate_heston`, with the fused QE kernel.
+ *
+ * Sobol coordinates are interleaved between the processes: 2k drives the k-th normal of
+ * the Brownian bridge of the price, 2k + 1 the variance of step k + 1, so that the coarse
+ * structure of both paths lies in the first coordinates.
+ *
+ * @param seed Seed of the scrambling.
+ * @return Two tensors: simulated paths for price, simulated paths for variance.
+ *     Both tensors have shape (n_paths, n_steps + 1).
+ */
+std::tuple<torch::Tensor, torch::Tensor>
+generate_heston_qmc(int64_t n_paths, int64_t n_steps, double dt,
+                    const torch::Tensor& init_state_price,
+                    const torch::Tensor& init_state_var,
+                    const torch::Tensor& kappa,
+                    const torch::Tensor& theta,
+                    const torch::Tensor& eps,
+                    const torch::Tensor& rho,
+                    const torch::Tensor& drift,
+                    uint64_t seed,
+                    double minimum_var = 0)
+{
+    if (init_state_price.sizes() != torch::IntArrayRef{n_paths})
+        throw std::invalid_argument("Shape of `init_state_price` must be (n_paths,)");
+    if (init_state_var.sizes() != torch::IntArrayRef{n_paths})
+        throw std::invalid_argument("Shape of `init_state_var` must be (n_paths,)");
+    if (!heston_impl::is_fusable(init_state_var, {kappa, theta, eps, rho, drift}) ||
+        !init_state_price.device().is_cpu())
+        throw std::invalid_argument("Quasi-Monte Carlo paths require CPU tensors and scalar parameters");
+    qmc_impl::check_points(n_paths);
+
+    const auto coefficients = heston_impl::qe_coefficients<double>(
+            dt, kappa.item<double>(), theta.item<double>(), eps.item<double>(),
+            rho.item<double>(), drift.item<double>());
+    const noa::utils::sobol::ScrambledSobol sobol{2 * n_steps, seed};
+    const torch::Tensor var0 = init_state_var.detach().contiguous();
+    const torch::Tensor price0 = init_state_price.detach().to(var0.dtype()).contiguous();
+    torch::Tensor u_var = torch::empty({n_steps, n_paths}, var0.options());
+    torch::Tensor u_price = torch::empty_like(u_var);
+    torch::Tensor var_paths = torch::empty({n_paths, n_steps + 1}, var0.options());
+    torch::Tensor price_paths = torch::empty_like(var_paths);
+
+    AT_DISPATCH_FLOATING_TYPES(var0.scalar_type(), "noa::quant::generate_heston_qmc", [&] {
+        qmc_impl::qe_tables<scalar_t>(sobol, n_paths, n_steps,
+                                      [](int64_t k) { return 2 * k + 1; }, [](int64_t k) { return 2 * k; }, true,
+                                      u_var.data_ptr<scalar_t>(), u_price.data_ptr<scalar_t>());
+        heston_impl::advance_qe<scalar_t, true>(
+                n_paths, n_steps,
+                heston_impl::TableUniforms<scalar_t>{u_var.data_ptr<scalar_t>(), u_price.data_ptr<scalar_t>(), n_paths},
+                coefficients, minimum_var, price0.data_ptr<scalar_t>(), var0.data_ptr<scalar_t>(),
+                heston_impl::PathSink<scalar_t, true>{n_steps + 1, price_paths.data_ptr<scalar_t>(),
+                                                      var_paths.data_ptr<scalar_t>()});
+    });
+    return std::make_tuple(price_paths, var_paths);
+}
+
+/**
+ * Quasi-Monte Carlo version of `generate_cir`, with the fused QE kernel.
+ * Sobol coordinate k drives step k + 1.
+ *
+ * @param seed Seed of the scrambling.
+ * @return Simulated paths of CIR process. Shape: (n_paths, n_steps + 1).
+ */
+torch::Tensor
+generate_cir_qmc(int64_t n_paths, int64_t n_steps, double dt,
+                 const torch::Tensor& init_state,
+                 const torch::Tensor& kappa,
+                 const torch::Tensor& theta,
+                 const torch::Tensor& eps,
+                 uint64_t seed,
+                 double minimum_value = 0)
+{
+    if (init_state.sizes() != torch::IntArrayRef{n_paths})
+        throw std::invalid_argument("Shape of `init_state` must be (n_paths,)");
+    if (!heston_impl::is_fusable(init_state, {kappa, theta, eps}))
+        throw std::invalid_argument("Quasi-Monte Carlo paths require CPU tensors and scalar parameters");
+    qmc_impl::check_points(n_paths);
+
+    const auto coefficients = heston_impl::qe_coefficients<double>(
+            dt, kappa.item<double>(), theta.item<double>(), eps.item<double>(), 0., 0.);
+    const noa::utils::sobol::ScrambledSobol sobol{n_steps, seed};
+    const torch::Tensor var0 = init_state.detach().contiguous();
+    torch::Tensor u_var = torch::empty({n_steps, n_paths}, var0.options());
+    torch::Tensor paths = torch::empty({n_paths, n_steps + 1}, var0.options());
+
+    AT_DISPATCH_FLOATING_TYPES(var0.scalar_type(), "noa::quant::generate_cir_qmc", [&] {
+        const auto identity = [](int64_t k) { return k; };
+        qmc_impl::qe_tables<scalar_t>(sobol, n_paths, n_steps, identity, identity, false,
+                                      u_var.data_ptr<scalar_t>(), nullptr);
+        heston_impl::advance_qe<scalar_t, false>(
+                n_paths, n_steps, heston_impl::TableUniforms<scalar_t>{u_var.data_ptr<scalar_t>(), nullptr, n_paths},
+                coefficients, minimum_value, nullptr, var0.data_ptr<scalar_t>(),
+                heston_impl::PathSink<scalar_t, false>{n_steps + 1, nullptr, paths.data_ptr<scalar_t>()});
+    });
+    return paths;
+}
+
+/**
+ * Quasi-Monte Carlo paths of the geometric Brownian motion
+ * dS(t) = μ·S(t)·dt + σ·S(t)·dW(t), sampled exactly on the time grid through the
+ * Brownian bridge, e.g. for `price_american_put_lsm`.
+ *
+ * @param n_paths Number of paths, preferably a power of 2.
+ * @param n_steps Number of time steps.
+ * @param dt Time step.
+ * @param init_price S(0).
+ * @param drift μ, the risk-free rate for pricing.
+ * @param sigma Volatility σ.
+ * @param seed Seed of the scrambling.
+ * @return Paths. Shape: (n_paths, n_steps + 1). Dtype: torch::kFloat64.
+ */
+torch::Tensor
+generate_gbm_qmc(int64_t n_paths, int64_t n_steps, double dt,
+                 double init_price, double drift, double sigma, uint64_t seed)
+{
+    qmc_impl::check_points(n_paths);
+    const noa::utils::sobol::ScrambledSobol sobol{n_steps, seed};
+    const BrownianBridge bridge{n_steps};
+    torch::Tensor paths = torch::empty({n_paths, n_steps + 1}, torch::kFloat64);
+    double* data = paths.data_ptr<double>();
+    const double mean = (drift - 0.5 * sigma * sigma) * dt;
+    const double scale = sigma * std::sqrt(dt);
+
+    at::parallel_for(0, n_paths, 1, [&](int64_t begin, int64_t end) {
+        std::vector<double> normals(n_steps), increments(n_steps);
+        for (int64_t path = begin; path < end; path++) {
+            for (int64_t k = 0; k < n_steps; k++)
+                normals[k] = heston_impl::inverse_normal_cdf(sobol(static_cast<uint32_t>(path), k));
+            bridge.increments(normals.data(), increments.data());
+            double* row = data + path * (n_steps + 1);
+            double log_price = std::log(init_price);
+            row[0] = init_price;
+            for (int64_t k = 0; k < n_steps; k++) {
+                log_price += mean + scale * increments[k];
+                row[k + 1] = std::exp(log_price);
+            }
+        }
+    });
+    return paths;
+}
+
+} // namespace noa::quant
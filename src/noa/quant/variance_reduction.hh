@@ -0,0 +1,232 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * Variance reduction for Monte Carlo pricing: antithetic paths and control variates.
+ *
+ * Antithetic paths come in adjacent pairs (2i, 2i + 1) driven by reflected random numbers,
+ * see `generate_gbm` and `generate_heston`. The control variate is a payoff X with a known
+ * mean, typically the European option priced analytically (`noa::quant::price_european_bs`,
+ * `noa::quant::price_european_heston`), regressed out of the payoff Y with the optimal
+ * coefficient beta = Cov(Y, X) / Var(X) [Glasserman2003, section 4.1].
+ *
+ * References:
+ *     - [Glasserman2003] Glasserman, P. (2003). Monte Carlo methods in financial
+ *       engineering. Springer.
+ *
+ *     - [Chan1979] Chan, T. F., Golub, G. H., & LeVeque, R. J. (1979). Updating formulae
+ *       and a pairwise algorithm for computing sample variances. Technical report STAN-CS-79-773.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include <torch/torch.h>
+
+#include "noa/quant/european.hh"
+#include "noa/quant/lsm.hh"
+
+namespace noa::quant {
+
+/**
+ * Generates paths of the geometric Brownian motion dS(t) = μ·S(t)·dt + σ·S(t)·dW(t),
+ * exactly on the time grid.
+ *
+ * @param antithetic Generate antithetic pairs: paths 2i and 2i + 1 have opposite
+ *     Brownian increments. n_paths must be even.
+ * @return Simulated paths. Shape: (n_paths, n_steps + 1). Dtype: torch::kFloat64.
+ */
+torch::Tensor
+generate_gbm(int64_t n_paths, int64_t n_steps, double dt,
+             double init_price, double drift, double sigma, bool antithetic = false)
+{
+    if (antithetic && n_paths % 2 != 0)
+        throw std::invalid_argument("Antithetic pairs require an even `n_paths`");
+
+    torch::Tensor normals;
+    if (antithetic) {
+        const torch::Tensor z = torch::randn({n_paths / 2, n_steps}, torch::kFloat64);
+        normals = torch::stack({z, -z}, 1).reshape({n_paths, n_steps});
+    } else {
+        normals = torch::randn({n_paths, n_steps}, torch::kFloat64);
+    }
+    torch::Tensor log_paths = torch::cumsum((drift - 0.5 * sigma * sigma) * dt + sigma * std::sqrt(dt) * normals, 1);
+    return init_price * torch::exp(torch::hstack({torch::zeros({n_paths, 1}, torch::kFloat64), log_paths}));
+}
+
+/// Estimates of `ControlVariate`
+struct ControlVariateResult {
+    double price;               // control variate estimate
+    double std_error;           // its standard error
+    double beta;                // optimal coefficient of the control
+    double plain_price;         // plain Monte Carlo estimate, the mean payoff
+    double plain_std_error;     // its standard error, for independent paths
+    double variance_reduction;  // ratio of the variances per path: paths needed by plain Monte Carlo
+                                // for the same error, per path of the estimator
+};
+
+/**
+ * Control variate estimator of E[Y], accumulated online over chunks of paths.
+ *
+ * Each sample has a payoff Y and a control X of known mean E[X], and the estimate is
+ *
+ * mean(Y) - beta·(mean(X) - E[X]), beta = Cov(Y, X) / Var(X),
+ *
+ * with beta estimated from all the samples. Moments are merged chunk by chunk [Chan1979],
+ * so that paths can be simulated and discarded, e.g. in the chunks of `stream_heston`.
+ * Without controls, the estimator reduces to the (antithetic) sample mean.
+ *
+ * With `antithetic`, the payoffs are those of adjacent antithetic pairs, whose means are
+ * the independent samples. The variance reduction factor then accounts for both techniques.
+ */
+class ControlVariate {
+    double control_mean;
+    bool antithetic;
+
+    // moments of the samples: count, means and centred sums of products
+    double n = 0, mean_y = 0, mean_x = 0, m_yy = 0, m_xx = 0, m_xy = 0;
+    // moments of the payoffs of the single paths, for the plain Monte Carlo reference
+    double n_paths = 0, mean_path = 0, m_path = 0;
+
+public:
+    explicit ControlVariate(double control_mean_ = 0, bool antithetic_ = false)
+            : control_mean{control_mean_}, antithetic{antithetic_} {}
+
+    /**
+     * Adds a chunk of paths.
+     *
+     * @param payoffs Payoffs Y of the paths. Shape: (n,).
+     * @param controls Controls X of the paths. Shape: (n,). Undefined if there is no control.
+     */
+    void update(const torch::Tensor& payoffs, const torch::Tensor& controls = torch::Tensor()) {
+        if (payoffs.dim() != 1 || (controls.defined() && controls.sizes() != payoffs.sizes()))
+            throw std::invalid_argument("Shapes of `payoffs` and `controls` must be (n,)");
+        if (antithetic && payoffs.size(0) % 2 != 0)
+            throw std::invalid_argument("Antithetic pairs require an even number of payoffs");
+        if (payoffs.size(0) == 0)
+            return;
+
+        torch::NoGradGuard no_grad;
+        torch::Tensor y = payoffs.to(torch::kFloat64);
+        torch::Tensor x = controls.defined() ? controls.to(torch::kFloat64) : torch::zeros_like(y);
+
+        const double path_mean = y.mean().item<double>();
+        merge(n_paths, mean_path, m_path, static_cast<double>(y.size(0)), path_mean,
+              (y - path_mean).square().sum().item<double>());
+
+        if (antithetic) {
+            y = y.view({-1, 2}).mean(1);
+            x = x.view({-1, 2}).mean(1);
+        }
+        const double nb = static_cast<double>(y.size(0));
+        const double mean_yb = y.mean().item<double>();
+        const double mean_xb = x.mean().item<double>();
+        const torch::Tensor yc = y - mean_yb;
+        const torch::Tensor xc = x - mean_xb;
+        const double delta_y = mean_yb - mean_y;
+        const double delta_x = mean_xb - mean_x;
+        const double weight = n * nb / (n + nb);
+        m_yy += yc.square().sum().item<double>() + delta_y * delta_y * weight;
+        m_xx += xc.square().sum().item<double>() + delta_x * delta_x * weight;
+        m_xy += (yc * xc).sum().item<double>() + delta_y * delta_x * weight;
+        mean_y += delta_y * nb / (n + nb);
+        mean_x += delta_x * nb / (n + nb);
+        n += nb;
+    }
+
+    /// Number of independent samples: paths, or antithetic pairs
+    double samples() const { return n; }
+
+    ControlVariateResult result() const {
+        if (n < 3)
+            throw std::runtime_error("ControlVariate: at least three samples are required");
+
+        const bool controlled = m_xx > 0;
+        const double beta = controlled ? m_xy / m_xx : 0.;
+        // residual variance of Y - beta X, one more degree of freedom being spent on beta
+        const double var = std::max(m_yy - beta * m_xy, 0.) / (controlled ? n - 2 : n - 1);
+        const double path_var = m_path / (n_paths - 1);
+
+        ControlVariateResult result{};
+        result.price = mean_y - beta * (mean_x - control_mean);
+        result.std_error = std::sqrt(var / n);
+        result.beta = beta;
+        result.plain_price = mean_path;
+        result.plain_std_error = std::sqrt(path_var / n_paths);
+        result.variance_reduction = (var > 0) ? path_var / (var * n_paths / n)
+                                              : std::numeric_limits<double>::infinity();
+        return result;
+    }
+
+private:
+    static void merge(double& count, double& mean, double& m2, double nb, double mean_b, double m2_b) {
+        const double delta = mean_b - mean;
+        m2 += m2_b + delta * delta * count * nb / (count + nb);
+        mean += delta * nb / (count + nb);
+        count += nb;
+    }
+};
+
+/**
+ * Prices an American put with the Longstaff-Schwartz method as `price_american_put_lsm`,
+ * using the European put as the control variate of the discounted cashflows of the pricing paths.
+ *
+ * @param european_price Price of the European put with the same strike and maturity
+ *     in the model of the paths, e.g. `price_european_bs(S0, strike, T, rate, sigma, false)`
+ *     for `generate_gbm` paths or `price_european_heston(..., false)` for `generate_heston` paths.
+ * @param antithetic Whether the pricing paths are antithetic pairs.
+ * @return Estimates of the price, see `ControlVariateResult`.
+ */
+ControlVariateResult
+price_american_put_lsm_cv(
+    const torch::Tensor& paths_regression,
+    const torch::Tensor& paths_pricing,
+    double dt,
+    double strike,
+    double rate,
+    double european_price,
+    int64_t reg_poly_degree = 3,
+    bool antithetic = false)
+{
+    if (paths_regression.sizes()[1] != paths_pricing.sizes()[1])
+        throw std::invalid_argument("`paths_regression` and `paths_pricing` must have the same number of time steps");
+
+    const torch::Tensor strike_tensor = torch::tensor(strike, torch::kFloat64);
+    const torch::Tensor rate_tensor = torch::tensor(rate, torch::kFloat64);
+    LSMResult result;
+    {
+        torch::NoGradGuard no_grad;
+        result = _lsm_regression_step(paths_regression, dt, strike_tensor, rate_tensor, reg_poly_degree, false);
+        result = _lsm_pricing_step(paths_pricing, dt, strike_tensor, rate_tensor, reg_poly_degree, result);
+    }
+
+    const int64_t n_steps = paths_pricing.sizes()[1] - 1;
+    const torch::Tensor controls = std::exp(-rate * static_cast<double>(n_steps) * dt) *
+                                   torch::relu(strike - paths_pricing.index({Slice(), -1}));
+    auto estimator = ControlVariate{european_price, antithetic};
+    estimator.update(result.payoffs, controls);
+    return estimator.result();
+}
+
+} // namespace noa::quant
@@ -160,6 +160,14 @@ namespace noa::utils {
             lambda(i, pres[i]);
     }
 
+    /// Parallel loop over [0, n), handing out chunks of grain consecutive indices to the threads
+    template<typename Lambda>
+    inline void pfor(const int64_t n, const Lambda &lambda, const int64_t grain = 1) {
+#pragma omp parallel for schedule(dynamic, grain)
+        for (int64_t i = 0; i < n; i++)
+            lambda(i);
+    }
+
     template<typename Dtype, typename Lambda>
     inline void for_each(const Lambda &lambda, const Tensor &result) {
         for_eachi<Dtype>([&lambda](const int64_t, Dtype &k) { lambda(k); }, result);
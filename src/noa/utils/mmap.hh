@@ -0,0 +1,126 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * \file mmap.hh
+ * Memory mapped files and content hashing
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace noa::utils {
+
+    /// Private (copy on write) memory mapping of a whole file
+    ///
+    /// Pages that are only read stay shared with the page cache, and thus with
+    /// any other process mapping the same file. Written pages are copied.
+    class MappedFile {
+        void *address{nullptr};
+        std::size_t length{0};
+
+        MappedFile(void *address_, std::size_t length_) : address{address_}, length{length_} {}
+
+    public:
+        MappedFile(const MappedFile &other) = delete;
+        MappedFile &operator=(const MappedFile &other) = delete;
+
+        MappedFile(MappedFile &&other) noexcept : address{other.address}, length{other.length} {
+            other.address = nullptr;
+            other.length = 0;
+        }
+
+        MappedFile &operator=(MappedFile &&other) noexcept {
+            if (this != &other) {
+                unmap();
+                address = other.address;
+                length = other.length;
+                other.address = nullptr;
+                other.length = 0;
+            }
+            return *this;
+        }
+
+        ~MappedFile() { unmap(); }
+
+        inline void *data() const { return address; }
+
+        inline std::size_t size() const { return length; }
+
+        inline static std::optional<MappedFile> map(const std::filesystem::path &path) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                std::cerr << "Failed to open " << path << "\n";
+                return std::nullopt;
+            }
+            struct stat info{};
+            if ((::fstat(fd, &info) != 0) || (info.st_size == 0)) {
+                ::close(fd);
+                std::cerr << "Failed to stat " << path << "\n";
+                return std::nullopt;
+            }
+            const auto length = static_cast<std::size_t>(info.st_size);
+            void *address = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            ::close(fd); // The mapping holds its own reference to the file
+            if (address == MAP_FAILED) {
+                std::cerr << "Failed to map " << path << "\n";
+                return std::nullopt;
+            }
+            return MappedFile{address, length};
+        }
+
+    private:
+        inline void unmap() {
+            if (address != nullptr) ::munmap(address, length);
+            address = nullptr;
+            length = 0;
+        }
+    };
+
+    /// 64 bits FNV-1a hash, chained through \p hash
+    inline uint64_t fnv1a(std::string_view bytes, uint64_t hash = 0xcbf29ce484222325ULL) {
+        for (const auto byte: bytes) {
+            hash ^= static_cast<uint8_t>(byte);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    /// Chain the content of a file into a FNV-1a hash
+    inline std::optional<uint64_t> fnv1a_file(const std::filesystem::path &path, uint64_t hash) {
+        auto stream = std::ifstream{path, std::ios::binary};
+        if (!stream) return std::nullopt;
+        char buffer[1 << 16];
+        while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+            hash = fnv1a(std::string_view{buffer, static_cast<std::size_t>(stream.gcount())}, hash);
+        return hash;
+    }
+
+} // namespace noa::utils
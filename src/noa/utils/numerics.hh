@@ -217,6 +217,45 @@ namespace noa::utils::numerics {
         return std::nullopt;
     }
 
+    // Slopes of the monotone piecewise cubic Hermite interpolant (PCHIP) through n >= 2 nodes
+    // https://doi.org/10.1137/0905021 (Fritsch & Butland, 1984)
+    template<typename Dtype>
+    inline void pchip_slopes(const Dtype *x, const Dtype *y, const int64_t n, Dtype *slopes) {
+        const auto secant = [x, y](const int64_t i) { return (y[i + 1] - y[i]) / (x[i + 1] - x[i]); };
+        if (n == 2) {
+            slopes[0] = slopes[1] = secant(0);
+            return;
+        }
+
+        // Weighted harmonic mean of the secants, zero at extrema
+        for (int64_t i = 1; i < n - 1; i++) {
+            const Dtype h0 = x[i] - x[i - 1], h1 = x[i + 1] - x[i];
+            const Dtype d0 = secant(i - 1), d1 = secant(i);
+            const Dtype w0 = 2 * h1 + h0, w1 = h1 + 2 * h0;
+            slopes[i] = (d0 * d1 > 0) ? (w0 + w1) / (w0 / d0 + w1 / d1) : Dtype{0};
+        }
+
+        // One-sided three points estimates at the ends, limited to preserve the shape
+        const auto end_slope = [](const Dtype h0, const Dtype h1, const Dtype d0, const Dtype d1) {
+            const Dtype d = ((2 * h0 + h1) * d0 - h0 * d1) / (h0 + h1);
+            if (d * d0 <= 0)
+                return Dtype{0};
+            if (d0 * d1 <= 0 && std::abs(d) > std::abs(3 * d0))
+                return 3 * d0;
+            return d;
+        };
+        slopes[0] = end_slope(x[1] - x[0], x[2] - x[1], secant(0), secant(1));
+        slopes[n - 1] = end_slope(x[n - 1] - x[n - 2], x[n - 2] - x[n - 3], secant(n - 2), secant(n - 3));
+    }
+
+    // Cubic Hermite interpolation at t in [0, 1], with slopes m0, m1 scaled by the interval width
+    template<typename Dtype>
+    inline Dtype hermite(const Dtype &t, const Dtype &y0, const Dtype &y1, const Dtype &m0, const Dtype &m1) {
+        const Dtype t2 = t * t, t3 = t2 * t;
+        return (2 * t3 - 3 * t2 + 1) * y0 + (t3 - 2 * t2 + t) * m0 +
+               (-2 * t3 + 3 * t2) * y1 + (t3 - t2) * m1;
+    }
+
     template<typename Dtype, typename Net>
     inline auto regression_log_probability(
             Net &net,
@@ -0,0 +1,156 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * \file random.hh
+ *
+ * References:
+ *     - [Salmon2011] Salmon, J. K., Moraes, M. A., Dror, R. O., & Shaw, D. E. (2011).
+ *       Parallel random numbers: as easy as 1, 2, 3. Proceedings of SC11.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/// Counter-based pseudo random number generation
+namespace noa::utils::random {
+
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    inline constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+    inline constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+    inline constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+    inline constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+    inline constexpr int PHILOX_ROUNDS = 10;
+
+    /// Philox4x32-10 block cipher [Salmon2011]
+    ///
+    /// Maps a 128 bit counter and a 64 bit key to 128 random bits. Any block of
+    /// the stream is obtained in O(1) without generating the preceding ones.
+    inline Counter philox4x32(Counter ctr, Key key) {
+        for (int r = 0; r < PHILOX_ROUNDS; r++) {
+            const uint64_t p0 = uint64_t{PHILOX_M0} * ctr[0];
+            const uint64_t p1 = uint64_t{PHILOX_M1} * ctr[2];
+            ctr = Counter{
+                    uint32_t(p1 >> 32) ^ ctr[1] ^ key[0],
+                    uint32_t(p1),
+                    uint32_t(p0 >> 32) ^ ctr[3] ^ key[1],
+                    uint32_t(p0)};
+            key[0] += PHILOX_W0;
+            key[1] += PHILOX_W1;
+        }
+        return ctr;
+    }
+
+    /// Philox4x32-10 of W counters in place, stored word by word so that the rounds vectorise
+    ///
+    /// Lane i of the result is philox4x32({ctr[0][i], ctr[1][i], ctr[2][i], ctr[3][i]}, key).
+    template<int W>
+    inline void philox4x32(uint32_t (&ctr)[4][W], Key key) {
+        for (int r = 0; r < PHILOX_ROUNDS; r++) {
+#if defined(_OPENMP) || defined(_OPENMP_SIMD)
+#pragma omp simd
+#endif
+            for (int i = 0; i < W; i++) {
+                const uint64_t p0 = uint64_t{PHILOX_M0} * ctr[0][i];
+                const uint64_t p1 = uint64_t{PHILOX_M1} * ctr[2][i];
+                const uint32_t c0 = uint32_t(p1 >> 32) ^ ctr[1][i] ^ key[0];
+                const uint32_t c2 = uint32_t(p0 >> 32) ^ ctr[3][i] ^ key[1];
+                ctr[0][i] = c0;
+                ctr[1][i] = uint32_t(p1);
+                ctr[2][i] = c2;
+                ctr[3][i] = uint32_t(p0);
+            }
+            key[0] += PHILOX_W0;
+            key[1] += PHILOX_W1;
+        }
+    }
+
+    /// Uniform variate in the open interval (0, 1) with 53 bits of resolution
+    inline double uniform01(const uint32_t hi, const uint32_t lo) {
+        constexpr double EPS = 1. / 9007199254740992.; // 2^-53
+        const uint64_t bits = (uint64_t{hi >> 5} << 26) | uint64_t{lo >> 6};
+        return (double(bits) + 0.5) * EPS;
+    }
+
+    /// Reproducible stream of uniform variates keyed by (seed, stream index)
+    ///
+    /// The n-th draw of a stream depends on (seed, stream, n) only. Streams are
+    /// typically indexed by the primary particle, so that any history can be
+    /// replayed independently of the order of execution or the number of threads.
+    class CounterStream {
+        Key key{};
+        uint64_t stream{0};
+        uint64_t block{0};
+        Counter buffer{};
+        int position{4};
+
+    public:
+        CounterStream() = default;
+
+        explicit CounterStream(const uint64_t seed, const uint64_t stream_index = 0)
+                : key{uint32_t(seed), uint32_t(seed >> 32)}, stream{stream_index} {}
+
+        inline uint64_t seed() const {
+            return (uint64_t{key[1]} << 32) | key[0];
+        }
+
+        inline uint64_t index() const { return stream; }
+
+        /// Number of variates drawn since the last reset
+        inline uint64_t draws() const { return 2 * block - (4 - position) / 2; }
+
+        /// Rewind to the beginning of the given stream
+        inline void reset(const uint64_t stream_index) {
+            stream = stream_index;
+            block = 0;
+            position = 4;
+        }
+
+        /// Move to the n-th variate of the current stream in O(1)
+        inline void skip_to(const uint64_t n) {
+            block = n / 2;
+            position = 4;
+            if (n % 2) {
+                refill();
+                position = 2;
+            }
+        }
+
+        inline double operator()() {
+            if (position == 4) refill();
+            const double u = uniform01(buffer[position], buffer[position + 1]);
+            position += 2;
+            return u;
+        }
+
+    private:
+        inline void refill() {
+            buffer = philox4x32(
+                    Counter{uint32_t(block), uint32_t(block >> 32), uint32_t(stream), uint32_t(stream >> 32)},
+                    key);
+            block++;
+            position = 0;
+        }
+    };
+
+} // namespace noa::utils::random
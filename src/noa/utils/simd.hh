@@ -0,0 +1,360 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * \file simd.hh
+ * Portable fixed width SIMD packs
+ *
+ * Every operation is a short loop over the lanes that compilers turn into
+ * vector instructions. Transcendental functions are branch-free polynomial
+ * approximations, so that they vectorise as well without a vector math library.
+ *
+ * References:
+ *     - [Moshier1989] Moshier, S. L. (1989). Methods and programs for mathematical
+ *       functions. Ellis Horwood. (Cephes Math Library)
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__AVX512F__)
+#define NOA_SIMD_BYTES 64
+#else
+#define NOA_SIMD_BYTES 32
+#endif
+
+#if defined(_OPENMP) || defined(_OPENMP_SIMD)
+#define NOA_SIMD_LOOP _Pragma("omp simd")
+#else
+#define NOA_SIMD_LOOP
+#endif
+
+namespace noa::utils::simd {
+
+    /// Number of lanes of type T filling a native vector register
+    template<typename T>
+    inline constexpr int native_width = NOA_SIMD_BYTES / sizeof(T);
+
+    /// Reinterprets the bits of a value (bit_cast, also available to C++17 CUDA builds)
+    template<typename To, typename From>
+    inline To bit_cast(const From &from) {
+        static_assert(sizeof(To) == sizeof(From));
+        To to;
+        std::memcpy(&to, &from, sizeof(to));
+        return to;
+    }
+
+    /// Lane mask, stored as integers of the width of the masked lanes so that selects become blends
+    template<typename T, int W>
+    struct Mask {
+        using Bits = std::conditional_t<sizeof(T) == 8, int64_t, int32_t>;
+
+        Bits lane[W];
+
+        inline bool any() const {
+            Bits res = 0;
+            for (int i = 0; i < W; i++) res |= lane[i];
+            return res != 0;
+        }
+
+        inline bool all() const {
+            Bits res = -1;
+            for (int i = 0; i < W; i++) res &= lane[i];
+            return res != 0;
+        }
+
+        inline Mask operator!() const {
+            Mask res;
+            NOA_SIMD_LOOP
+            for (int i = 0; i < W; i++) res.lane[i] = ~lane[i];
+            return res;
+        }
+
+        inline friend Mask operator&(const Mask &a, const Mask &b) {
+            Mask res;
+            NOA_SIMD_LOOP
+            for (int i = 0; i < W; i++) res.lane[i] = a.lane[i] & b.lane[i];
+            return res;
+        }
+
+        inline friend Mask operator|(const Mask &a, const Mask &b) {
+            Mask res;
+            NOA_SIMD_LOOP
+            for (int i = 0; i < W; i++) res.lane[i] = a.lane[i] | b.lane[i];
+            return res;
+        }
+    };
+
+    /// W lanes of a floating point type T
+    template<typename T, int W = native_width<T>>
+    struct alignas(W * sizeof(T)) Pack {
+        static_assert(std::is_floating_point_v<T>);
+        static constexpr int width = W;
+        using value_type = T;
+        using mask_type = Mask<T, W>;
+
+        T lane[W];
+
+        Pack() = default;
+
+        inline Pack(const T value) {
+            NOA_SIMD_LOOP
+            for (int i = 0; i < W; i++) lane[i] = value;
+        }
+
+        template<typename U, typename = std::enable_if_t<std::is_arithmetic_v<U> && !std::is_same_v<U, T>>>
+        inline Pack(const U value) : Pack(static_cast<T>(value)) {}
+
+        /// Loads n <= W values, the remaining lanes repeat the last one
+        inline static Pack load(const T *data, const int n = W) {
+            Pack res;
+            for (int i = 0; i < W; i++) res.lane[i] = data[(i < n) ? i : n - 1];
+            return res;
+        }
+
+        /// Stores the first n <= W lanes
+        inline void store(T *data, const int n = W) const {
+            for (int i = 0; i < n; i++) data[i] = lane[i];
+        }
+
+        inline T operator[](const int i) const { return lane[i]; }
+
+        inline T &operator[](const int i) { return lane[i]; }
+
+        inline Pack operator-() const {
+            Pack res;
+            NOA_SIMD_LOOP
+            for (int i = 0; i < W; i++) res.lane[i] = -lane[i];
+            return res;
+        }
+
+#define NOA_SIMD_ARITHMETIC(OP)                                              \
+        inline friend Pack operator OP(const Pack &a, const Pack &b) {       \
+            Pack res;                                                        \
+            NOA_SIMD_LOOP                                                    \
+            for (int i = 0; i < W; i++) res.lane[i] = a.lane[i] OP b.lane[i]; \
+            return res;                                                      \
+        }                                                                    \
+        inline Pack &operator OP##=(const Pack &b) { return *this = *this OP b; }
+
+        NOA_SIMD_ARITHMETIC(+)
+        NOA_SIMD_ARITHMETIC(-)
+        NOA_SIMD_ARITHMETIC(*)
+        NOA_SIMD_ARITHMETIC(/)
+#undef NOA_SIMD_ARITHMETIC
+
+#define NOA_SIMD_COMPARISON(OP)                                              \
+        inline friend Mask<T, W> operator OP(const Pack &a, const Pack &b) { \
+            Mask<T, W> res;                                                  \
+            NOA_SIMD_LOOP                                                    \
+            for (int i = 0; i < W; i++) res.lane[i] = -(a.lane[i] OP b.lane[i]); \
+            return res;                                                      \
+        }
+
+        NOA_SIMD_COMPARISON(<)
+        NOA_SIMD_COMPARISON(<=)
+        NOA_SIMD_COMPARISON(>)
+        NOA_SIMD_COMPARISON(>=)
+        NOA_SIMD_COMPARISON(==)
+#undef NOA_SIMD_COMPARISON
+    };
+
+    /// Lane-wise conversion to another precision, keeping the number of lanes
+    template<typename To, typename T, int W>
+    inline Pack<To, W> convert(const Pack<T, W> &x) {
+        Pack<To, W> res;
+        NOA_SIMD_LOOP
+        for (int i = 0; i < W; i++) res.lane[i] = static_cast<To>(x.lane[i]);
+        return res;
+    }
+
+    template<typename T, int W>
+    inline Pack<T, W> select(const Mask<T, W> &mask, const Pack<T, W> &a, const Pack<T, W> &b) {
+        Pack<T, W> res;
+        NOA_SIMD_LOOP
+        for (int i = 0; i < W; i++) res.lane[i] = (mask.lane[i] != 0) ? a.lane[i] : b.lane[i];
+        return res;
+    }
+
+    template<typename T>
+    inline T select(const bool mask, const T &a, const T &b) { return mask ? a : b; }
+
+    template<typename T, int W>
+    inline Pack<T, W> max(const Pack<T, W> &a, const Pack<T, W> &b) { return select(a < b, b, a); }
+
+    template<typename T, int W>
+    inline Pack<T, W> min(const Pack<T, W> &a, const Pack<T, W> &b) { return select(b < a, b, a); }
+
+    template<typename T, int W>
+    inline Pack<T, W> sqrt(const Pack<T, W> &x) {
+        Pack<T, W> res;
+        NOA_SIMD_LOOP
+        for (int i = 0; i < W; i++) res.lane[i] = std::sqrt(x.lane[i]);
+        return res;
+    }
+
+    template<typename T, int W>
+    inline Pack<T, W> floor(const Pack<T, W> &x) {
+        Pack<T, W> res;
+        NOA_SIMD_LOOP
+        for (int i = 0; i < W; i++) res.lane[i] = std::floor(x.lane[i]);
+        return res;
+    }
+
+    /// Natural logarithm [Moshier1989], for positive normal numbers
+    template<int W>
+    inline Pack<double, W> log(const Pack<double, W> &x) {
+        constexpr double SQRTH = 0.70710678118654752440;
+        constexpr double P0 = 1.01875663804580931796E-4, P1 = 4.97494994976747001425E-1,
+                P2 = 4.70579119878881725854E0, P3 = 1.44989225341610930846E1,
+                P4 = 1.79368678507819816313E1, P5 = 7.70838733755885391666E0;
+        constexpr double Q0 = 1.12873587189167450590E1, Q1 = 4.52279145837532221105E1,
+                Q2 = 8.29875266912776603211E1, Q3 = 7.11544750618563894466E1,
+                Q4 = 2.31251620126765340583E1;
+
+        Pack<double, W> res;
+        NOA_SIMD_LOOP
+        for (int i = 0; i < W; i++) {
+            // x = m * 2^e with m in [0.5, 1), the exponent is converted through the mantissa of 2^52
+            const auto bits = bit_cast<uint64_t>(x.lane[i]);
+            const double m = bit_cast<double>((bits & 0x800fffffffffffffULL) | 0x3fe0000000000000ULL);
+            double e = bit_cast<double>(((bits >> 52) & 0x7ff) | 0x4330000000000000ULL) -
+                       (4503599627370496. + 1022.);
+
+            const bool low = m < SQRTH;
+            e = low ? e - 1. : e;
+            const double y = low ? m + m - 1. : m - 1.;
+
+            const double z = y * y;
+            const double p = ((((P0 * y + P1) * y + P2) * y + P3) * y + P4) * y + P5;
+            const double q = ((((y + Q0) * y + Q1) * y + Q2) * y + Q3) * y + Q4;
+            double r = y * z * p / q;
+            r -= e * 2.121944400546905827679E-4;
+            r -= 0.5 * z;
+            res.lane[i] = y + r + e * 0.693359375;
+        }
+        return res;
+    }
+
+    /// Exponential [Moshier1989], saturating outside of the double range
+    template<int W>
+    inline Pack<double, W> exp(const Pack<double, W> &x) {
+        constexpr double LOG2E = 1.4426950408889634073599;
+        constexpr double C1 = 6.93145751953125E-1, C2 = 1.42860682030941723212E-6;
+        constexpr double P0 = 1.26177193074810590878E-4, P1 = 3.02994407707441961300E-2,
+                P2 = 9.99999999999999999910E-1;
+        constexpr double Q0 = 3.00198505138664455042E-6, Q1 = 2.52448340349684104192E-3,
+                Q2 = 2.27265548208155028766E-1, Q3 = 2.00000000000000000009E0;
+
+        Pack<double, W> res;
+        NOA_SIMD_LOOP
+        for (int i = 0; i < W; i++) {
+            double v = x.lane[i];
+            v = (v > 708.) ? 708. : v;
+            v = (v < -708.) ? -708. : v;
+
+            // exp(v) = 2^n exp(r) with |r| <= ln(2) / 2, n rounded through the mantissa of 1.5 * 2^52
+            constexpr double ROUND = 6755399441055744.;
+            const double shifted = LOG2E * v + ROUND;
+            const double n = shifted - ROUND;
+            double r = v - n * C1;
+            r -= n * C2;
+            const double rr = r * r;
+            const double p = r * ((P0 * rr + P1) * rr + P2);
+            const double q = ((Q0 * rr + Q1) * rr + Q2) * rr + Q3;
+            const double er = 1. + 2. * p / (q - p);
+
+            const double scale = bit_cast<double>((bit_cast<uint64_t>(shifted) + 1023) << 52);
+            res.lane[i] = er * scale;
+        }
+        return res;
+    }
+
+    /// Natural logarithm [Moshier1989], single precision, for positive normal numbers
+    template<int W>
+    inline Pack<float, W> log(const Pack<float, W> &x) {
+        constexpr float SQRTHF = 0.707106781186547524f;
+
+        Pack<float, W> res;
+        NOA_SIMD_LOOP
+        for (int i = 0; i < W; i++) {
+            // x = m * 2^e with m in [0.5, 1), the exponent is converted through the mantissa of 2^23
+            const auto bits = bit_cast<uint32_t>(x.lane[i]);
+            const float m = bit_cast<float>((bits & 0x807fffffU) | 0x3f000000U);
+            float e = bit_cast<float>(((bits >> 23) & 0xff) | 0x4b000000U) - (8388608.f + 126.f);
+
+            const bool low = m < SQRTHF;
+            e = low ? e - 1.f : e;
+            const float y = low ? m + m - 1.f : m - 1.f;
+
+            const float z = y * y;
+            float r = ((((((((7.0376836292E-2f * y - 1.1514610310E-1f) * y + 1.1676998740E-1f) * y -
+                            1.2420140846E-1f) * y + 1.4249322787E-1f) * y - 1.6668057665E-1f) * y +
+                         2.0000714765E-1f) * y - 2.4999993993E-1f) * y + 3.3333331174E-1f) * y * z;
+            r -= e * 2.12194440E-4f;
+            r -= 0.5f * z;
+            res.lane[i] = y + r + e * 0.693359375f;
+        }
+        return res;
+    }
+
+    /// Exponential [Moshier1989], single precision, saturating outside of the normal range
+    template<int W>
+    inline Pack<float, W> exp(const Pack<float, W> &x) {
+        constexpr float LOG2EF = 1.44269504088896341f;
+
+        Pack<float, W> res;
+        NOA_SIMD_LOOP
+        for (int i = 0; i < W; i++) {
+            float v = x.lane[i];
+            v = (v > 87.f) ? 87.f : v;
+            v = (v < -87.f) ? -87.f : v;
+
+            // exp(v) = 2^n exp(r) with |r| <= ln(2) / 2, n rounded through the mantissa of 1.5 * 2^23
+            constexpr float ROUND = 12582912.f;
+            const float shifted = LOG2EF * v + ROUND;
+            const float n = shifted - ROUND;
+            float r = v - n * 0.693359375f;
+            r += n * 2.12194440E-4f;
+            const float z = r * r;
+            const float er = (((((1.9875691500E-4f * r + 1.3981999507E-3f) * r + 8.3334519073E-3f) * r +
+                                4.1665795894E-2f) * r + 1.6666665459E-1f) * r + 5.0000001201E-1f) * z + r + 1.f;
+
+            const float scale = bit_cast<float>((bit_cast<uint32_t>(shifted) + 127) << 23);
+            res.lane[i] = er * scale;
+        }
+        return res;
+    }
+
+    /// Power for positive bases
+    template<typename T, int W>
+    inline Pack<T, W> pow(const Pack<T, W> &x, const Pack<T, W> &y) {
+        return exp(y * log(x));
+    }
+
+    template<typename T, int W>
+    inline Pack<T, W> log10(const Pack<T, W> &x) {
+        return log(x) * T(0.43429448190325182765);
+    }
+
+} // namespace noa::utils::simd
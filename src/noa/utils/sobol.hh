@@ -0,0 +1,148 @@
+/*****************************************************************************
+ *   Copyright (c) 2023, Roland Grinis, GrinisRIT ltd.                       *
+ *   (roland.grinis@grinisrit.com)                                           *
+ *   All rights reserved.                                                    *
+ *   See the file COPYING for full copying permissions.                      *
+ *                                                                           *
+ *   This program is free software: you can redistribute it and/or modify    *
+ *   it under the terms of the GNU General Public License as published by    *
+ *   the Free Software Foundation, either version 3 of the License, or       *
+ *   (at your option) any later version.                                     *
+ *                                                                           *
+ *   This program is distributed in the hope that it will be useful,         *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the            *
+ *   GNU General Public License for more details.                            *
+ *                                                                           *
+ *   You should have received a copy of the GNU General Public License       *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.   *
+ *****************************************************************************/
+/**
+ * \file sobol.hh
+ * Owen scrambled Sobol sequences for quasi-Monte Carlo
+ *
+ * Points are computed from their index, without the Gray code recursion, so that any
+ * range of points can be generated in parallel.
+ *
+ * References:
+ *     - [JoeKuo2008] Joe, S., & Kuo, F. Y. (2008). Constructing Sobol sequences with
+ *       better two-dimensional projections. SIAM Journal on Scientific Computing, 30(5), 2635-2654.
+ *     - [Owen1995] Owen, A. B. (1995). Randomly permuted (t, m, s)-nets and (t, s)-sequences.
+ *       Monte Carlo and Quasi-Monte Carlo Methods in Scientific Computing, 299-317.
+ *     - [Burley2020] Burley, B. (2020). Practical hash-based Owen scrambling.
+ *       Journal of Computer Graphics Techniques, 9(4), 1-20.
+ */
+
+#pragma once
+
+#include "noa/utils/random.hh"
+#include "noa/utils/sobol_directions.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace noa::utils::sobol {
+
+    /// Resolution of the points
+    inline constexpr int BITS = 32;
+
+    /// Number of dimensions with direction numbers [JoeKuo2008]
+    inline constexpr int64_t MAX_DIMENSION = 1 + sizeof(POLYNOMIALS) / sizeof(Polynomial);
+
+    /// Direction numbers v_1, ..., v_BITS of a dimension, as 32 bit fixed point values
+    inline std::vector<uint32_t> directions(const int64_t dim) {
+        auto v = std::vector<uint32_t>(BITS);
+        if (dim == 0) {
+            for (int i = 0; i < BITS; i++) v[i] = uint32_t{1} << (BITS - 1 - i);
+            return v;
+        }
+
+        const Polynomial &polynomial = POLYNOMIALS[dim - 1];
+        int degree = 0;
+        while (polynomial.bits >> (degree + 1)) degree++;
+
+        auto m = std::vector<uint32_t>(BITS);
+        for (int i = 0; i < degree; i++) m[i] = polynomial.m[i];
+        // m_i = 2 a_1 m_{i-1} ^ 4 a_2 m_{i-2} ^ ... ^ 2^s m_{i-s} ^ m_{i-s}, a_k the inner coefficients
+        for (int i = degree; i < BITS; i++) {
+            m[i] = m[i - degree] ^ (m[i - degree] << degree);
+            for (int k = 1; k < degree; k++)
+                if ((polynomial.bits >> (degree - k)) & 1) m[i] ^= m[i - k] << k;
+        }
+        for (int i = 0; i < BITS; i++) v[i] = m[i] << (BITS - 1 - i);
+        return v;
+    }
+
+    inline uint32_t reverse_bits(uint32_t x) {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    /// Owen's nested uniform scrambling of a 32 bit fixed point value [Owen1995],
+    /// with the hash of Laine and Karras applied to the reversed bits [Burley2020]
+    inline uint32_t nested_uniform_scramble(uint32_t x, const uint32_t seed) {
+        x = reverse_bits(x);
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return reverse_bits(x);
+    }
+
+    /// Owen scrambled Sobol sequence in n_dims dimensions
+    ///
+    /// Each dimension is scrambled independently, with a seed derived from (seed, dimension).
+    /// Dimensions beyond MAX_DIMENSION are padded with the Philox stream of the point,
+    /// which is how the least important coordinates are usually handled in finance.
+    /// The sequence has 2^32 points.
+    class ScrambledSobol {
+        int64_t n_dims;
+        random::Key key;
+        std::vector<uint32_t> v;     // [min(n_dims, MAX_DIMENSION), BITS]
+        std::vector<uint32_t> seeds; // [min(n_dims, MAX_DIMENSION)]
+
+    public:
+        ScrambledSobol(const int64_t n_dims_, const uint64_t seed)
+                : n_dims{n_dims_}, key{uint32_t(seed), uint32_t(seed >> 32)} {
+            if (n_dims < 1)
+                throw std::invalid_argument("ScrambledSobol: at least one dimension is required");
+            const int64_t n_sobol = std::min(n_dims, MAX_DIMENSION);
+            v.reserve(n_sobol * BITS);
+            seeds.reserve(n_sobol);
+            for (int64_t dim = 0; dim < n_sobol; dim++) {
+                const auto dim_v = directions(dim);
+                v.insert(v.end(), dim_v.begin(), dim_v.end());
+                seeds.push_back(random::philox4x32(random::Counter{uint32_t(dim), 0, 0, 0}, key)[0]);
+            }
+        }
+
+        inline int64_t get_dimensions() const { return n_dims; }
+
+        /// Coordinate of the point without scrambling, as a 32 bit fixed point value
+        inline uint32_t unscrambled(const uint32_t index, const int64_t dim) const {
+            const uint32_t *dim_v = v.data() + dim * BITS;
+            uint32_t x = 0;
+            for (int i = 0; i < BITS && (index >> i); i++)
+                if ((index >> i) & 1) x ^= dim_v[i];
+            return x;
+        }
+
+        /// Coordinate of the point, in the open interval (0, 1)
+        inline double operator()(const uint32_t index, const int64_t dim) const {
+            if (dim >= MAX_DIMENSION) {
+                const auto bits = random::philox4x32(
+                        random::Counter{index, 0, uint32_t(dim), uint32_t(dim >> 32) | 0x80000000u}, key);
+                return random::uniform01(bits[0], bits[1]);
+            }
+            const uint32_t x = nested_uniform_scramble(unscrambled(index, dim), seeds[dim]);
+            return (double(x) + 0.5) / 4294967296.;
+        }
+    };
+
+} // namespace noa::utils::sobol
@@ -6,6 +6,7 @@
 // NOA kernels (PUMAS and tinyxml)
 #define NOA_3RDPARTY_PUMAS
 #include <noa/kernels.hh>
+#include <noa/pms/tracks.hh>
 
 // Local headers
 #include "particleworld.hh"
@@ -27,7 +28,9 @@ DEFINE_double(rock_thickness, doubleNaN, "Rock layer thickness (only without the
 DEFINE_string(dump_file, "materials.pumas", "Pre-computed PUMAS materials model");
 DEFINE_string(materials_dir, "pumas-materials", "Path to PUMAS materials data directory");
 DEFINE_string(mesh, "", "Path to rock mesh (leave empty for a simulation with no mesh)");
-DEFINE_string(track_dump, "", "Path to particle track dump");
+DEFINE_string(track_dump, "", "Path to binary particle track dump (see util/drawtracks.py)");
+DEFINE_int64(seed, -1, "Seed for counter-based random streams keyed by primary index (negative for the default PUMAS generator)");
+DEFINE_bool(batch, false, "Transport all the primaries together, in waves, from a structure-of-arrays particle bank");
 DEFINE_bool(create_dump, false, "If possible, create a pre-computed PUMAS materials model when one is not available");
 
 // Namespaces
@@ -74,6 +77,7 @@ int main(int argc, char* argv[]) {
 	auto& context = world.get_context();
 	context->mode.direction = pms::pumas::PUMAS_MODE_BACKWARD;
 	context->event = (pms::pumas::Event) ((int)context->event | pms::pumas::PUMAS_EVENT_LIMIT_ENERGY);
+	if (FLAGS_seed >= 0) context.set_random_seed(FLAGS_seed);
 
 	// Set up materials used and their properties
 	const auto& model = world.get_model();
@@ -210,8 +214,12 @@ int main(int argc, char* argv[]) {
 
 	// Mote-Carlo simulation
 	// Open a file to dump particle trajectories
-	std::ofstream particles;
-	if (FLAGS_track_dump != "") particles.open(FLAGS_track_dump);
+	std::optional<pms::tracks::TrackRecorder> recorder;
+	std::optional<pms::tracks::TrackRecorder::Writer> tracks;
+	if (FLAGS_track_dump != "") {
+		recorder.emplace(FLAGS_track_dump);
+		tracks.emplace(recorder->writer());
+	}
 	// Rewrite of PUMAS' geometry.c code:
 	// https://github.com/niess/pumas/blob/master/examples/pumas/geometry.c
 	const double cos_theta = cos((90. - FLAGS_elevation) / 180. * M_PI);
@@ -219,10 +227,39 @@ int main(int argc, char* argv[]) {
 	const double rk = log(FLAGS_kenergy_max / FLAGS_kenergy_min);
 	double w = 0., w2 = 0.;
 	constexpr int n = 10000;
+	const double energyThreshold = FLAGS_kenergy_max * 1e3;
+
+	// Transport modes depend on the current energy of the muon
+	const auto set_modes = [&context, energyThreshold] (double energy) {
+		if (energy < 1e2 - numeric_limits<float>::epsilon()) {
+			context->mode.energy_loss = pms::pumas::PUMAS_MODE_STRAGGLED;
+			context->mode.scattering = pms::pumas::PUMAS_MODE_MIXED;
+			context->limit.energy = 1e2;
+		} else {
+			context->mode.energy_loss = pms::pumas::PUMAS_MODE_MIXED;
+			context->mode.scattering = pms::pumas::PUMAS_MODE_DISABLED;
+			context->limit.energy = energyThreshold;
+		}
+	};
+	// Score a muon that reached the primary altitude
+	const auto score = [&w, &w2] (const pms::pumas::pumas_state& state) {
+		if (state.position[2] >= primary_altitude - numeric_limits<double>::epsilon()) {
+			if (state.position[2] > primary_altitude * 1.1)
+				cout << " Out of bounds by a lot!" << endl;
+			const double wi = state.weight * pms::pumas::flux_gccly(-state.direction[2], state.energy, state.charge);
+			w += wi;
+			w2 += wi * wi;
+		}
+	};
+
+	pms::pumas::ParticleBank bank{};
+	if (FLAGS_batch) bank.reserve(n);
+
 	for (int i = 0; i < n; ++i) {
 		cout << "\rSimulating " << i;
 		cout.flush();
-		if (particles.is_open()) particles << "particle " << i << endl;
+		// Each primary draws from its own stream, so its history can be replayed alone
+		if (FLAGS_seed >= 0) context.set_primary(i);
 		// Set the muon final state
 		double kf, wf;
 		if (rk) {
@@ -245,38 +282,24 @@ int main(int argc, char* argv[]) {
 		state->direction[2] = -cos_theta;
 
 		// Simulate muon trajectory with PUMAS
-		const double energyThreshold = FLAGS_kenergy_max * 1e3;
-		if (particles.is_open()) particles <<	state->position[0] << ", " <<
-							state->position[1] << ", " <<
-							state->position[2] << endl;
+		if (tracks) tracks->record(i, state.get(), -1, pms::pumas::PUMAS_EVENT_NONE);
+
+		if (FLAGS_batch) {
+			// Deferred to the waves below, resuming the primary's stream after the draws above
+			const auto k = bank.add(i, state.get());
+			if (FLAGS_seed >= 0) bank.draws[k] = context.random_stream().draws();
+			continue;
+		}
 
 		while (state->energy < energyThreshold - numeric_limits<float>::epsilon()) {
-			if (state->energy < 1e2 - numeric_limits<float>::epsilon()) {
-				context->mode.energy_loss = pms::pumas::PUMAS_MODE_STRAGGLED;
-				context->mode.scattering = pms::pumas::PUMAS_MODE_MIXED;
-				context->limit.energy = 1e2;
-			} else {
-				context->mode.energy_loss = pms::pumas::PUMAS_MODE_MIXED;
-				context->mode.scattering = pms::pumas::PUMAS_MODE_DISABLED;
-				context->limit.energy = energyThreshold;
-			}
+			set_modes(state->energy);
 
 			pms::pumas::Medium* medium[2];
 			pms::pumas::Event event = context.do_transport(state, medium);
-			if (particles.is_open()) particles <<	state->position[0] << ", " <<
-								state->position[1] << ", " <<
-								state->position[2] << endl;
+			if (tracks) tracks->record(i, state.get(), (medium[1] == nullptr) ? -1 : medium[1]->material, event);
 
 			if ((event == pms::pumas::PUMAS_EVENT_MEDIUM) && (medium[1] == nullptr)) {
-				if (state->position[2] >= primary_altitude - numeric_limits<double>::epsilon()) {
-					if (state->position[2] > primary_altitude * 1.1) {
-						cout << " Out of bounds by a lot!" << endl;
-						cout << "cf = " << cf << "; kf = " << kf << "; wf = " << wf << endl;
-					}
-					const double wi = state->weight * pms::pumas::flux_gccly(-state->direction[2], state->energy, state->charge);
-					w += wi;
-					w2 += wi * wi;
-				}
+				score(state.get());
 				break;
 			} else if (event != pms::pumas::PUMAS_EVENT_LIMIT_ENERGY) {
 				cerr << "Error: unexpected PUMAS event " << event << endl;
@@ -285,7 +308,39 @@ int main(int argc, char* argv[]) {
 		}
 	}
 	cout << endl;
-	if (particles.is_open()) particles.close();
+
+	// Wave transport: every wave locates all the muons still alive at once, then moves them to their next event
+	auto wave_state = context.create_state();
+	for (std::size_t wave = 0; !bank.active.empty(); ++wave) {
+		cout << "\rWave " << wave << ": " << bank.active.size() << " muons";
+		cout.flush();
+		context.transport_wave(bank, [&set_modes] (pms::pumas::Context&, pms::pumas::State& state, std::size_t) {
+			set_modes(state->energy);
+		});
+
+		bool failure = false;
+		bank.retain([&] (std::size_t i) {
+			const auto event = bank.event[i];
+			const auto* medium = bank.medium[i];
+			bank.load(i, wave_state.get());
+			if (tracks) tracks->record(bank.primary[i], wave_state.get(), (medium == nullptr) ? -1 : medium->material, event);
+
+			if ((event == pms::pumas::PUMAS_EVENT_MEDIUM) && (medium == nullptr)) {
+				score(wave_state.get());
+				return false;
+			} else if (event != pms::pumas::PUMAS_EVENT_LIMIT_ENERGY) {
+				cerr << "Error: unexpected PUMAS event " << event << endl;
+				failure = true;
+				return false;
+			}
+			return wave_state->energy < energyThreshold - numeric_limits<float>::epsilon();
+		});
+		if (failure) return EXIT_FAILURE;
+	}
+	if (FLAGS_batch) cout << endl;
+
+	tracks.reset();
+	if (recorder) recorder->close();
 
 	// Print the calculation result
 	w /= n;
@@ -29,10 +29,44 @@ class ParticleWorld {
         using LocalsCbFunc =    pumas::LocalsCbFunc;
         using ContextOpt =      std::optional<pumas::Context>;
         using Tracer =          trace::Tracer<TNL::Devices::Host>;
+        using BoundingBox =     typename Tracer::BoundingBox;
         
         private:
         // World domains
         std::vector<DomainType> domains{};
+        // Domain bounding boxes, refreshed when the domains could have changed
+        std::vector<BoundingBox> bounds{};
+        bool bounds_outdated = true;
+
+        void update_bounds() {
+                if (!bounds_outdated) return;
+                bounds.clear();
+                for (const auto& domain : domains) {
+                        if (domain.isClean()) {
+                                // Empty domain: an inverted box, that contains nothing
+                                BoundingBox box;
+                                box.lower = std::numeric_limits<Real>::max();
+                                box.upper = std::numeric_limits<Real>::lowest();
+                                bounds.push_back(box);
+                        } else {
+                                bounds.push_back(Tracer::get_bounding_box(&domain.getMesh()));
+                        }
+                }
+                bounds_outdated = false;
+        }
+
+        // Distance along the direction to the nearest bounding box that
+        // does not contain the location, none if there is no such box on the way
+        std::optional<Real> next_domain_entry(const PointType& loc, const PointType& dir) {
+                update_bounds();
+                std::optional<Real> nearest{};
+                for (const auto& box : bounds) {
+                        const auto distance = box.get_entry_distance(loc, dir);
+                        if (distance <= 0) continue;
+                        if (!nearest.has_value() || (distance < nearest.value())) nearest = distance;
+                }
+                return nearest;
+        }
 
         ModelOpt model{};
         ContextOpt context{};
@@ -57,7 +91,8 @@ class ParticleWorld {
                         const auto mdf_file = materials_path / "mdf" / "examples" / "standard.xml";
                         const auto dedx_dir = materials_path / "dedx";
 
-                        model = ParticleModel::load_from_mdf(mdf_file, dedx_dir);
+                        // Tables are only rebuilt when the MDF or dE/dX files change
+                        model = ParticleModel::load_cached(mdf_file, dedx_dir, materials_path / "cache");
 
                         if (!model.has_value()) {
                                 throw std::runtime_error("Failed to load physics model from MDF with "
@@ -71,7 +106,7 @@ class ParticleWorld {
                 if (!context.has_value())
                         throw std::runtime_error("Could not create PUMAS context");
 
-                context->medium = [&model = this->model, &environment = this->environment, &domains = this->domains, &medium_layer = this->medium_layer] (pumas::Context* context_p, pumas::State* state_p, pumas::Medium** medium_p, double* step_p) -> pumas::Step {
+                context->medium = [this, &model = this->model, &environment = this->environment, &domains = this->domains, &medium_layer = this->medium_layer] (pumas::Context* context_p, pumas::State* state_p, pumas::Medium** medium_p, double* step_p) -> pumas::Step {
                         if (environment == nullptr)
                                 throw std::runtime_error("Environment medium is unset!");
 
@@ -85,9 +120,11 @@ class ParticleWorld {
                         for (std::size_t i = 0; i < 3; ++i) {
                                 dir[i] = state->direction[i] * context_p->sgn();
                         }
-                        auto speed = std::sqrt(TNL::dot(dir, dir));
-
-                        for (const auto& domain : domains) {
+                        update_bounds();
+                        for (std::size_t d = 0; d < domains.size(); ++d) {
+                                // Meshes are only searched when the particle is in their bounding box
+                                if (!bounds[d].contains(loc)) continue;
+                                const auto& domain = domains[d];
                                 const auto& mesh = domain.getMesh();
                                 constexpr auto dim = domain.getMeshDimension(); // = 3
                                 const auto cells = mesh.template getEntitiesCount<dim>();
@@ -138,7 +175,80 @@ class ParticleWorld {
                                 return pumas::PUMAS_STEP_CHECK;
                         }
 
-                        return environment(context_p, state_p, medium_p, step_p);
+                        const auto step_type = environment(context_p, state_p, medium_p, step_p);
+                        clip_step(step_p, (medium_p == nullptr) || (*medium_p != nullptr), loc, dir);
+                        return step_type;
+                };
+
+                // Same geometry as above, locating a whole wave of particles at once:
+                // domain by domain, so that each mesh is walked over by all the particles in turn
+                context->batch_locate = [this, &model = this->model, &environment = this->environment, &domains = this->domains, &medium_layer = this->medium_layer] (pumas::Context* context_p, const pumas::ParticleBank& bank, pumas::Medium** media, double* steps, pumas::Step* types) {
+                        if (environment == nullptr)
+                                throw std::runtime_error("Environment medium is unset!");
+
+                        const auto n = static_cast<long int>(bank.active.size());
+                        const auto sgn = context_p->sgn();
+                        std::vector<char> resolved(n, false);
+                        bool missed = false;
+
+                        update_bounds();
+                        for (std::size_t d = 0; d < domains.size(); ++d) {
+                                const auto& box = bounds[d];
+                                const auto& domain = domains[d];
+                                if (domain.isClean()) continue;
+                                const auto& mesh = domain.getMesh();
+                                constexpr auto dim = domain.getMeshDimension(); // = 3
+                                const auto cells = mesh.template getEntitiesCount<dim>();
+                                const auto& cell_layers = domain.getLayers(dim);
+                                const auto& medium_layer_data = cell_layers.template get<int>(medium_layer);
+
+                                #pragma omp parallel for reduction(||:missed)
+                                for (long int k = 0; k < n; ++k) {
+                                        if (resolved[k]) continue;
+                                        const auto i = bank.active[k];
+                                        PointType loc{};
+                                        PointType dir{};
+                                        for (std::size_t j = 0; j < 3; ++j) {
+                                                loc[j] = bank.position[j][i];
+                                                dir[j] = bank.direction[j][i] * sgn;
+                                        }
+                                        if (!box.contains(loc)) continue;
+
+                                        const auto t_index = Tracer::get_current_tetrahedron(&mesh, cells, loc);
+                                        if (!t_index.has_value()) continue;
+
+                                        const auto intersect = Tracer::get_first_border_in_tetrahedron(
+                                                                                &mesh,
+                                                                                t_index.value(),
+                                                                                loc, dir,
+                                                                                std::numeric_limits<float>::epsilon());
+                                        if (intersect.distance < 0) missed = true;
+
+                                        media[k] = model->get_medium(medium_layer_data[t_index.value()]);
+                                        steps[k] = intersect.distance + std::numeric_limits<float>::epsilon();
+                                        types[k] = pumas::PUMAS_STEP_CHECK;
+                                        resolved[k] = true;
+                                }
+                        }
+                        if (missed)
+                                throw std::runtime_error("Intersection not found!");
+
+                        // Particles outside of all the domains are left to the environment
+                        auto state = context_p->create_state();
+                        for (long int k = 0; k < n; ++k) {
+                                if (resolved[k]) continue;
+                                const auto i = bank.active[k];
+                                bank.load(i, state.get());
+                                types[k] = environment(context_p, &state, &media[k], &steps[k]);
+
+                                PointType loc{};
+                                PointType dir{};
+                                for (std::size_t j = 0; j < 3; ++j) {
+                                        loc[j] = bank.position[j][i];
+                                        dir[j] = bank.direction[j][i] * sgn;
+                                }
+                                clip_step(&steps[k], media[k] != nullptr, loc, dir);
+                        }
                 };
         }
 
@@ -147,13 +257,38 @@ class ParticleWorld {
         }
 
         DomainType& add_domain() {
+                bounds_outdated = true;
                 domains.emplace_back();
                 return domains.back();
         }
 
-        DomainType& get_domain(const std::size_t& idx) { return domains.at(idx); }
+        DomainType& get_domain(const std::size_t& idx) {
+                bounds_outdated = true;
+                return domains.at(idx);
+        }
         const DomainType& get_domain(const std::size_t& idx) const { return domains.at(idx); }
 
+        // Distance along the direction to the nearest domain bounding box,
+        // 0 if inside one of them, none if the ray misses all of them
+        std::optional<Real> distance_to_domain(const PointType& loc, const PointType& dir) {
+                update_bounds();
+                for (const auto& box : bounds)
+                        if (box.contains(loc)) return Real{};
+                return next_domain_entry(loc, dir);
+        }
+
+        // Clips the environment step, so that the particle stops at the next domain entry.
+        // A step <= 0 is PUMAS' infinite (uniform) medium: it becomes the entry distance,
+        // unless the particle is out of any medium (then PUMAS stops it anyway)
+        void clip_step(double* step_p, bool in_medium, const PointType& loc, const PointType& dir) {
+                if (step_p == nullptr) return;
+                if ((*step_p <= 0) && !in_medium) return;
+                const auto entry = next_domain_entry(loc, dir);
+                if (!entry.has_value()) return;
+                const double clipped = entry.value() + std::numeric_limits<float>::epsilon();
+                if ((*step_p <= 0) || (clipped < *step_p)) *step_p = clipped;
+        }
+
         const ParticleModel&    get_model() const       { return model.value(); }
         pumas::Context&    get_context()           { return context.value(); }
 }; // <-- class ParticleWorld
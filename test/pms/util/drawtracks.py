@@ -5,9 +5,45 @@ import numpy as np
 import matplotlib.pyplot as plt
 from mpl_toolkits.mplot3d import Axes3D
 
+# Binary layout written by noa::pms::tracks::TrackRecorder (see noa/pms/tracks.hh)
+MAGIC = b"NOATRACK"
+VERSION = 1
+COLUMNS = [
+    ("particle", np.uint64),
+    ("x", np.float64), ("y", np.float64), ("z", np.float64),
+    ("ux", np.float64), ("uy", np.float64), ("uz", np.float64),
+    ("energy", np.float64),
+    ("medium", np.int32),
+    ("event", np.int32),
+]
+
+
+def load_tracks(fname):
+    """Reads a binary track dump into a dict of numpy columns"""
+    with open(fname, "rb") as dumpFile:
+        data = dumpFile.read()
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError(f"{fname}: not a NOA track dump")
+    version, _ = np.frombuffer(data, np.uint32, 2, len(MAGIC))
+    if version != VERSION:
+        raise ValueError(f"{fname}: unsupported track dump version {version}")
+
+    chunks = {name: [] for name, _ in COLUMNS}
+    offset = len(MAGIC) + 8
+    while offset < len(data):
+        n = int(np.frombuffer(data, np.uint64, 1, offset)[0])
+        offset += 8
+        for name, dtype in COLUMNS:
+            chunks[name].append(np.frombuffer(data, dtype, n, offset))
+            offset += n * np.dtype(dtype).itemsize
+
+    return {name: np.concatenate(columns) if columns else np.empty(0, dtype)
+            for (name, dtype), columns in zip(COLUMNS, chunks.values())}
+
+
 def main():
     if len(sys.argv) == 1:
-        print(f"Usage: {sys.argv[0]} dump_file_1.txt dump_file_2.txt ...")
+        print(f"Usage: {sys.argv[0]} dump_file_1.bin dump_file_2.bin ...")
         exit(1)
 
     fig = plt.figure(figsize=(4,4))
@@ -17,26 +53,15 @@ def main():
 
     oobCounter = 0
     for fi, fname in enumerate(sys.argv[1:]):
-        with open(fname, "r") as dumpFile:
-            x = []
-            y = []
-            z = []
-            for line in dumpFile.readlines():
-                if "particle " in line:
-                    pnum = int(line.replace("particle ", ""))
-                    if x:
-                        if max(z) > 1e3: oobCounter += 1
-                        ax.plot(x, y, z, color[fi], label=fname)
-                        x = []
-                        y = []
-                        z = []
-                    print(f"\r{pnum}", end="")
-                    # if pnum > 1: break
-                    continue
-                p = line.strip().split(", ")
-                x.append(float(p[0]))
-                y.append(float(p[1]))
-                z.append(float(p[2]))
+        tracks = load_tracks(fname)
+        # Chunks from different threads interleave, a stable sort keeps each track's order
+        order = np.argsort(tracks["particle"], kind="stable")
+        particles, starts = np.unique(tracks["particle"][order], return_index=True)
+        for pnum, idx in zip(particles, np.split(order, starts[1:])):
+            x, y, z = tracks["x"][idx], tracks["y"][idx], tracks["z"][idx]
+            if z.max() > 1e3: oobCounter += 1
+            ax.plot(x, y, z, color[fi % len(color)], label=fname)
+            print(f"\r{pnum}", end="")
 
     print("\nOK")
     print(f"{oobCounter} out of bounds")
@@ -1,6 +1,10 @@
 #include <noa/quant/bsm.hh>
 
+#include <chrono>
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <iostream>
 
 using namespace torch::indexing;
 
@@ -20,5 +24,80 @@ int main(int argc, char* argv[]) {
     auto [stop_line_V, stop_line_S] = noa::quant::find_early_exercise(
             V, S_array, t_array, STRIKE);
 
+    // Fine grid: the time steps are O(npoints_S)
+    int64_t npoints_S_fine = 100'000;
+    int64_t npoints_t_fine = 200;
+    auto start = std::chrono::steady_clock::now();
+    auto [V_fine, S_fine, t_fine] = noa::quant::price_american_put_bs(
+            STRIKE, T, RATE, SIGMA, S_min, S_max, npoints_S_fine, npoints_t_fine);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto at_the_money = [&](const torch::Tensor& V_, const torch::Tensor& S_) {
+        return V_.index({torch::argmin(torch::abs(S_ - STRIKE)), -1}).item<double>();
+    };
+    std::cout << "Price at the money: " << at_the_money(V, S_array) << " (" << npoints_S << " points), "
+              << at_the_money(V_fine, S_fine) << " (" << npoints_S_fine << " points, " << elapsed << " s)"
+              << std::endl;
+
+    // Book of contracts in one call, against one contract at a time
+    int64_t n_contracts = 64;
+    torch::Tensor S0 = torch::linspace(30, 70, n_contracts, torch::kFloat64);
+    torch::Tensor K = torch::full({n_contracts}, STRIKE, torch::kFloat64);
+    torch::Tensor T_book = torch::linspace(0.25, 2, n_contracts, torch::kFloat64);
+    torch::Tensor r = torch::full({n_contracts}, RATE, torch::kFloat64);
+    torch::Tensor sigma = torch::linspace(0.15, 0.45, n_contracts, torch::kFloat64);
+    start = std::chrono::steady_clock::now();
+    auto [prices, stop_S, t_book] = noa::quant::price_american_put_bs_batch(
+            S0, K, T_book, r, sigma, S_min, S_max, npoints_S, npoints_t);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double max_diff = 0;
+    for (int64_t c = 0; c < n_contracts; c += 21) {
+        auto [V_c, S_c, t_c] = noa::quant::price_american_put_bs(
+                STRIKE, T_book[c].item<double>(), RATE, sigma[c].item<double>(), S_min, S_max, npoints_S, npoints_t);
+        auto [stop_V_c, stop_S_c] = noa::quant::find_early_exercise(V_c, S_c, t_c, STRIKE);
+        double S0_c = S0[c].item<double>();
+        int64_t m = torch::searchsorted(S_c, S0[c]).item<int64_t>() - 1;
+        double w = std::log(S0_c / S_c[m].item<double>()) / std::log(S_c[m + 1].item<double>() / S_c[m].item<double>());
+        double price_c = (1 - w) * V_c[m][-1].item<double>() + w * V_c[m + 1][-1].item<double>();
+        max_diff = std::max(max_diff, std::abs(price_c - prices[c].item<double>()));
+        std::cout << "Contract " << c << ": " << prices[c].item<double>() << " (single " << price_c
+                  << "), exercise boundary at t = 0: " << stop_S[c][-1].item<double>()
+                  << " (single " << stop_S_c.back() << ")" << std::endl;
+    }
+    std::cout << n_contracts << " contracts in " << elapsed << " s, max difference " << max_diff << std::endl;
+
+    // Greeks from the adjoint sweep, against bump and reprice
+    double S0_greeks = 45;
+    start = std::chrono::steady_clock::now();
+    auto greeks = noa::quant::price_american_put_bs_greeks(
+            S0_greeks, STRIKE, T, RATE, SIGMA, S_min, S_max, npoints_S, npoints_t);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto reprice = [&](double S0_, double T_, double r_, double sigma_) {
+        return noa::quant::price_american_put_bs_greeks(
+                S0_, STRIKE, T_, r_, sigma_, S_min, S_max, npoints_S, npoints_t).price;
+    };
+    double h = 1e-5;
+    double h_S = 0.5;
+    std::cout << std::endl;
+    std::cout << "Greeks (" << elapsed << " s), bump and reprice in parentheses:" << std::endl;
+    std::cout << "price " << greeks.price << std::endl;
+    std::cout << "delta " << greeks.delta << " ("
+              << (reprice(S0_greeks + h_S, T, RATE, SIGMA) - reprice(S0_greeks - h_S, T, RATE, SIGMA)) / (2 * h_S)
+              << ")" << std::endl;
+    std::cout << "gamma " << greeks.gamma << " ("
+              << (reprice(S0_greeks + h_S, T, RATE, SIGMA) - 2 * greeks.price +
+                  reprice(S0_greeks - h_S, T, RATE, SIGMA)) / (h_S * h_S) << ")" << std::endl;
+    std::cout << "vega  " << greeks.vega << " ("
+              << (reprice(S0_greeks, T, RATE, SIGMA + h) - reprice(S0_greeks, T, RATE, SIGMA - h)) / (2 * h)
+              << ")" << std::endl;
+    std::cout << "rho   " << greeks.rho << " ("
+              << (reprice(S0_greeks, T, RATE + h, SIGMA) - reprice(S0_greeks, T, RATE - h, SIGMA)) / (2 * h)
+              << ")" << std::endl;
+    std::cout << "theta " << greeks.theta << " ("
+              << -(reprice(S0_greeks, T + h, RATE, SIGMA) - reprice(S0_greeks, T - h, RATE, SIGMA)) / (2 * h)
+              << ")" << std::endl;
+
     return 0;
 }
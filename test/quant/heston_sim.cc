@@ -1,5 +1,6 @@
 #include <noa/quant/heston_sim.hh>
 
+#include <chrono>
 #include <cstdint>
 #include <cmath>
 #include <iostream>
@@ -114,11 +115,143 @@ void test_heston() {
     torch::save(var_paths, "var_paths.pt");
 }
 
+void test_fused_heston() {
+    std::cout << "Running functional test of the fused QE kernel" << std::endl;
+    torch::Tensor init_state_var = v0 * torch::ones(n_paths, torch::dtype<double>());
+    torch::Tensor init_state_price = S0 * torch::ones(n_paths, torch::dtype<double>());
+
+    const auto elapsed = [](const auto& start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto start = std::chrono::steady_clock::now();
+    noa::quant::heston_impl::generate_heston_tensor(
+            n_paths, n_steps, dt, init_state_price, init_state_var, kappa, theta, eps, rho, drift);
+    std::cout << "Step by step tensors: " << elapsed(start) << " s" << std::endl;
+    start = std::chrono::steady_clock::now();
+    noa::quant::generate_heston(
+            n_paths, n_steps, dt, init_state_price, init_state_var, kappa, theta, eps, rho, drift);
+    std::cout << "Fused kernel: " << elapsed(start) << " s" << std::endl;
+
+    // Pathwise derivatives of E[S_T] and E[v_T], against central differences with the same seed
+    const int64_t n_greek_steps = 250;
+    torch::Tensor params[5] = {kappa.clone(), theta.clone(), eps.clone(), rho.clone(), init_state_var.clone()};
+    const char* names[5] = {"kappa", "theta", "eps", "rho", "v0"};
+    const auto terminal_mean = [&](const torch::Tensor* p) {
+        torch::Tensor price, var;
+        std::tie(price, var) = noa::quant::generate_heston(
+                n_paths, n_greek_steps, dt, init_state_price, p[4], p[0], p[1], p[2], p[3], drift);
+        return price.index({Slice(), -1}).mean() + var.index({Slice(), -1}).mean();
+    };
+    for (auto& param : params) param.requires_grad_(true);
+    torch::manual_seed(17);
+    terminal_mean(params).backward();
+
+    const double bump = 1e-5;
+    torch::NoGradGuard no_grad;
+    for (int k = 0; k < 5; k++) {
+        torch::Tensor up[5], down[5];
+        for (int j = 0; j < 5; j++) {
+            up[j] = params[j].detach().clone();
+            down[j] = params[j].detach().clone();
+        }
+        up[k] += bump;
+        down[k] -= bump;
+        torch::manual_seed(17);
+        const double f_up = terminal_mean(up).item<double>();
+        torch::manual_seed(17);
+        const double f_down = terminal_mean(down).item<double>();
+        std::cout << names[k] << ". Pathwise: " << params[k].grad().sum().item<double>()
+                  << ", central difference: " << (f_up - f_down) / (2 * bump) << std::endl;
+    }
+}
+void test_stream_heston() {
+    std::cout << "Running functional test of `stream_heston()`" << std::endl;
+    torch::Tensor init_state_var = v0 * torch::ones(n_paths, torch::dtype<double>());
+    torch::Tensor init_state_price = S0 * torch::ones(n_paths, torch::dtype<double>());
+
+    torch::manual_seed(23);
+    torch::Tensor heston_paths, var_paths;
+    std::tie(heston_paths, var_paths) = noa::quant::generate_heston(
+            n_paths, n_steps, dt, init_state_price, init_state_var, kappa, theta, eps, rho, drift);
+    torch::manual_seed(23);
+    torch::Tensor average, terminal_price;
+    std::tie(average, terminal_price) = noa::quant::stream_heston(
+            n_paths, n_steps, dt, init_state_price, init_state_var, kappa, theta, eps, rho, drift,
+            AveragePrice{});
+
+    std::cout << "Asian average. Max difference with the stored paths: "
+              << (average - AveragePrice{}.reduce(heston_paths)).abs().max().item<double>() << std::endl;
+    std::cout << "Terminal price. Max difference with the stored paths: "
+              << (terminal_price - TerminalPrice{}.reduce(heston_paths)).abs().max().item<double>() << std::endl;
+
+    torch::Tensor hit;
+    std::tie(hit, terminal_price) = noa::quant::stream_heston(
+            n_paths, n_steps, dt, init_state_price, init_state_var, kappa, theta, eps, rho, drift,
+            BarrierHit{1.2 * S0.item<double>()});
+    const torch::Tensor up_and_out_call = (1 - hit) * torch::relu(terminal_price - S0);
+    std::cout << "Up-and-out call at the money, barrier 120%: " << up_and_out_call.mean().item<double>() << std::endl;
+}
+void test_heston_sets() {
+    std::cout << "Running functional test of `generate_heston_sets()`" << std::endl;
+    const int64_t n_set_paths = 1000, n_set_steps = 250;
+    torch::Tensor init_state_var = v0 * torch::ones(n_set_paths, torch::dtype<double>());
+    torch::Tensor init_state_price = S0 * torch::ones(n_set_paths, torch::dtype<double>());
+    // positive correlations, for which the regularity condition may bound gamma2
+    torch::Tensor kappas = torch::tensor({0.06, 0.5, 2.0}, torch::kFloat64);
+    torch::Tensor rhos = torch::tensor({-0.6, 0.3, 0.9}, torch::kFloat64);
+
+    torch::manual_seed(29);
+    torch::Tensor price_sets, var_sets;
+    std::tie(price_sets, var_sets) = noa::quant::generate_heston_sets(
+            n_set_paths, n_set_steps, dt, init_state_price, init_state_var,
+            kappas, theta, eps, rhos, drift);
+    for (int64_t k = 0; k < kappas.size(0); k++) {
+        torch::manual_seed(29);
+        torch::Tensor heston_paths, var_paths;
+        std::tie(heston_paths, var_paths) = noa::quant::generate_heston(
+                n_set_paths, n_set_steps, dt, init_state_price, init_state_var,
+                kappas[k], theta, eps, rhos[k], drift);
+        std::cout << "Set " << k << ". Max difference with `generate_heston()`: "
+                  << (price_sets[k] - heston_paths).abs().max().item<double>() << " (price), "
+                  << (var_sets[k] - var_paths).abs().max().item<double>() << " (variance)" << std::endl;
+    }
+
+    // finite difference stencil in v0, all the parameters being scalars
+    const double h = 0.01;
+    torch::Tensor var_stencil = torch::stack({(1 - h) * init_state_var, init_state_var, (1 + h) * init_state_var});
+    torch::manual_seed(29);
+    std::tie(price_sets, var_sets) = noa::quant::generate_heston_sets(
+            n_set_paths, n_set_steps, dt, init_state_price, var_stencil,
+            kappas[0], theta, eps, rhos[0], drift);
+    {
+        torch::manual_seed(29);
+        torch::Tensor heston_paths, var_paths;
+        std::tie(heston_paths, var_paths) = noa::quant::generate_heston(
+                n_set_paths, n_set_steps, dt, init_state_price, init_state_var,
+                kappas[0], theta, eps, rhos[0], drift);
+        std::cout << "Stencil in v0: " << price_sets.size(0) << " sets. Max difference of the centre with "
+                  << "`generate_heston()`: " << (price_sets[1] - heston_paths).abs().max().item<double>()
+                  << " (price). Dependence of the mean terminal price on v0: "
+                  << ((price_sets[2] - price_sets[0]).index({Slice(), -1}).mean() / (2 * h * v0)).item<double>()
+                  << std::endl;
+    }
+
+    // step by step tensors, with derivatives
+    torch::Tensor kappas_grad = kappas.clone().requires_grad_(true);
+    std::tie(price_sets, var_sets) = noa::quant::generate_heston_sets(
+            n_set_paths, n_set_steps, dt, init_state_price, init_state_var,
+            kappas_grad, theta, eps, rhos, drift);
+    price_sets.index({Slice(), Slice(), -1}).mean().backward();
+    std::cout << "Derivatives of the mean terminal price w.r.t. kappa: " << kappas_grad.grad() << std::endl;
+}
 
 int main(int argc, char* argv[]) {
     test_noncentral_chi2();
     test_cir();
     test_heston();
+    test_fused_heston();
+    test_stream_heston();
+    test_heston_sets();
     std::cout << "Done." << std::endl;
     return 0;
 }
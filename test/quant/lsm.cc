@@ -1,6 +1,7 @@
 #include <noa/quant/lsm.hh>
 #include <noa/quant/bsm.hh>
 
+#include <chrono>
 #include <cmath>
 #include <iostream>
 
@@ -17,12 +18,21 @@ int main(int argc, char* argv[]) {
     double rate = 0.03;
 
     // LSM
-    torch::Tensor paths_gbm = S0 * torch::cumprod(
-            1 + rate * dt + sigma * std::sqrt(dt) * torch::randn({n_paths, n_steps}, torch::kFloat64),
-            1);
-    paths_gbm = torch::hstack({S0 * torch::ones({n_paths, 1}, torch::kFloat64), paths_gbm});
+    const auto generate_paths = [&]() {
+        torch::Tensor paths_gbm = S0 * torch::cumprod(
+                1 + rate * dt + sigma * std::sqrt(dt) * torch::randn({n_paths, n_steps}, torch::kFloat64),
+                1);
+        return torch::hstack({S0 * torch::ones({n_paths, 1}, torch::kFloat64), paths_gbm});
+    };
+    torch::Tensor paths_regression = generate_paths();
+    torch::Tensor paths_pricing = generate_paths();
 
-    double price_lsm = noa::quant::price_american_put_lsm(paths_gbm, dt, strike, rate);
+    auto start = std::chrono::steady_clock::now();
+    double price_lsm = std::get<0>(noa::quant::price_american_put_lsm(
+            paths_regression, paths_pricing, dt,
+            torch::tensor(strike, torch::kFloat64), torch::tensor(rate, torch::kFloat64),
+            3, false)).item<double>();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
     // BSM
     double T = static_cast<double>(n_steps) * dt;
@@ -39,9 +49,56 @@ int main(int argc, char* argv[]) {
     // results
     double rel_diff = (price_lsm - price_bsm) / price_bsm;
     std::cout << std::endl;
-    std::cout << "LSM price: " << price_lsm << std::endl;
+    std::cout << "LSM price: " << price_lsm << " (" << elapsed << " s)" << std::endl;
     std::cout << "BSM price: " << price_bsm << std::endl;
     std::cout << "Relative difference: " << rel_diff * 100 << "%" << std::endl;
 
+    // Greeks by autograd through the pricing pass
+    {
+        torch::Tensor S0_t = torch::tensor(S0, torch::dtype(torch::kFloat64).requires_grad(true));
+        torch::Tensor sigma_t = torch::tensor(sigma, torch::dtype(torch::kFloat64).requires_grad(true));
+        const auto n_greeks = n_paths / 10;
+        const auto generate_paths_grad = [&]() {
+            torch::Tensor paths_gbm = S0_t * torch::cumprod(
+                    1 + rate * dt + sigma_t * std::sqrt(dt) * torch::randn({n_greeks, n_steps}, torch::kFloat64),
+                    1);
+            return torch::hstack({S0_t * torch::ones({n_greeks, 1}, torch::kFloat64), paths_gbm});
+        };
+        torch::Tensor price = std::get<0>(noa::quant::price_american_put_lsm(
+                generate_paths_grad(), generate_paths_grad(), dt,
+                torch::tensor(strike, torch::kFloat64), torch::tensor(rate, torch::kFloat64),
+                3, false));
+        if (!price.grad_fn()) {
+            std::cerr << "LSM price has no autograd graph" << std::endl;
+            return 1;
+        }
+        auto greeks = torch::autograd::grad({price}, {S0_t, sigma_t});
+        std::cout << "LSM delta: " << greeks[0].item<double>()
+                  << ", vega: " << greeks[1].item<double>() << std::endl;
+    }
+
+    // Strike ladder on the same paths, against one strike at a time
+    torch::Tensor strikes = S0 * torch::linspace(0.8, 1.2, 9, torch::kFloat64);
+    start = std::chrono::steady_clock::now();
+    torch::Tensor prices_ladder = std::get<0>(noa::quant::price_american_put_lsm_ladder(
+            paths_regression, paths_pricing, dt, strikes, rate));
+    auto elapsed_ladder = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    torch::Tensor prices_single = torch::empty_like(strikes);
+    for (int64_t k = 0; k < strikes.numel(); k++)
+        prices_single[k] = std::get<0>(noa::quant::price_american_put_lsm(
+                paths_regression, paths_pricing, dt,
+                strikes[k], torch::tensor(rate, torch::kFloat64), 3, false));
+    auto elapsed_single = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::endl;
+    std::cout << "Strike ladder: " << strikes.numel() << " strikes (" << elapsed_ladder << " s, "
+              << elapsed_single << " s one at a time)" << std::endl;
+    for (int64_t k = 0; k < strikes.numel(); k++)
+        std::cout << "K = " << strikes[k].item<double>() << ": " << prices_ladder[k].item<double>()
+                  << " (single " << prices_single[k].item<double>() << ")" << std::endl;
+    std::cout << "Max difference: " << (prices_ladder - prices_single).abs().max().item<double>() << std::endl;
+
     return 0;
 }
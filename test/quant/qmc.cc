@@ -0,0 +1,111 @@
+#include <noa/quant/qmc.hh>
+#include <noa/quant/lsm.hh>
+#include <noa/quant/bsm.hh>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include <torch/torch.h>
+
+using namespace torch::indexing;
+using namespace noa::quant;
+
+
+int64_t n_steps = 64;
+double T = 1.0;
+double dt = T / n_steps;
+double S0 = 100.0;
+double strike = 100.0;
+double rate = 0.03;
+double sigma = 0.3;
+int n_replications = 10;
+
+double normal_cdf(double x) {
+    return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+double european_call(const torch::Tensor& paths) {
+    return std::exp(-rate * T) * torch::relu(paths.index({Slice(), -1}) - strike).mean().item<double>();
+}
+
+void test_gbm_convergence() {
+    std::cout << "Running functional test of `generate_gbm_qmc()`" << std::endl;
+    double d1 = (std::log(S0 / strike) + (rate + 0.5 * sigma * sigma) * T) / (sigma * std::sqrt(T));
+    double d2 = d1 - sigma * std::sqrt(T);
+    double exact = S0 * normal_cdf(d1) - strike * std::exp(-rate * T) * normal_cdf(d2);
+
+    // RMS errors over independent scramblings, against plain Monte Carlo
+    for (int64_t n_paths = 256; n_paths <= 65536; n_paths *= 4) {
+        double error_qmc = 0, error_mc = 0;
+        for (int r = 0; r < n_replications; r++) {
+            double price_qmc = european_call(generate_gbm_qmc(n_paths, n_steps, dt, S0, rate, sigma, 1000 + r));
+            torch::Tensor increments = (rate - 0.5 * sigma * sigma) * dt +
+                                       sigma * std::sqrt(dt) * torch::randn({n_paths, n_steps}, torch::kFloat64);
+            torch::Tensor paths_mc = S0 * torch::exp(torch::cumsum(increments, 1));
+            double price_mc = european_call(paths_mc);
+            error_qmc += std::pow(price_qmc - exact, 2) / n_replications;
+            error_mc += std::pow(price_mc - exact, 2) / n_replications;
+        }
+        std::cout << "n_paths = " << n_paths << ". RMS error. QMC: " << std::sqrt(error_qmc)
+                  << ", MC: " << std::sqrt(error_mc) << std::endl;
+    }
+}
+
+void test_heston_qmc() {
+    std::cout << "Running functional test of `generate_heston_qmc()`" << std::endl;
+    int64_t n_paths = 16384;
+    torch::Tensor kappa = torch::tensor(1.5, torch::kFloat64);
+    torch::Tensor theta = torch::tensor(0.04, torch::kFloat64);
+    torch::Tensor eps = torch::tensor(0.5, torch::kFloat64);
+    torch::Tensor rho = torch::tensor(-0.7, torch::kFloat64);
+    torch::Tensor drift = torch::tensor(rate, torch::kFloat64);
+    torch::Tensor v0 = 0.04 * torch::ones(n_paths, torch::kFloat64);
+    torch::Tensor init_price = S0 * torch::ones(n_paths, torch::kFloat64);
+
+    double exact_price = S0 * std::exp(rate * T);
+    double exact_var = 0.04;  // v(0) = theta
+    torch::Tensor means = torch::empty({n_replications, 2}, torch::kFloat64);
+    for (int r = 0; r < n_replications; r++) {
+        torch::Tensor price_paths, var_paths;
+        std::tie(price_paths, var_paths) = generate_heston_qmc(
+                n_paths, n_steps, dt, init_price, v0, kappa, theta, eps, rho, drift, 2000 + r);
+        means[r][0] = price_paths.index({Slice(), -1}).mean();
+        means[r][1] = var_paths.index({Slice(), -1}).mean();
+    }
+    std::cout << "E[S_T]. QMC: " << means.index({Slice(), 0}).mean().item<double>()
+              << " +/- " << means.index({Slice(), 0}).std().item<double>() / std::sqrt(n_replications)
+              << ", true: " << exact_price << std::endl;
+    std::cout << "E[v_T]. QMC: " << means.index({Slice(), 1}).mean().item<double>()
+              << " +/- " << means.index({Slice(), 1}).std().item<double>() / std::sqrt(n_replications)
+              << ", true: " << exact_var << std::endl;
+
+    torch::Tensor cir_paths = generate_cir_qmc(n_paths, n_steps, dt, v0, kappa, theta, eps, 3000);
+    std::cout << "CIR E[v_T]. QMC: " << cir_paths.index({Slice(), -1}).mean().item<double>()
+              << ", true: " << exact_var << std::endl;
+}
+
+void test_lsm_qmc() {
+    std::cout << "Running functional test of LSM with quasi-random paths" << std::endl;
+    int64_t n_paths = 65536;
+    double put_strike = S0 * 0.85;
+    torch::Tensor paths_regression = generate_gbm_qmc(n_paths, n_steps, dt, S0, rate, sigma, 4000);
+    torch::Tensor paths_pricing = generate_gbm_qmc(n_paths, n_steps, dt, S0, rate, sigma, 4001);
+    double price_lsm = std::get<0>(price_american_put_lsm(
+            paths_regression, paths_pricing, dt,
+            torch::tensor(put_strike, torch::kFloat64), torch::tensor(rate, torch::kFloat64),
+            3, false)).item<double>();
+
+    auto [V_bsm, S_arr, t_arr] = price_american_put_bs(put_strike, T, rate, sigma, 30, 200, 3000, 3000);
+    double price_bsm = V_bsm.index({torch::argmin(torch::abs(S_arr - S0)), -1}).item<double>();
+    std::cout << "LSM price: " << price_lsm << ", BSM price: " << price_bsm << std::endl;
+}
+
+
+int main(int argc, char* argv[]) {
+    test_gbm_convergence();
+    test_heston_qmc();
+    test_lsm_qmc();
+    std::cout << "Done." << std::endl;
+    return 0;
+}
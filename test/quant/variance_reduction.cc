@@ -0,0 +1,88 @@
+#include <noa/quant/variance_reduction.hh>
+#include <noa/quant/heston_sim.hh>
+#include <noa/quant/bsm.hh>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include <torch/torch.h>
+
+using namespace torch::indexing;
+using namespace noa::quant;
+
+
+int64_t n_paths = 100000;
+int64_t n_steps = 50;
+double T = 1.0;
+double dt = T / n_steps;
+double S0 = 100.0;
+double rate = 0.03;
+
+void print(const std::string& name, const ControlVariateResult& result) {
+    std::cout << name << ". Plain MC: " << result.plain_price << " +/- " << result.plain_std_error
+              << ", estimate: " << result.price << " +/- " << result.std_error
+              << ", beta: " << result.beta
+              << ", variance reduction factor: " << result.variance_reduction << std::endl;
+}
+
+void test_lsm_cv() {
+    std::cout << "Running functional test of `price_american_put_lsm_cv()`" << std::endl;
+    double sigma = 0.3;
+    double strike = S0 * 0.85;
+    double european = price_european_bs(S0, strike, T, rate, sigma, false);
+
+    torch::Tensor paths_regression = generate_gbm(n_paths, n_steps, dt, S0, rate, sigma);
+    for (bool antithetic : {false, true}) {
+        torch::Tensor paths_pricing = generate_gbm(n_paths, n_steps, dt, S0, rate, sigma, antithetic);
+        print(antithetic ? "Antithetic, European put control" : "European put control",
+              price_american_put_lsm_cv(paths_regression, paths_pricing, dt, strike, rate, european, 3, antithetic));
+    }
+
+    auto [V_bsm, S_arr, t_arr] = price_american_put_bs(strike, T, rate, sigma, 30, 200, 3000, 3000);
+    std::cout << "BSM price: " << V_bsm.index({torch::argmin(torch::abs(S_arr - S0)), -1}).item<double>()
+              << ", European: " << european << std::endl;
+}
+
+void test_heston_cv() {
+    std::cout << "Running functional test of control variates with `price_european_heston()`" << std::endl;
+    double v0 = 0.04, kappa = 1.5, theta = 0.04, eps = 0.5, rho = -0.7;
+    double strike = S0;
+    double european = price_european_heston(S0, strike, T, rate, v0, kappa, theta, eps, rho);
+    double discount = std::exp(-rate * T);
+
+    for (bool antithetic : {false, true}) {
+        torch::Tensor price_paths;
+        std::tie(price_paths, std::ignore) = generate_heston(
+                n_paths, n_steps, dt,
+                S0 * torch::ones(n_paths, torch::kFloat64), v0 * torch::ones(n_paths, torch::kFloat64),
+                torch::tensor(kappa, torch::kFloat64), torch::tensor(theta, torch::kFloat64),
+                torch::tensor(eps, torch::kFloat64), torch::tensor(rho, torch::kFloat64),
+                torch::tensor(rate, torch::kFloat64), 0, antithetic);
+        torch::Tensor european_payoffs = discount * torch::relu(price_paths.index({Slice(), -1}) - strike);
+
+        // the European call itself: the estimate matches the characteristic function price
+        auto plain = ControlVariate{0, antithetic};
+        plain.update(european_payoffs);
+        std::cout << (antithetic ? "Antithetic. " : "")
+                  << "European call. MC: " << plain.result().price << " +/- " << plain.result().std_error
+                  << ", characteristic function: " << european << std::endl;
+
+        // arithmetic Asian call, the European call as control, in chunks
+        auto estimator = ControlVariate{european, antithetic};
+        torch::Tensor asian_payoffs =
+                discount * torch::relu(AveragePrice{}.reduce(price_paths) - strike);
+        for (int64_t first = 0; first < n_paths; first += n_paths / 4)
+            estimator.update(asian_payoffs.index({Slice(first, first + n_paths / 4)}),
+                             european_payoffs.index({Slice(first, first + n_paths / 4)}));
+        print(antithetic ? "Antithetic Asian call" : "Asian call", estimator.result());
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    test_lsm_cv();
+    test_heston_cv();
+    std::cout << "Done." << std::endl;
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "test-data.hh"
+
+#include <noa/pms/csda.hh>
+#include <noa/utils/common.hh>
+
+#include <gtest/gtest.h>
+
+using namespace noa::pms;
+using namespace noa::utils;
+
+TEST(CSDA, RadiativeLoss) {
+    const auto kinetic_energies = DCSData::get_kinetic_energies();
+    const auto result = vmap<Scalar>(kinetic_energies, [](const Scalar &k) {
+        return csda::radiative_loss(k, STANDARD_ROCK, MUON_MASS, dcs::X_FRACTION, 180);
+    });
+    const auto expected = (kinetic_energies + MUON_MASS) *
+                          (DCSData::get_pumas_brems_cel() +
+                           DCSData::get_pumas_pprod_cel() +
+                           DCSData::get_pumas_photo_cel());
+    ASSERT_TRUE(relative_error(result, expected).item<Scalar>() < 1E-7);
+}
+
+TEST(CSDA, ConstantLoss) {
+    const csda::StoppingPower loss = 0.2;
+    const Energy kinetic_min = 1E-03;
+    const auto table = csda::LossTable{MUON_MASS, [loss](const Energy &) { return loss; },
+                                       kinetic_min, 1E+06, 241};
+
+    // With S ~ 1 / K below the grid, X(K) = (K - K_min / 2) / S
+    for (Energy k = 1.1E-03; k < 1E+06; k *= 1.7) {
+        const csda::Grammage range = (k - 0.5 * kinetic_min) / loss;
+        ASSERT_NEAR(table.range(k) / range, 1., 1E-04);
+        ASSERT_NEAR(table.stopping_power(k) / loss, 1., 1E-12);
+        ASSERT_NEAR(table.kinetic_energy(table.range(k)) / k, 1., 1E-04);
+    }
+    ASSERT_EQ(table.energy_after(10., table.range(10.)), 0.);
+}
+
+TEST(CSDA, SaveAndLoad) {
+    const auto path = std::filesystem::temp_directory_path() / "noa-test-csda.bin";
+    const auto bethe = [](const Energy &k) {
+        const Scalar E = k + MUON_MASS;
+        const Scalar beta2 = k * (k + 2. * MUON_MASS) / (E * E);
+        return 1E-04 / beta2 * (12. + log(k / MUON_MASS + 1.) - beta2);
+    };
+    const auto table = csda::LossTable{
+            MUON_MASS, csda::material_stopping_power({STANDARD_ROCK}, {1.}, MUON_MASS, bethe),
+            1E-02, 1E+04, 97};
+    ASSERT_TRUE(table.save(path));
+
+    const auto loaded = csda::LossTable::load(path);
+    ASSERT_TRUE(loaded.has_value());
+    ASSERT_TRUE(torch::equal(loaded->log_table(), table.log_table()));
+    for (Energy k = 2E-02; k < 1E+04; k *= 3.)
+        ASSERT_EQ(loaded->range(k), table.range(k));
+
+    // Ranges grow with the energy
+    const auto ranges = vmap<Scalar>(table.kinetic_energies(), [&table](const Energy &k) { return table.range(k); });
+    ASSERT_TRUE((ranges.slice(0, 1) > ranges.slice(0, 0, -1)).all().item<bool>());
+}
@@ -70,6 +70,25 @@ TEST(DCS, CELPairProduction) {
     ASSERT_TRUE(relative_error(result, DCSData::get_pumas_pprod_cel()).item<Scalar>() < 1E-7);
 }
 
+TEST(DCS, PairProductionTabulated) {
+    // The tolerance of the table (1E-06) is a target checked at sample points of the cells, not a
+    // bound: the errors below are measured at the energies of the reference data only
+    const auto table = dcs::PairProductionTable{STANDARD_ROCK, MUON_MASS};
+    ASSERT_TRUE(table.coverage() > 0.5);
+    const auto result = torch::zeros_like(DCSData::get_kinetic_energies());
+    dcs::vmap(table)(
+            result,
+            DCSData::get_kinetic_energies(),
+            DCSData::get_recoil_energies(),
+            STANDARD_ROCK, MUON_MASS);
+    const auto expected = dcs::map(dcs::pair_production)(
+            DCSData::get_kinetic_energies(),
+            DCSData::get_recoil_energies(),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_TRUE(relative_error(result, expected).item<Scalar>() < 1E-6);
+    ASSERT_TRUE(relative_error(result, DCSData::get_pumas_pprod()).item<Scalar>() < 1E-6);
+}
+
 TEST(DCS, Photonuclear) {
     const auto result = torch::zeros_like(DCSData::get_kinetic_energies());
     dcs::vmap(dcs::photonuclear)(
@@ -176,3 +195,145 @@ TEST(DCS, CoulombSoftScattering) {
     dcs::soft_scattering(result, DCSData::get_kinetic_energies(), STANDARD_ROCK, MUON_MASS);
     ASSERT_TRUE(relative_error(result, DCSData::get_pumas_soft_scatter()).item<Scalar>() < 1E-12);
 }
+
+TEST(DCS, CoulombParallel) {
+    const auto kinetic_energies = DCSData::get_kinetic_energies();
+    const Index nkin = kinetic_energies.size(0);
+    const auto options = torch::dtype(torch::kDouble);
+    const auto pipeline = [&](const auto &data, const auto &transport, const auto &hard, const auto &soft) {
+        auto fCM = torch::zeros({1, nkin, 2}, options);
+        auto screen = torch::zeros({1, nkin, 9}, options);
+        auto fspin = torch::zeros({1, nkin}, options);
+        auto invlambda = torch::zeros({1, nkin}, options);
+        auto G = torch::zeros_like(fCM);
+        auto mu0 = torch::zeros_like(kinetic_energies);
+        auto lb_h = torch::zeros_like(kinetic_energies);
+        auto ms1 = torch::zeros_like(kinetic_energies);
+        data(fCM, screen, fspin, invlambda, kinetic_energies, STANDARD_ROCK, MUON_MASS);
+        transport(G, screen, fspin, torch::tensor(1.0, options));
+        hard(mu0, lb_h, G, fCM, screen, invlambda, fspin);
+        soft(ms1, kinetic_energies, STANDARD_ROCK, MUON_MASS);
+        return std::vector<torch::Tensor>{fCM, screen, fspin, invlambda, G, mu0, lb_h, ms1};
+    };
+    const auto expected = pipeline(dcs::coulomb_data, dcs::coulomb_transport,
+                                 dcs::hard_scattering, dcs::soft_scattering);
+    const auto result = pipeline(dcs::pcoulomb_data, dcs::pcoulomb_transport,
+                               dcs::phard_scattering, dcs::psoft_scattering);
+    for (std::size_t i = 0; i < expected.size(); i++)
+        ASSERT_TRUE(torch::equal(result[i], expected[i]));
+}
+
+TEST(DCS, CoulombComposite) {
+    const auto kinetic_energies = DCSData::get_kinetic_energies();
+    const Index nkin = kinetic_energies.size(0);
+    const auto options = torch::dtype(torch::kDouble);
+    const auto elements = std::vector<AtomicElement>{
+            STANDARD_ROCK, AtomicElement{1.008, 19.2E-9, 1}, AtomicElement{15.999, 95.0E-9, 8}};
+    const auto fractions = torch::tensor({0.7, 0.1, 0.2}, options);
+    const Index nel = elements.size();
+
+    // Element by element, strided tables
+    const auto fCM = torch::zeros({nel, nkin, 2}, options);
+    const auto screen = torch::zeros({nel, nkin, 9}, options);
+    const auto fspin = torch::zeros({nel, nkin}, options);
+    const auto invlambda = torch::zeros({nel, nkin}, options);
+    for (Index iel = 0; iel < nel; iel++) {
+        dcs::coulomb_data(fCM[iel], screen[iel], fspin[iel], invlambda[iel],
+                          kinetic_energies, elements[iel], MUON_MASS);
+        invlambda[iel].mul_(fractions[iel]);
+    }
+    const auto G = torch::zeros_like(fCM);
+    dcs::coulomb_transport(G, screen, fspin, torch::tensor(1.0, options));
+    const auto mu0 = torch::zeros_like(kinetic_energies);
+    const auto lb_h = torch::zeros_like(kinetic_energies);
+    dcs::hard_scattering(mu0, lb_h, G, fCM, screen, invlambda, fspin);
+
+    // Packed records, in a single pass
+    const auto records = torch::zeros({nkin, nel, dcs::COULOMB_RECORD}, options);
+    const auto mu0_composite = torch::zeros_like(kinetic_energies);
+    const auto lb_h_composite = torch::zeros_like(kinetic_energies);
+    dcs::composite_hard_scattering(mu0_composite, lb_h_composite, records,
+                                   kinetic_energies, elements, fractions, MUON_MASS);
+
+    ASSERT_TRUE(torch::equal(mu0_composite, mu0));
+    ASSERT_TRUE(torch::equal(lb_h_composite, lb_h));
+    ASSERT_TRUE(torch::equal(records.select(2, 0), invlambda.t()));
+    ASSERT_TRUE(torch::equal(records.slice(2, 6), screen.transpose(0, 1)));
+}
+
+TEST(DCS, BremsstrahlungSIMD) {
+    const auto result = torch::zeros_like(DCSData::get_kinetic_energies());
+    dcs::simd::vmap(dcs::simd::bremsstrahlung)(
+            result,
+            DCSData::get_kinetic_energies(),
+            DCSData::get_recoil_energies(),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_TRUE(relative_error(result, DCSData::get_pumas_brems()).item<Scalar>() < 1E-11);
+}
+
+TEST(DCS, PairProductionSIMD) {
+    const auto result = dcs::simd::pmap(dcs::simd::pair_production)(
+            DCSData::get_kinetic_energies(),
+            DCSData::get_recoil_energies(),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_TRUE(relative_error(result, DCSData::get_pumas_pprod()).item<Scalar>() < 1E-7);
+}
+
+TEST(DCS, PhotonuclearSIMD) {
+    const auto result = torch::zeros_like(DCSData::get_kinetic_energies());
+    dcs::simd::vmap(dcs::simd::photonuclear)(
+            result,
+            DCSData::get_kinetic_energies(),
+            DCSData::get_recoil_energies(),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_TRUE(relative_error(result, DCSData::get_pumas_photo()).item<Scalar>() < 1E-9);
+}
+
+TEST(DCS, IonisationSIMD) {
+    const auto result = dcs::simd::pmap(dcs::simd::ionisation)(
+            DCSData::get_kinetic_energies(),
+            DCSData::get_recoil_energies(),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_TRUE(relative_error(result, DCSData::get_pumas_ion()).item<Scalar>() < 1E-9);
+}
+
+// Single precision against the double precision reference. Rounding the energies to
+// floats can move entries across kinematic thresholds, these are left out.
+inline Scalar single_precision_error(const Calculation &result, const Calculation &expected) {
+    const auto computed = result.to(torch::kFloat64);
+    const auto support = (computed != 0.) & (expected != 0.);
+    return relative_error(computed.masked_select(support), expected.masked_select(support)).item<Scalar>();
+}
+
+TEST(DCS, BremsstrahlungSIMDFloat) {
+    const auto result = dcs::simd::map(dcs::simd::bremsstrahlung)(
+            DCSData::get_kinetic_energies().to(torch::kFloat32),
+            DCSData::get_recoil_energies().to(torch::kFloat32),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_EQ(result.scalar_type(), torch::kFloat32);
+    ASSERT_TRUE(single_precision_error(result, DCSData::get_pumas_brems()) < 1E-5);
+}
+
+TEST(DCS, PairProductionSIMDFloat) {
+    const auto result = dcs::simd::pmap(dcs::simd::pair_production)(
+            DCSData::get_kinetic_energies().to(torch::kFloat32),
+            DCSData::get_recoil_energies().to(torch::kFloat32),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_TRUE(single_precision_error(result, DCSData::get_pumas_pprod()) < 1E-5);
+}
+
+TEST(DCS, PhotonuclearSIMDFloat) {
+    const auto result = dcs::simd::map(dcs::simd::photonuclear)(
+            DCSData::get_kinetic_energies().to(torch::kFloat32),
+            DCSData::get_recoil_energies().to(torch::kFloat32),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_TRUE(single_precision_error(result, DCSData::get_pumas_photo()) < 1E-5);
+}
+
+TEST(DCS, IonisationSIMDFloat) {
+    const auto result = dcs::simd::pmap(dcs::simd::ionisation)(
+            DCSData::get_kinetic_energies().to(torch::kFloat32),
+            DCSData::get_recoil_energies().to(torch::kFloat32),
+            STANDARD_ROCK, MUON_MASS);
+    ASSERT_TRUE(single_precision_error(result, DCSData::get_pumas_ion()) < 1E-5);
+}
@@ -0,0 +1,85 @@
+#include <noa/pms/grammage.hh>
+#include <noa/3rdparty/tnl-noa/src/TNL/Meshes/MeshBuilder.h>
+
+#include "test-trace.hh"
+
+TEST(GRAMMAGE, GrammageMap) {
+    using Tracer = DeviceTracer<Devices::Host>;
+    using PointHost = typename HostMesh::PointType;
+    using noa::pms::grammage::GrammageMap;
+
+    HostMesh host_mesh = MeshData::get_tmesh();
+    const auto box = Tracer::get_bounding_box(&host_mesh);
+    // Away from the faces and edges of the cells
+    const PointHost size = box.upper - box.lower;
+    const PointHost detector = box.lower + PointHost(0.41 * size.x(), 0.37 * size.y(), 0.43 * size.z());
+    const double density = 2650.;
+
+    const auto map = GrammageMap::compute<Tracer>(host_mesh, detector, [density](int) { return density; }, 12, 7);
+    ASSERT_TRUE(map.has_value());
+
+    // Straight up, the grammage is the density times the height above the detector
+    const double zenith = density * (box.upper.z() - detector.z());
+    const auto &table = map->get_table();
+    for (int azimuth = 0; azimuth < 12; azimuth++) {
+        EXPECT_NEAR(table[azimuth][6].item<double>() / zenith, 1., 1e-9);
+    }
+    EXPECT_NEAR((*map)(1., 0.5 * M_PI) / zenith, 1., 1e-9);
+    // Horizontally along x, the grammage is the density times the distance to the side
+    EXPECT_NEAR((*map)(0., 0.) / (density * (box.upper.x() - detector.x())), 1., 1e-9);
+
+    const auto path = std::filesystem::temp_directory_path() / "noa-test-grammage.bin";
+    ASSERT_TRUE(map->save(path));
+    const auto loaded = GrammageMap::load(path);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_TRUE(torch::equal(loaded->get_table(), table));
+
+    // The cached map is reused for the same geometry only
+    const auto cached = GrammageMap::load_or_compute<Tracer>(
+            path, host_mesh, detector, [density](int) { return density; }, 12, 7);
+    ASSERT_TRUE(cached.has_value());
+    EXPECT_TRUE(torch::equal(cached->get_table(), table));
+    const auto denser = GrammageMap::load_or_compute<Tracer>(
+            path, host_mesh, detector, [density](int) { return 2. * density; }, 12, 7);
+    ASSERT_TRUE(denser.has_value());
+    EXPECT_TRUE(torch::allclose(denser->get_table(), 2. * table));
+    std::filesystem::remove(path);
+
+    // From below the mesh, the rays start at its border
+    const PointHost below = PointHost(detector.x(), detector.y(), box.lower.z() - 1.);
+    const auto outside = GrammageMap::compute<Tracer>(host_mesh, below, [density](int) { return density; }, 12, 7);
+    ASSERT_TRUE(outside.has_value());
+    EXPECT_NEAR((*outside)(0., 0.5 * M_PI) / (density * (box.upper.z() - box.lower.z())), 1., 1e-9);
+    EXPECT_EQ((*outside)(0., 0.), 0.);
+}
+
+TEST(GRAMMAGE, NonConvexMesh) {
+    using Tracer = DeviceTracer<Devices::Host>;
+    using PointHost = typename HostMesh::PointType;
+    using noa::pms::grammage::GrammageMap;
+
+    // Two corner tetrahedra on top of each other, 1 m apart
+    auto mesh = HostMesh{};
+    auto builder = Meshes::MeshBuilder<HostMesh>{};
+    builder.setEntitiesCount(8, 2);
+    for (int cell = 0; cell < 2; cell++) {
+        const double z = 2. * cell;
+        builder.setPoint(4 * cell, PointHost(0., 0., z));
+        builder.setPoint(4 * cell + 1, PointHost(1., 0., z));
+        builder.setPoint(4 * cell + 2, PointHost(0., 1., z));
+        builder.setPoint(4 * cell + 3, PointHost(0., 0., z + 1.));
+        auto seed = builder.getCellSeed(cell);
+        for (int k = 0; k < 4; k++) seed.setCornerId(k, 4 * cell + k);
+    }
+    ASSERT_TRUE(builder.build(mesh));
+    const double density = 1000.;
+    const auto rho = [density](int cell) { return (cell + 1) * density; };
+
+    // Straight up, the ray crosses 0.8 m of each tetrahedron, from inside the lower one or from below it
+    const double zenith = 0.8 * density + 0.8 * 2. * density;
+    for (const double z : {-1., 0.1}) {
+        const auto map = GrammageMap::compute<Tracer>(mesh, PointHost(0.1, 0.1, z), rho, 4, 3);
+        ASSERT_TRUE(map.has_value());
+        EXPECT_NEAR((*map)(0., 0.5 * M_PI), zenith - ((z > 0) ? z * density : 0.), 1e-9);
+    }
+}
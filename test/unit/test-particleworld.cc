@@ -0,0 +1,63 @@
+#include "pms/particleworld.hh"
+
+#include <gtest/gtest.h>
+
+using namespace noa::test::pms;
+
+TEST(PARTICLEWORLD, DomainEntry) {
+    using World = MuonWorld<>;
+    using MeshType = typename World::MeshType;
+    using PointType = typename World::PointType;
+
+    // A single unit tetrahedron, its bounding box is [0, 1]^3
+    auto mesh = MeshType{};
+    auto builder = noa::TNL::Meshes::MeshBuilder<MeshType>{};
+    builder.setEntitiesCount(4, 1);
+    builder.setPoint(0, PointType(0, 0, 0));
+    builder.setPoint(1, PointType(1, 0, 0));
+    builder.setPoint(2, PointType(0, 1, 0));
+    builder.setPoint(3, PointType(0, 0, 1));
+    auto seed = builder.getCellSeed(0);
+    for (int i = 0; i < 4; i++) seed.setCornerId(i, i);
+    ASSERT_TRUE(builder.build(mesh));
+
+    const auto path = std::filesystem::temp_directory_path() / "noa-test-particleworld.vtu";
+    {
+        auto file = std::ofstream{path};
+        auto writer = typename World::DomainType::MeshWriter{file};
+        writer.template writeEntities<World::DomainType::getMeshDimension()>(mesh);
+    }
+
+    auto world = World{};
+    const auto outside = PointType(-2, 0.2, 0.2);
+    const auto forward = PointType(1, 0, 0);
+    const auto backward = PointType(-1, 0, 0);
+    EXPECT_FALSE(world.distance_to_domain(outside, forward).has_value());
+
+    world.add_domain().loadFrom(path);
+    std::filesystem::remove(path);
+
+    EXPECT_FLOAT_EQ(world.distance_to_domain(outside, forward).value(), 2.f);
+    EXPECT_FALSE(world.distance_to_domain(outside, backward).has_value());
+    EXPECT_EQ(world.distance_to_domain(PointType(0.1, 0.1, 0.1), backward).value(), 0.f);
+
+    const double entry = 2. + std::numeric_limits<float>::epsilon();
+    // Long steps stop at the domain, shorter ones are kept
+    double step = 10.;
+    world.clip_step(&step, true, outside, forward);
+    EXPECT_NEAR(step, entry, 1e-6);
+    step = 1.;
+    world.clip_step(&step, true, outside, forward);
+    EXPECT_EQ(step, 1.);
+    // Infinite medium steps stop at the domain too, unless there is no medium
+    step = -1.;
+    world.clip_step(&step, true, outside, forward);
+    EXPECT_NEAR(step, entry, 1e-6);
+    step = 0.;
+    world.clip_step(&step, false, outside, forward);
+    EXPECT_EQ(step, 0.);
+    // Nothing ahead
+    step = -1.;
+    world.clip_step(&step, true, outside, backward);
+    EXPECT_EQ(step, -1.);
+}
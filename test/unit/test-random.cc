@@ -0,0 +1,59 @@
+#include <noa/utils/random.hh>
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+using namespace noa::utils::random;
+
+TEST(RANDOM, Philox4x32KnownAnswers) {
+    // Known answer tests from the Random123 distribution
+    ASSERT_EQ(philox4x32(Counter{0, 0, 0, 0}, Key{0, 0}),
+              (Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    ASSERT_EQ(philox4x32(Counter{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, Key{0xffffffff, 0xffffffff}),
+              (Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    ASSERT_EQ(philox4x32(Counter{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, Key{0xa4093822, 0x299f31d0}),
+              (Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(RANDOM, Philox4x32Lanes) {
+    constexpr int W = 8;
+    const auto key = Key{0xa4093822, 0x299f31d0};
+    uint32_t ctr[4][W];
+    for (int i = 0; i < W; i++)
+        for (int j = 0; j < 4; j++) ctr[j][i] = 0x243f6a88u * (i + 1) + j;
+    uint32_t res[4][W];
+    std::memcpy(res, ctr, sizeof(ctr));
+    philox4x32<W>(res, key);
+    for (int i = 0; i < W; i++)
+        ASSERT_EQ(philox4x32(Counter{ctr[0][i], ctr[1][i], ctr[2][i], ctr[3][i]}, key),
+                  (Counter{res[0][i], res[1][i], res[2][i], res[3][i]}));
+}
+
+TEST(RANDOM, CounterStreamReplay) {
+    constexpr uint64_t seed = 987654;
+    constexpr int n = 11;
+
+    auto stream = CounterStream{seed};
+    double first[n], second[n];
+    stream.reset(3);
+    for (int i = 0; i < n; i++) {
+        first[i] = stream();
+        ASSERT_TRUE(first[i] > 0. && first[i] < 1.);
+    }
+
+    // Draws of another primary do not affect the replay
+    stream.reset(5);
+    for (int i = 0; i < n; i++) stream();
+    stream.reset(3);
+    for (int i = 0; i < n; i++) second[i] = stream();
+    for (int i = 0; i < n; i++) ASSERT_EQ(first[i], second[i]);
+    ASSERT_EQ(stream.draws(), n);
+
+    // Random access within a stream
+    for (int i = 0; i < n; i++) {
+        auto jumped = CounterStream{seed, 3};
+        jumped.skip_to(i);
+        ASSERT_EQ(jumped(), first[i]);
+    }
+}
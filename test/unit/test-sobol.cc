@@ -0,0 +1,52 @@
+#include <noa/utils/sobol.hh>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace noa::utils::sobol;
+
+TEST(SOBOL, UnscrambledPoints) {
+    const auto sobol = ScrambledSobol{3, 0};
+    // First points in binary order [JoeKuo2008]
+    const double expected[8][3] = {{0., 0., 0.},
+                                   {0.5, 0.5, 0.5},
+                                   {0.25, 0.75, 0.75},
+                                   {0.75, 0.25, 0.25},
+                                   {0.125, 0.625, 0.375},
+                                   {0.625, 0.125, 0.875},
+                                   {0.375, 0.375, 0.625},
+                                   {0.875, 0.875, 0.125}};
+    for (uint32_t i = 0; i < 8; i++)
+        for (int64_t dim = 0; dim < 3; dim++)
+            ASSERT_EQ(sobol.unscrambled(i, dim) / 4294967296., expected[i][dim]);
+}
+
+TEST(SOBOL, ScrambledStratification) {
+    constexpr int m = 10;
+    constexpr uint32_t n = 1u << m;
+    const auto sobol = ScrambledSobol{MAX_DIMENSION + 2, 7};
+
+    // Scrambling preserves the net: each of the n intervals of a coordinate holds exactly one point
+    for (int64_t dim = 0; dim < MAX_DIMENSION; dim += 31) {
+        auto count = std::vector<int>(n, 0);
+        for (uint32_t i = 0; i < n; i++) {
+            const double u = sobol(i, dim);
+            ASSERT_TRUE(u > 0. && u < 1.);
+            count[static_cast<int>(u * n)]++;
+        }
+        for (const auto c: count) ASSERT_EQ(c, 1);
+    }
+
+    // The first two coordinates form a (0, m, 2)-net
+    auto count = std::vector<int>(n, 0);
+    for (uint32_t i = 0; i < n; i++)
+        count[static_cast<int>(sobol(i, 0) * 32) * 32 + static_cast<int>(sobol(i, 1) * 32)]++;
+    for (const auto c: count) ASSERT_EQ(c, 1);
+
+    // Padding beyond the direction numbers
+    for (uint32_t i = 0; i < n; i++) {
+        const double u = sobol(i, MAX_DIMENSION + 1);
+        ASSERT_TRUE(u > 0. && u < 1.);
+    }
+}
@@ -14,4 +14,20 @@ TEST(TRACE, CheckCurrentTetrahedron) {
 
 TEST(TRACE, CheckSideCases) {
     check_side_cases<Devices::Host>();
-}
\ No newline at end of file
+}
+
+TEST(TRACE, BoundingBox) {
+    test_bounding_box();
+}
+
+TEST(TRACE, TraceRay) {
+    test_trace_ray();
+}
+
+TEST(TRACE, RayOffset) {
+    test_ray_offset();
+}
+
+TEST(TRACE, TraceRayWithAdjacency) {
+    test_trace_ray_with_adjacency();
+}
@@ -144,3 +144,125 @@ inline void check_side_cases() {
     };
     Algorithms::ParallelFor<DeviceType>::exec(0, 1, kernel);
 }
+
+inline void test_bounding_box() {
+    using Tracer = DeviceTracer<Devices::Host>;
+    using PointHost = typename HostMesh::PointType;
+
+    HostMesh host_mesh = MeshData::get_tmesh();
+    const auto box = Tracer::get_bounding_box(&host_mesh);
+
+    const auto vertices = host_mesh.template getEntitiesCount<0>();
+    for (int vertex = 0; vertex < vertices; vertex++) {
+        TNL_ASSERT_TRUE(box.contains(host_mesh.template getEntity<0>(vertex).getPoint()), "vertex outside of the box");
+    }
+
+    PointHost direction = PointHost(1, 1, 1);
+    direction /= sqrt(dot(direction, direction));
+    const PointHost origin = box.lower - PointHost(1, 1, 1);
+    const PointHost center = (box.lower + box.upper) / 2;
+    const PointHost backwards = -direction;
+
+    EXPECT_NEAR(box.get_entry_distance(origin, direction), sqrt(3.0), 1e-12);
+    EXPECT_EQ(box.get_entry_distance(center, direction), 0);
+    EXPECT_EQ(box.get_entry_distance(origin, backwards), -1);
+}
+
+inline void test_trace_ray() {
+    using Tracer = DeviceTracer<Devices::Host>;
+    using PointHost = typename HostMesh::PointType;
+
+    HostMesh host_mesh = MeshData::get_tmesh();
+    const auto box = Tracer::get_bounding_box(&host_mesh);
+
+    const PointHost origin = PointHost(0.1, 0.11, 0.1);
+    const PointHost direction = PointHost(0, 0, 1);
+    const auto path = Tracer::trace_ray(&host_mesh, origin, direction);
+    ASSERT_TRUE(path.has_value());
+
+    const int expected[] = {1, 0, 11, 12, 14, 8, 34, 36};
+    ASSERT_EQ(path->size(), 8u);
+    double length = 0;
+    for (std::size_t i = 0; i < path->size(); i++) {
+        EXPECT_EQ((*path)[i].tetrahedron_global_index, expected[i]);
+        EXPECT_GT((*path)[i].length, 0);
+        length += (*path)[i].length;
+    }
+    EXPECT_NEAR(length, box.upper.z() - origin.z(), 1e-9);
+
+    const PointHost outside = box.upper + PointHost(1, 1, 1);
+    EXPECT_FALSE(Tracer::trace_ray(&host_mesh, outside, direction).has_value());
+}
+
+inline void test_ray_offset() {
+    // In single precision, the offset past a face moves the crossing point whatever its coordinates
+    using FloatTracer = Tracer<Devices::Host, float, int, short int>;
+    using Point = Containers::StaticVector<3, float>;
+    for (const float coordinate : {0.1f, 1.f, 1234.5f}) {
+        const Point point = Point(coordinate, -0.5f * coordinate, 0.f);
+        const float offset = FloatTracer::get_ray_offset(point, 1e-3f, 1e-12f);
+        EXPECT_NE(point.x() + offset, point.x());
+        EXPECT_LT(offset, 1e-4f * coordinate);
+    }
+    EXPECT_EQ(FloatTracer::get_ray_offset(Point(0.f, 0.f, 0.f), 0.f, 1e-3f), 1e-3f);
+}
+
+inline void test_trace_ray_with_adjacency() {
+    using Tracer = DeviceTracer<Devices::Host>;
+    using PointHost = typename HostMesh::PointType;
+
+    HostMesh host_mesh = MeshData::get_tmesh();
+    const auto adjacency = Tracer::build_adjacency(host_mesh);
+    const auto view = adjacency.get_view();
+
+    // Every cell is a face neighbour of its face neighbours
+    const int cells = host_mesh.template getEntitiesCount<3>();
+    for (int cell = 0; cell < cells; cell++) {
+        for (int k = 0; k < 4; k++) {
+            const int neighbour = view.face_neighbours[4 * cell + k];
+            if (neighbour < 0) continue;
+            int found = 0;
+            for (int j = 0; j < 4; j++) found += view.face_neighbours[4 * neighbour + j] == cell;
+            EXPECT_EQ(found, 1);
+        }
+    }
+
+    const PointHost direction = PointHost(0, 0, 1);
+    const auto path = Tracer::trace_ray(&host_mesh, view, 1, PointHost(0.1, 0.11, 0.1), direction);
+    const int expected[] = {1, 0, 11, 12, 14, 8, 34, 36};
+    ASSERT_EQ(path.size(), 8u);
+    for (std::size_t i = 0; i < path.size(); i++) {
+        EXPECT_EQ(path[i].tetrahedron_global_index, expected[i]);
+    }
+
+    // Through the edges and vertices of the cells
+    PointHost corner_direction = PointHost(1, 1, 1);
+    corner_direction /= sqrt(dot(corner_direction, corner_direction));
+    const PointHost corner_origin = PointHost(0.1, 0.1, 0.1);
+    const auto corner_path = Tracer::trace_ray(&host_mesh, view, 1, corner_origin, corner_direction);
+    const auto expected_path = Tracer::trace_ray(&host_mesh, 1, corner_origin, corner_direction);
+    ASSERT_FALSE(corner_path.empty());
+    EXPECT_EQ(corner_path.back().tetrahedron_global_index, 47);
+
+    double length = 0, expected_length = 0;
+    for (const auto &segment : corner_path) length += segment.length;
+    for (const auto &segment : expected_path) expected_length += segment.length;
+    EXPECT_NEAR(length, expected_length, 1e-9);
+
+    // Both overloads count the offset past the faces in the path
+    const auto box = Tracer::get_bounding_box(&host_mesh);
+    const PointHost origin = PointHost(0.1, 0.11, 0.1);
+    const double ray_offset = 1e-6;
+    const auto offset_path = Tracer::trace_ray(&host_mesh, view, 1, origin, direction, 1e-7, ray_offset);
+    const auto expected_offset_path = Tracer::trace_ray(&host_mesh, 1, origin, direction, 1e-7, ray_offset);
+    ASSERT_EQ(offset_path.size(), expected_offset_path.size());
+    length = expected_length = 0;
+    for (std::size_t i = 0; i < offset_path.size(); i++) {
+        EXPECT_EQ(offset_path[i].tetrahedron_global_index, expected_offset_path[i].tetrahedron_global_index);
+        EXPECT_NEAR(offset_path[i].length, expected_offset_path[i].length, 1e-9);
+        length += offset_path[i].length;
+        expected_length += expected_offset_path[i].length;
+    }
+    EXPECT_NEAR(length, box.upper.z() - origin.z(), 1e-9);
+    EXPECT_NEAR(expected_length, box.upper.z() - origin.z(), 1e-9);
+}
@@ -0,0 +1,92 @@
+#include <noa/pms/tracks.hh>
+
+#include <gtest/gtest.h>
+
+using namespace noa::pms::tracks;
+
+TEST(TRACKS, RecordAndLoad) {
+    const auto dump = std::filesystem::temp_directory_path() / "noa-test-tracks.bin";
+    constexpr int n_threads = 2;
+    constexpr int n_steps = 3 * Chunk::CAPACITY / 2;
+
+    {
+        auto recorder = TrackRecorder{dump, n_threads};
+        auto threads = std::vector<std::thread>{};
+        for (int t = 0; t < n_threads; t++)
+            threads.emplace_back([&recorder, t] {
+                auto writer = recorder.writer();
+                for (int i = 0; i < n_steps; i++) {
+                    const double position[3] = {double(i), 0., -double(i)};
+                    const double direction[3] = {0., 0., 1.};
+                    writer.record(t, position, direction, 1E-3 * i, t, i % 3);
+                }
+            });
+        for (auto &thread : threads) thread.join();
+    }
+
+    const auto tracks = load_tracks(dump);
+    ASSERT_TRUE(tracks.has_value());
+    ASSERT_EQ(tracks->size(), n_threads * n_steps);
+
+    // Records of a given particle keep their order
+    int next[n_threads] = {};
+    for (std::size_t j = 0; j < tracks->size(); j++) {
+        const auto p = tracks->particle[j];
+        const int i = next[p]++;
+        ASSERT_EQ(tracks->position[0][j], double(i));
+        ASSERT_EQ(tracks->position[2][j], -double(i));
+        ASSERT_EQ(tracks->direction[2][j], 1.);
+        ASSERT_EQ(tracks->energy[j], 1E-3 * i);
+        ASSERT_EQ(tracks->medium[j], int(p));
+        ASSERT_EQ(tracks->event[j], i % 3);
+    }
+    for (int t = 0; t < n_threads; t++) ASSERT_EQ(next[t], n_steps);
+
+    std::filesystem::remove(dump);
+}
+
+TEST(TRACKS, RecordAfterFlush) {
+    const auto dump = std::filesystem::temp_directory_path() / "noa-test-tracks-flushed.bin";
+    const double position[3] = {0., 0., 0.};
+    const double direction[3] = {0., 0., 1.};
+    {
+        auto recorder = TrackRecorder{dump};
+        auto writer = recorder.writer();
+        writer.record(0, position, direction, 1., 0, 0);
+        writer.flush();
+        writer.record(1, position, direction, 2., 0, 0);
+        writer.flush();
+        writer.record(2, position, direction, 3., 0, 0);
+    }
+
+    const auto tracks = load_tracks(dump);
+    ASSERT_TRUE(tracks.has_value());
+    ASSERT_EQ(tracks->size(), 3u);
+    for (std::size_t j = 0; j < tracks->size(); j++) {
+        ASSERT_EQ(tracks->particle[j], j);
+        ASSERT_EQ(tracks->energy[j], 1. + j);
+    }
+
+    std::filesystem::remove(dump);
+}
+
+TEST(TRACKS, RecordAfterClose) {
+    const auto dump = std::filesystem::temp_directory_path() / "noa-test-tracks-closed.bin";
+    const double position[3] = {0., 0., 0.};
+    const double direction[3] = {0., 0., 1.};
+    {
+        auto recorder = TrackRecorder{dump};
+        auto writer = recorder.writer();
+        writer.record(0, position, direction, 1., 0, 0);
+        recorder.close();
+        // Pending records are not written, and the writer says so
+        EXPECT_THROW(writer.flush(), std::runtime_error);
+        EXPECT_THROW(recorder.writer(), std::runtime_error);
+    }
+
+    const auto tracks = load_tracks(dump);
+    ASSERT_TRUE(tracks.has_value());
+    EXPECT_EQ(tracks->size(), 0u);
+
+    std::filesystem::remove(dump);
+}